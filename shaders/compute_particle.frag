@@ -1,6 +1,6 @@
 #version 450
 
-layout (location = 0) in vec3 fragColor;
+layout (location = 0) in vec4 fragColor;
 
 layout (location = 0) out vec4 outColor;
 
@@ -13,5 +13,5 @@ void main() {
     //     discard;
     // }
     
-    outColor = vec4(fragColor, alpha);
+    outColor = vec4(fragColor.rgb, fragColor.a * alpha);
 }
\ No newline at end of file
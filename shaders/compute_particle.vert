@@ -3,10 +3,10 @@
 layout(location = 0) in vec2 inPosition;
 layout(location = 1) in vec4 inColor;
 
-layout(location = 0) out vec3 fragColor;
+layout(location = 0) out vec4 fragColor;
 
 void main() {
     gl_PointSize = 10.0;
     gl_Position = vec4(inPosition.xy, 0.1, 1.0);
-    fragColor = inColor.rgb;
-}
\ No newline at end of file
+    fragColor = inColor;
+}
@@ -0,0 +1,27 @@
+#version 450
+
+// depth only pass. position is the only vertex input.
+layout (location = 0) in vec3 position;
+
+layout (set = 0, binding = 0) uniform GlobalUbo{
+    mat4 projection;
+    mat4 view;
+    mat4 invView;
+    vec4 ambientLightColor; // w as intensity
+    uvec4 clusterCounts; // xyz: cluster grid dimension, w: number of lights
+    vec4 clusterDepthParams; // x: near, y: far, z: slice scale, w: slice bias
+    vec4 screenSize; // xy: render target size, zw: 1 / size
+} ubo;
+
+layout (push_constant) uniform Push{
+	mat4 modelMatrix; 
+    mat4 normalMatrix;
+} push;
+
+// NOTE: same expression as simple_shader.vert, otherwise EQUAL test fails.
+invariant gl_Position;
+
+void main() {
+  vec4 positionWorld = push.modelMatrix * vec4(position, 1.0);
+  gl_Position = ubo.projection * ubo.view * positionWorld;
+}
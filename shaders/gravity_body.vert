@@ -0,0 +1,22 @@
+#version 450
+
+// positions written by compute_gravity.comp or copied by the CPU backend.
+layout (location = 0) in vec4 inPosition;
+
+layout (location = 0) out vec4 fragColor;
+
+layout (set = 0, binding = 0) uniform GlobalUbo{
+    mat4 projection;
+    mat4 view;
+    mat4 invView;
+    vec4 ambientLightColor; // w as intensity
+    uvec4 clusterCounts; // xyz: cluster grid dimension, w: number of lights
+    vec4 clusterDepthParams; // x: near, y: far, z: slice scale, w: slice bias
+    vec4 screenSize; // xy: render target size, zw: 1 / size
+} ubo;
+
+void main() {
+    gl_PointSize = 3.0;
+    gl_Position = ubo.projection * ubo.view * vec4(inPosition.xyz, 1.0);
+    fragColor = vec4(1.0, 0.85, 0.6, 0.8);
+}
@@ -1,35 +1,17 @@
 #version 450
 
 layout (location = 0) in vec2 fragOffset;
+layout (location = 1) flat in vec4 fragColor;
+layout (location = 2) flat in float fragRadius;
 layout (location = 0) out vec4 outColor;
 
-struct PointLight{
-  vec4 position; // ignore w
-  vec4 color; // w as intensity
-};
-
-layout (set = 0, binding = 0) uniform GlobalUbo{
-    mat4 projection;
-    mat4 view;
-    mat4 invView;
-    vec4 ambientLightColor; // w as intensity
-    PointLight pointLights[10];
-    int numLights;
-} ubo;
-
-layout (push_constant) uniform Push{
-  vec4 position;
-  vec4 color;
-  float radius;
-} push;
-
 const float M_PI = 3.14159265358979;
 
 void main(){
     float dis = sqrt(dot(fragOffset, fragOffset));
-    if (dis >= push.radius){
+    if (dis >= fragRadius){
         discard;
     }
-    float cosDis = 0.5 * (cos(dis / push.radius * M_PI) + 1.0);
-    outColor = vec4(push.color.xyz + cosDis * 0.5, cosDis);
-}
\ No newline at end of file
+    float cosDis = 0.5 * (cos(dis / fragRadius * M_PI) + 1.0);
+    outColor = vec4(fragColor.xyz + cosDis * 0.5, cosDis);
+}
@@ -1,4 +1,5 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
 layout (location = 0) in vec3 fragColor;
 layout (location = 1) in vec3 fragPosWorld;
@@ -8,7 +9,7 @@ layout (location = 3) in vec2 fragTexCoord;
 layout (location = 0) out vec4 outColor;
 
 struct PointLight{
-  vec4 position; // ignore w
+  vec4 position; // w as radius of influence
   vec4 color; // w as intensity
 };
 
@@ -17,11 +18,28 @@ layout (set = 0, binding = 0) uniform GlobalUbo{
     mat4 view;
     mat4 invView;
     vec4 ambientLightColor; // w as intensity
-    PointLight pointLights[10];
-    int numLights;
+    uvec4 clusterCounts; // xyz: cluster grid dimension, w: number of lights
+    vec4 clusterDepthParams; // x: near, y: far, z: slice scale, w: slice bias
+    vec4 screenSize; // xy: render target size, zw: 1 / size
 } ubo;
 
-layout (set = 1, binding = 0) uniform sampler2D texSampler;
+layout (std430, set = 0, binding = 1) readonly buffer LightSSBO{
+    PointLight lights[];
+};
+// light count per cluster
+layout (std430, set = 0, binding = 2) readonly buffer ClusterGridSSBO{
+    uint clusterLightCounts[];
+};
+layout (std430, set = 0, binding = 3) readonly buffer ClusterIndexSSBO{
+    uint clusterLightIndices[];
+};
+
+// specialized by SimpleRenderSystem, defaults only for reference.
+layout (constant_id = 0) const float SPECULAR_EXPONENT = 128.0;
+layout (constant_id = 1) const uint MAX_LIGHTS_PER_CLUSTER = 128;
+
+// bindless texture array, indexed per draw
+layout (set = 1, binding = 0) uniform sampler2D textures[];
 
 layout (push_constant) uniform Push{
 	mat4 modelMatrix; 
@@ -38,10 +56,24 @@ void main() {
   vec3 cameraPosWorld = ubo.invView[3].xyz;
   vec3 viewDirection = normalize(cameraPosWorld - fragPosWorld);
 
-  for (int i = 0; i < ubo.numLights; i++){
-    PointLight light = ubo.pointLights[i];
+  // find cluster of this fragment (screen tile + exponential depth slice)
+  float viewDepth = (ubo.view * vec4(fragPosWorld, 1.0)).z;
+  uvec3 cluster;
+  cluster.xy = uvec2(gl_FragCoord.xy * ubo.screenSize.zw * vec2(ubo.clusterCounts.xy));
+  cluster.z = uint(max(log(viewDepth) * ubo.clusterDepthParams.z - ubo.clusterDepthParams.w, 0.0));
+  cluster = min(cluster, ubo.clusterCounts.xyz - uvec3(1));
+  uint clusterIndex = cluster.x + ubo.clusterCounts.x * (cluster.y + ubo.clusterCounts.y * cluster.z);
+
+  uint lightCount = clusterLightCounts[clusterIndex];
+  uint lightBase = clusterIndex * MAX_LIGHTS_PER_CLUSTER;
+  for (uint i = 0; i < lightCount; i++){
+    PointLight light = lights[clusterLightIndices[lightBase + i]];
     vec3 directionToLight = light.position.xyz - fragPosWorld;
-    float attenuation = 1.0 / dot(directionToLight, directionToLight); // distance squared
+    float distSquared = dot(directionToLight, directionToLight);
+    // smooth window to zero at the cull radius, otherwise cluster edges pop.
+    float distRatio = distSquared / (light.position.w * light.position.w);
+    float window = clamp(1.0 - distRatio * distRatio, 0.0, 1.0);
+    float attenuation = window * window / distSquared;
     directionToLight = normalize(directionToLight);
     
     float cosAngIncidence =  max(dot(surfaceNormal, directionToLight), 0);
@@ -54,11 +86,16 @@ void main() {
     // to ignore the case when viewer and light are on a opposite site
     float blinnTerm = dot(surfaceNormal, halfAngle);
     blinnTerm = clamp(blinnTerm, 0, 1);
-    blinnTerm = pow(blinnTerm, 128.0);
+    blinnTerm = pow(blinnTerm, SPECULAR_EXPONENT);
     specularLight += intensity * blinnTerm;
   }
   
-  vec3 texColor = texture(texSampler, fragTexCoord * 1.0).rgb;
+  // NOTE: texture index is packed in the unused column of normal matrix.
+  int textureIndex = int(push.normalMatrix[3][0]);
+  vec3 texColor = vec3(1.0);
+  if (textureIndex >= 0) {
+    texColor = texture(textures[textureIndex], fragTexCoord * 1.0).rgb;
+  }
   outColor = vec4(diffuseLight * texColor + specularLight * texColor, 1.0);
   
 }
\ No newline at end of file
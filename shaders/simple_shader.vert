@@ -10,18 +10,18 @@ layout (location = 1) out vec3 fragPosWorld;
 layout (location = 2) out vec3 fragNormalWorld;
 layout (location = 3) out vec2 fragTexCoord;
 
-struct PointLight{
-  vec4 position; // ignore w
-  vec4 color; // w as intensity
-};
+// NOTE: must produce bit identical depth with depth_prepass.vert
+// (main pass uses EQUAL depth compare after the pre-pass).
+invariant gl_Position;
 
 layout (set = 0, binding = 0) uniform GlobalUbo{
     mat4 projection;
     mat4 view;
     mat4 invView;
     vec4 ambientLightColor; // w as intensity
-    PointLight pointLights[10];
-    int numLights;
+    uvec4 clusterCounts; // xyz: cluster grid dimension, w: number of lights
+    vec4 clusterDepthParams; // x: near, y: far, z: slice scale, w: slice bias
+    vec4 screenSize; // xy: render target size, zw: 1 / size
 } ubo;
 
 layout (push_constant) uniform Push{
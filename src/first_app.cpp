@@ -4,9 +4,17 @@
 #include "keyboard_movement_controller.hpp"
 #include "lve_buffer.hpp"
 #include "lve_camera.hpp"
+#include "lve_cpu_profiler.hpp"
 #include "lve_descriptors.hpp"
+#include "lve_dynamic_resolution.hpp"
+#include "lve_fixed_timestep.hpp"
+#include "lve_gpu_profiler.hpp"
 #include "lve_model.hpp"
+#include "lve_render_graph.hpp"
+#include "systems/clustered_light_system.hpp"
 #include "systems/compute_particle_system.hpp"
+#include "systems/cpu_particle_integrator.hpp"
+#include "systems/gravity_body_system.hpp"
 #include "systems/point_light_system.hpp"
 #include "systems/simple_render_system.hpp"
 #include "tut_texture.hpp"
@@ -18,44 +26,37 @@
 #include <glm/gtc/constants.hpp>
 
 // std
+#include <algorithm>
 #include <array>
 #include <chrono>
+#include <cstdio>
 #include <iostream>
 #include <memory>
 #include <stdexcept>
 
 namespace lve {
 
-FirstApp::FirstApp() {
+FirstApp::FirstApp(const LveConfig &config) : config{config} {
+  uint32_t framesInFlight = frameContext.getFramesInFlight();
   globalPool =
       LveDescriptorPool::Builder(lveDevice)
-          .setMaxSets(LveSwapChain::MAX_FRAMES_IN_FLIGHT * 5 + maxObjectNum)
-          .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-                       LveSwapChain::MAX_FRAMES_IN_FLIGHT * 3)
-          .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, maxObjectNum)
-          .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
-                       LveSwapChain::MAX_FRAMES_IN_FLIGHT * 2)
+          .setMaxSets(framesInFlight * 7)
+          .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, framesInFlight * 5)
+          // particles 9 + lights, cluster grid, cluster indices 3
+          // + gravity 2 sets of 4
+          .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, framesInFlight * 20)
           .build();
 
-  loadGameObjects();
-  int texture_obj_num = 0;
-  for (const auto &kv : gameObjects) {
-    auto &obj = kv.second;
-    if (obj.model == nullptr) {
-      continue;
-    }
-    texture_obj_num++;
+  {
+    LVE_PROFILE_SCOPE("loadGameObjects");
+    loadGameObjects();
   }
-  std::cout << "object num: " << texture_obj_num << " < " << maxObjectNum
-            << std::endl;
-
-  assert(texture_obj_num < maxObjectNum);
 }
 FirstApp::~FirstApp() {}
 
 void FirstApp::run() {
   std::vector<std::unique_ptr<LveBuffer>> uboBuffers(
-      LveSwapChain::MAX_FRAMES_IN_FLIGHT);
+      frameContext.getFramesInFlight());
   for (int i = 0; i < uboBuffers.size(); i++) {
     // VK_MEMORY_PROPERTY_HOST_COHERENT_BIT 를 쓰면 flush 신경 안써도 됨.
     uboBuffers[i] = std::make_unique<LveBuffer>(
@@ -64,24 +65,29 @@ void FirstApp::run() {
     uboBuffers[i]->map();
   }
 
-  auto globalSetLayout = LveDescriptorSetLayout::Builder(lveDevice)
-                             .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-                                         VK_SHADER_STAGE_ALL_GRAPHICS)
-                             .build();
-  auto objectSetLayout =
+  // NOTE: compute stage for light clustering pass.
+  auto globalSetLayout =
       LveDescriptorSetLayout::Builder(lveDevice)
-          .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                      VK_SHADER_STAGE_FRAGMENT_BIT)
+          .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                      VK_SHADER_STAGE_ALL_GRAPHICS | VK_SHADER_STAGE_COMPUTE_BIT)
+          // lights
+          .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                      VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT)
+          // cluster light counts
+          .addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                      VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT)
+          // cluster light indices
+          .addBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                      VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT)
           .build();
-
-  std::vector<VkDescriptorSet> globalDescriptorSets(
-      LveSwapChain::MAX_FRAMES_IN_FLIGHT);
-  for (int i = 0; i < globalDescriptorSets.size(); i++) {
-    auto bufferInfo = uboBuffers[i]->descriptorInfo();
-    LveDescriptorWriter(*globalSetLayout, *globalPool)
-        .writeBuffer(0, &bufferInfo)
-        .build(globalDescriptorSets[i]);
-  }
+  ClusteredLightSystem clusteredLightSystem{
+      lveDevice,
+      frameContext,
+      globalSetLayout->getDescriptorSetLayout(),
+      pipelineCompiler,
+  };
+  // textures are no longer limited by per object descriptor sets.
+  LveTextureRegistry textureRegistry{lveDevice};
 
   // User sampler that only dependent on mipLevels
   // to avoid move or copy constructor, use unique_ptr
@@ -95,7 +101,7 @@ void FirstApp::run() {
     auto &model = obj.model;
 
     // to avoid duplicated resource for shared models.
-    if (model->textureDescriptorSet != VK_NULL_HANDLE) {
+    if (model->textureIndex != LveTextureRegistry::INVALID_INDEX) {
       continue;
     }
     // skip for game objects that not havine texture images.
@@ -109,34 +115,182 @@ void FirstApp::run() {
           std::make_unique<tut::TutTexture>(lveDevice, mipLevels);
     }
 
-    VkDescriptorImageInfo imageInfo{};
-    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    imageInfo.imageView = model->getTextureImageView();
-    imageInfo.sampler = mipMipSamplers[mipLevels]->getTextureSampler();
-    LveDescriptorWriter(*objectSetLayout, *globalPool)
-        .writeImage(0, &imageInfo)
-        .build(model->textureDescriptorSet);
+    model->textureIndex = textureRegistry.registerTexture(
+        model->getTextureImageView(),
+        mipMipSamplers[mipLevels]->getTextureSampler());
   }
 
   std::cout << "Mipmap Sampler Num : " << mipMipSamplers.size() << std::endl;
+  std::cout << "Bindless Texture Num : " << textureRegistry.getRegisteredCount()
+            << " / " << LveTextureRegistry::MAX_TEXTURES << std::endl;
 
   SimpleRenderSystem simpleRenderSystem{
       lveDevice,
       lveRenderer.getSwapChainRenderPass(),
       globalSetLayout->getDescriptorSetLayout(),
-      objectSetLayout->getDescriptorSetLayout(),
+      textureRegistry,
+      threadPool,
+      pipelineCompiler,
   };
+  simpleRenderSystem.setDepthPrePass(useDepthPrePass);
   PointLightSystem pointLightSystem{
       lveDevice,
+      frameContext,
       lveRenderer.getSwapChainRenderPass(),
       globalSetLayout->getDescriptorSetLayout(),
+      pipelineCompiler,
   };
 
   tut::ComputeParticleSystem computeParticleSystem{
       lveDevice,
+      frameContext,
       lveRenderer.getSwapChainRenderPass(),
       *globalPool,
+      pipelineCompiler,
+      config.particleCapacity,
   };
+  if (config.particleBenchmark || config.validateParticles) {
+    // every slot alive for the whole run, the simulation sees the full pool.
+    tut::ParticleEmitter filler{};
+    filler.maxRadius = 1.f;
+    filler.lifetime = 1e9f;
+    auto fillerId = computeParticleSystem.addEmitter(filler);
+    computeParticleSystem.burst(fillerId, config.particleCapacity);
+  } else {
+    // rainbow ring around the center, bounced by the window border.
+    tut::ParticleEmitter fountain{};
+    fountain.minRadius = .1f;
+    fountain.maxRadius = .15f;
+    fountain.rate = 4096.f;
+    fountain.lifetime = 4.f;
+    fountain.lifetimeVariance = 1.f;
+    auto fountainId = computeParticleSystem.addEmitter(fountain);
+    computeParticleSystem.burst(fountainId,
+                                std::min(config.particleCapacity / 4, 8192u));
+  }
+
+  // --gravity-bodies: n-body cluster above the vases.
+  std::unique_ptr<kc_bonus::GravityBodySystem> gravityBodySystem;
+  if (config.gravityBodies > 0) {
+    kc_bonus::GravityBodySystem::Settings gravitySettings{};
+    gravitySettings.backend = config.gravityOnGpu
+                                  ? kc_bonus::GravityBodySystem::Backend::GPU
+                                  : kc_bonus::GravityBodySystem::Backend::CPU;
+    gravityBodySystem = std::make_unique<kc_bonus::GravityBodySystem>(
+        lveDevice, frameContext, lveRenderer.getSwapChainRenderPass(),
+        globalSetLayout->getDescriptorSetLayout(), *globalPool,
+        pipelineCompiler, threadPool,
+        kc_bonus::createClusterBodies(config.gravityBodies, .5f,
+                                      {0.f, -1.5f, 0.f}),
+        gravitySettings);
+    if (config.validateGravity) {
+      // NOTE: the gpu takes inversesqrt, close pairs drift apart slowly.
+      // 1% of the distance moved.
+      auto comparison = gravityBodySystem->validate(16, 1.f / 60.f, 1e-2f);
+      std::cout << "gravity validation: " << comparison.count << " bodies, "
+                << comparison.mismatchCount << " mismatches, max error "
+                << comparison.maxPositionError << ", rms error "
+                << comparison.rmsPositionError << ", max relative error "
+                << comparison.maxRelativeError << std::endl;
+      if (comparison.mismatchCount > 0) validationFailed = true;
+    }
+  }
+
+  // frame graph of the graphics command buffer. barriers between passes are
+  // derived from the declared reads and writes.
+  // NOTE: particle simulation is submitted separately to the compute queue
+  // and synchronized by the timeline semaphores.
+  LveRenderGraph renderGraph{lveDevice, frameContext};
+  auto globalUboResource = renderGraph.importResource("global_ubo");
+  auto lightResource = renderGraph.importResource("lights");
+  auto particleResource = renderGraph.importResource("particles");
+  auto gravityResource = renderGraph.importResource("gravity_bodies");
+  auto swapChainResource = renderGraph.importResource("swap_chain");
+
+  clusteredLightSystem.addClusterPass(renderGraph, globalUboResource,
+                                      lightResource);
+  renderGraph.addPass(
+      "forward",
+      [&](LveRenderGraph::PassBuilder &pass) {
+        VkPipelineStageFlags shaderStages =
+            VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        pass.read(globalUboResource, shaderStages, VK_ACCESS_UNIFORM_READ_BIT)
+            .read(lightResource, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                  VK_ACCESS_SHADER_READ_BIT)
+            .read(clusteredLightSystem.getClusterGrid(),
+                  VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                  VK_ACCESS_SHADER_READ_BIT)
+            .read(clusteredLightSystem.getClusterIndex(),
+                  VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                  VK_ACCESS_SHADER_READ_BIT)
+            .read(particleResource,
+                  VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT |
+                      VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                  VK_ACCESS_INDIRECT_COMMAND_READ_BIT |
+                      VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT)
+            .read(gravityResource, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                  VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT)
+            .write(swapChainResource,
+                   VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                   VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+      },
+      [&](FrameInfo &frameInfo) {
+        // NOTE: separate frame and renderpass, since we need to control
+        // multiple render passes.
+        lveRenderer.beginSwapChainRenderPass(
+            frameInfo.commandBuffer,
+            VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+        // order matters
+        // objects are recorded in parallel by the thread pool.
+        simpleRenderSystem.renderGameObjects(frameInfo, lveRenderer);
+
+        // transparent passes are cheap, record them on main thread.
+        auto secondaryCommandBuffer =
+            lveRenderer.beginSecondaryCommandBuffer(0);
+        FrameInfo secondaryFrameInfo{
+            frameInfo.frameIndex,
+            frameInfo.frameTime,
+            secondaryCommandBuffer,
+            frameInfo.camera,
+            frameInfo.globalDescriptorSet,
+            frameInfo.gameObjects,
+            frameInfo.gpuProfiler,
+            frameInfo.tickCount,
+            frameInfo.tickTime,
+            frameInfo.interpolation,
+        };
+        pointLightSystem.render(secondaryFrameInfo);
+        // render particles
+        computeParticleSystem.renderParticles(secondaryFrameInfo);
+        if (gravityBodySystem) {
+          gravityBodySystem->renderBodies(secondaryFrameInfo);
+        }
+        lveRenderer.endSecondaryCommandBuffer(secondaryCommandBuffer);
+        vkCmdExecuteCommands(frameInfo.commandBuffer, 1,
+                             &secondaryCommandBuffer);
+
+        lveRenderer.endSwapChainRenderPass(frameInfo.commandBuffer);
+      });
+  renderGraph.compile();
+
+  std::vector<VkDescriptorSet> globalDescriptorSets(
+      frameContext.getFramesInFlight());
+  for (int i = 0; i < globalDescriptorSets.size(); i++) {
+    auto bufferInfo = uboBuffers[i]->descriptorInfo();
+    auto lightBufferInfo = clusteredLightSystem.lightBufferInfo(i);
+    auto clusterGridInfo =
+        renderGraph.bufferInfo(clusteredLightSystem.getClusterGrid(), i);
+    auto clusterIndexInfo =
+        renderGraph.bufferInfo(clusteredLightSystem.getClusterIndex(), i);
+    LveDescriptorWriter(*globalSetLayout, *globalPool)
+        .writeBuffer(0, &bufferInfo)
+        .writeBuffer(1, &lightBufferInfo)
+        .writeBuffer(2, &clusterGridInfo)
+        .writeBuffer(3, &clusterIndexInfo)
+        .build(globalDescriptorSets[i]);
+  }
 
   LveCamera camera{};
   // camera.setViewDirection(glm::vec3{0.f}, glm::vec3{0.5f, 0.f, 1.f});
@@ -146,10 +300,45 @@ void FirstApp::run() {
   viewerObject.transform.translation.z = -10.5f;
   KeyBoardMovementController cameraController{};
 
-  auto currentTime = std::chrono::high_resolution_clock::now();
-  float MAX_FRAME_TIME = 0.1f;
+  // simulation runs in fixed ticks, independent of the frame rate.
+  LveFixedTimestep::Settings timestepSettings{};
+  timestepSettings.tickRate = config.tickRate;
+  timestepSettings.maxTicksPerFrame = config.maxTicksPerFrame;
+  LveFixedTimestep timestep{timestepSettings};
+  float tickTime = timestep.getTickTime();
+  // lights start on their orbit, not at the origin.
+  pointLightSystem.tick(gameObjects, 0.f);
+  for (auto &kv : gameObjects) {
+    kv.second.previousTransform = kv.second.transform;
+  }
+  viewerObject.previousTransform = viewerObject.transform;
+
+  auto startTime = std::chrono::high_resolution_clock::now();
+  auto currentTime = startTime;
+  // one per queue, the frame slots are waited on separately.
+  LveGpuProfiler graphicsProfiler{lveDevice, frameContext, "graphics"};
+  LveGpuProfiler computeProfiler{lveDevice, frameContext, "compute"};
+  LveDynamicResolution::Settings resolutionSettings{};
+  resolutionSettings.targetMs = config.gpuBudgetMs;
+  resolutionSettings.minScale = config.minRenderScale;
+  LveDynamicResolution dynamicResolution{resolutionSettings};
+  if (dynamicResolution.isEnabled() && !graphicsProfiler.isEnabled()) {
+    std::cout << "no gpu timestamps, dynamic resolution disabled"
+              << std::endl;
+  }
+  float gpuTimeLogElapsed = 0.f;
+  // --validate-particles: pool before the simulate step of the next frame.
+  const uint32_t PARTICLE_VALIDATION_FRAME = 8;
+  tut::ParticleSoa validationParticles{};
+  uint32_t frameNumber = 0;
   while (!lveWindow.shouldClose()) {
-    glfwPollEvents();
+    if (config.frameCount > 0 && frameNumber >= config.frameCount) break;
+    LVE_PROFILE_SCOPE("frame");
+    {
+      LVE_PROFILE_SCOPE("input");
+      if (!config.headless) glfwPollEvents();
+      lveRenderer.getLatencyTracker().markInput();
+    }
 
     auto newTime = std::chrono::high_resolution_clock::now();
     float frameTime =
@@ -158,70 +347,228 @@ void FirstApp::run() {
             .count();
 
     currentTime = newTime;
-    frameTime = glm::min(frameTime, MAX_FRAME_TIME);
-
-    cameraController.moveInPlaneXZ(lveWindow.getGLFWwindow(), frameTime,
-                                   viewerObject);
-    camera.setViewYXZ(viewerObject.transform.translation,
-                      viewerObject.transform.rotation);
-
-    float aspect = lveRenderer.getAspectRatio();
-    camera.setPerspectiveProjection(glm::radians(50.f), aspect, 0.1f, 100.f);
+    // NOTE: headless runs take exactly one tick per frame so captured frames
+    // are reproducible.
+    if (config.headless) frameTime = tickTime;
+    uint32_t tickCount = timestep.advance(frameTime);
+    float interpolation = timestep.getInterpolation();
+    // simulated time of this frame
+    float simulationTime = tickCount * tickTime;
+    {
+      LVE_PROFILE_SCOPE("simulation_tick");
+      for (uint32_t tick = 0; tick < tickCount; tick++) {
+        viewerObject.previousTransform = viewerObject.transform;
+        for (auto &kv : gameObjects) {
+          kv.second.previousTransform = kv.second.transform;
+        }
+        if (!config.headless) {
+          cameraController.moveInPlaneXZ(lveWindow.getGLFWwindow(), tickTime,
+                                         viewerObject);
+        }
+        pointLightSystem.tick(gameObjects, tickTime);
+      }
+    }
+    {
+      LVE_PROFILE_SCOPE("camera_update");
+      auto viewerTransform =
+          viewerObject.getInterpolatedTransform(interpolation);
+      camera.setViewYXZ(viewerTransform.translation, viewerTransform.rotation);
+
+      float aspect = lveRenderer.getAspectRatio();
+      camera.setPerspectiveProjection(glm::radians(50.f), aspect, 0.1f,
+                                      100.f);
+    }
 
     if (auto computeCommandBuffer = lveRenderer.beginComputeFrame()) {
+      LVE_PROFILE_SCOPE("compute_record");
       int frameIndex = lveRenderer.getFrameIndex();
       LveGameObject::Map dummyGameObjects;
       FrameInfo frameInfo{
-          frameIndex, frameTime,      computeCommandBuffer,
-          camera,     VK_NULL_HANDLE, dummyGameObjects,
+          frameIndex,       simulationTime, computeCommandBuffer,
+          camera,           VK_NULL_HANDLE, dummyGameObjects,
+          &computeProfiler, tickCount,      tickTime,
+          interpolation,
       };
+      computeProfiler.beginFrame(frameIndex);
 
       // update ubo
       computeParticleSystem.updateUbo(frameInfo);
       computeParticleSystem.computeParticles(frameInfo);
+      if (gravityBodySystem) gravityBodySystem->computeBodies(frameInfo);
 
       lveRenderer.endComputeFrame();
     }
 
     if (auto commandBuffer = lveRenderer.beginFrame()) {
       int frameIndex = lveRenderer.getFrameIndex();
+      textureRegistry.nextFrame();
 
       FrameInfo frameInfo{
           frameIndex,
-          frameTime,
+          simulationTime,
           commandBuffer,
           camera,
           globalDescriptorSets[frameIndex],
           gameObjects,
+          &graphicsProfiler,
+          tickCount,
+          tickTime,
+          interpolation,
       };
+      graphicsProfiler.beginFrame(frameIndex);
+      // results of this frame slot just came in, applies to the next frame.
+      lveRenderer.setRenderScale(dynamicResolution.update(
+          graphicsProfiler.getLastMs("gpu_frame")));
 
       // update
-      GlobalUbo ubo{};
-      ubo.projection = camera.getProjection();
-      ubo.view = camera.getView();
-      ubo.inverseView = camera.getInverseView();
-      pointLightSystem.update(frameInfo, ubo);
-
-      uboBuffers[frameIndex]->writeToBuffer(&ubo);
-      // since not coherent.
-      uboBuffers[frameIndex]->flush();
-
-      // render
-      // NOTE: separate frame and renderpass, since we need to control
-      // multiple render passes.
-      lveRenderer.beginSwapChainRenderPass(commandBuffer);
-
-      // order matters
-      simpleRenderSystem.renderGameObjects(frameInfo);
-      pointLightSystem.render(frameInfo);
-      // render particles
-      computeParticleSystem.renderParticles(frameInfo);
-
-      lveRenderer.endSwapChainRenderPass(commandBuffer);
+      {
+        LVE_PROFILE_SCOPE("ubo_update");
+        GlobalUbo ubo{};
+        ubo.projection = camera.getProjection();
+        ubo.view = camera.getView();
+        ubo.inverseView = camera.getInverseView();
+        clusteredLightSystem.updateUbo(ubo, camera,
+                                       lveRenderer.getRenderExtent());
+        pointLightSystem.update(
+            frameInfo, ubo, clusteredLightSystem.getLightBuffer(frameIndex));
+
+        uboBuffers[frameIndex]->writeToBuffer(&ubo);
+        // since not coherent.
+        uboBuffers[frameIndex]->flush();
+      }
+      if (gravityBodySystem) {
+        LVE_PROFILE_SCOPE("gravity_update");
+        gravityBodySystem->update(frameInfo);
+      }
+
+      {
+        LVE_PROFILE_SCOPE("record");
+        LveGpuProfiler::Scope gpuFrameScope{frameInfo, "gpu_frame"};
+        // particles come from the compute queue (ownership transfer).
+        computeParticleSystem.acquireParticles(frameInfo);
+        if (gravityBodySystem) gravityBodySystem->acquireBodies(frameInfo);
+        // light binning -> forward, barriers from the render graph.
+        renderGraph.execute(frameInfo);
+      }
       lveRenderer.endFrame();
+      frameNumber++;
+
+      if (config.validateParticles &&
+          (frameNumber == PARTICLE_VALIDATION_FRAME ||
+           frameNumber == PARTICLE_VALIDATION_FRAME + 1)) {
+        vkDeviceWaitIdle(lveDevice.device());
+        if (frameNumber == PARTICLE_VALIDATION_FRAME) {
+          computeParticleSystem.readbackPool(validationParticles);
+        } else {
+          tut::ParticleSoa gpuParticles{};
+          computeParticleSystem.readbackPool(gpuParticles);
+          tut::CpuParticleIntegrator integrator{&threadPool};
+          // one step per tick, like the simulate kernel.
+          for (uint32_t tick = 0;
+               tick < computeParticleSystem.getLastTickCount(); tick++) {
+            integrator.integrate(validationParticles,
+                                 computeParticleSystem.getLastTickTime());
+          }
+          // NOTE: the gpu may fuse multiply add, a particle crossing the
+          // border by less than that can flip its velocity differently.
+          auto comparison = tut::CpuParticleIntegrator::compare(
+              validationParticles, gpuParticles, 4, 1e-6f);
+          std::cout << "particle validation: " << comparison.count
+                    << " particles, " << comparison.mismatchCount
+                    << " mismatches, max ulp " << comparison.maxUlp
+                    << ", max abs error " << comparison.maxAbsError
+                    << std::endl;
+          if (comparison.mismatchCount > 0) validationFailed = true;
+        }
+      }
+
+      if (!config.captureDir.empty() &&
+          frameNumber % config.captureEvery == 0) {
+        char fileName[32];
+        std::snprintf(fileName, sizeof(fileName), "/frame_%05u.ppm",
+                      frameNumber);
+        lveRenderer.saveLastFrame(config.captureDir + fileName);
+      }
+
+      gpuTimeLogElapsed += frameTime;
+      if (gpuTimeLogElapsed > 1.f) {
+        gpuTimeLogElapsed = 0.f;
+        if (dynamicResolution.isEnabled()) {
+          std::cout << "render scale: " << dynamicResolution.getScale()
+                    << std::endl;
+        }
+        if (config.particleBenchmark) {
+          std::cout << "particles: " << computeParticleSystem.getLiveCount()
+                    << " live" << std::endl;
+        }
+        for (auto profiler : {&graphicsProfiler, &computeProfiler}) {
+          if (!config.gpuStats || !profiler->isEnabled()) continue;
+          std::cout << profiler->getQueueName() << " gpu:";
+          for (auto &name : profiler->getScopeNames()) {
+            auto stats = profiler->getStats(name);
+            std::cout << " " << name << " " << stats.averageMs << " ms (p95 "
+                      << stats.p95Ms << ")";
+          }
+          std::cout << std::endl;
+        }
+      }
     }
   }
   vkDeviceWaitIdle(lveDevice.device());
+
+  if (frameNumber > 0) {
+    float elapsedMs =
+        std::chrono::duration<float, std::chrono::milliseconds::period>(
+            std::chrono::high_resolution_clock::now() - startTime)
+            .count();
+    std::cout << frameNumber << " frames, avg "
+              << elapsedMs / static_cast<float>(frameNumber) << " ms/frame"
+              << std::endl;
+  }
+  std::cout << timestep.getTickCount() << " ticks at " << config.tickRate
+            << " Hz, " << timestep.getDroppedTime() << " s dropped"
+            << std::endl;
+
+  if (config.particleBenchmark) {
+    // NOTE: median, the first frames also emit the whole pool.
+    float simulateMs = computeProfiler.getStats("particles_simulate").p50Ms;
+    uint32_t liveCount = computeParticleSystem.getLiveCount();
+    if (simulateMs > 0.f) {
+      float particlesPerSecond = liveCount / (simulateMs * 1e-3f);
+      std::cout << "particle benchmark: " << liveCount << " live, simulate "
+                << simulateMs << " ms, " << particlesPerSecond * 1e-6f
+                << " M particles/s, "
+                << particlesPerSecond *
+                       tut::ComputeParticleSystem::SIMULATE_BYTES_PER_PARTICLE *
+                       1e-9f
+                << " GB/s ("
+                << tut::ComputeParticleSystem::SIMULATE_BYTES_PER_PARTICLE
+                << " B/particle)" << std::endl;
+    } else {
+      std::cout << "particle benchmark: no gpu timestamps" << std::endl;
+    }
+  }
+
+  auto &latencyTracker = lveRenderer.getLatencyTracker();
+  std::cout << "frames in flight: " << frameContext.getFramesInFlight()
+            << std::endl;
+  std::cout << "present mode: "
+            << LveConfig::presentModeName(lveRenderer.getPresentMode())
+            << ", avg input to present latency: "
+            << latencyTracker.getAverageLatencyMs() << " ms" << std::endl;
+  if (!config.latencyCsv.empty()) {
+    latencyTracker.writeCsv(
+        config.latencyCsv,
+        LveConfig::presentModeName(lveRenderer.getPresentMode()));
+  }
+  if (!config.cpuTrace.empty()) {
+    if (LveCpuProfiler::ENABLED) {
+      LveCpuProfiler::writeChromeTrace(config.cpuTrace);
+    } else {
+      std::cout << "cpu profiler compiled out (LVE_ENABLE_PROFILER=OFF)"
+                << std::endl;
+    }
+  }
 }
 
 void FirstApp::loadGameObjects() {
@@ -1,9 +1,13 @@
 #pragma once
 
+#include "lve_config.hpp"
 #include "lve_descriptors.hpp"
+#include "lve_frame_context.hpp"
 #include "lve_device.hpp"
 #include "lve_game_object.hpp"
+#include "lve_pipeline_compiler.hpp"
 #include "lve_renderer.hpp"
+#include "lve_thread_pool.hpp"
 #include "lve_window.hpp"
 // std
 #include <memory>
@@ -12,26 +16,41 @@
 namespace lve {
 class FirstApp {
  public:
-  static constexpr int WIDTH = 640;
-  static constexpr int HEIGHT = 440;
-  FirstApp();
+  explicit FirstApp(const LveConfig &config = LveConfig{});
   ~FirstApp();
 
   FirstApp(const FirstApp &) = delete;
   FirstApp &operator=(const FirstApp &) = delete;
 
   void run();
+  // --validate-particles, --validate-gravity: set when a check failed, main
+  // exits with a failure code.
+  bool hasFailedValidation() const { return validationFailed; }
 
  private:
   void loadGameObjects();
 
-  LveWindow lveWindow{WIDTH, HEIGHT, "Hello Vulkan! ckc!"};
+  // NOTE: must be declared first, the members below are built from it.
+  LveConfig config;
+  // sizes every per frame resource below.
+  LveFrameContext frameContext{config.framesInFlight};
+  LveWindow lveWindow{static_cast<int>(config.width),
+                      static_cast<int>(config.height), "Hello Vulkan! ckc!",
+                      config.headless};
   LveDevice lveDevice{lveWindow};
-  LveRenderer lveRenderer{lveWindow, lveDevice};
+  // NOTE: thread pool must be declared before renderer(record thread count).
+  LveThreadPool threadPool{};
+  LveRenderer lveRenderer{
+      lveWindow, lveDevice, frameContext, threadPool.getThreadCount(),
+      PresentSettings{config.presentMode, config.swapImageCount}};
+  // builds pipelines on the thread pool while the scene is loading.
+  LvePipelineCompiler pipelineCompiler{lveDevice, threadPool};
 
   // NOTE: order or declarations matter (device -> descriptor pool)
   std::unique_ptr<LveDescriptorPool> globalPool{};
   LveGameObject::Map gameObjects;
-  int maxObjectNum = 10;
+  // scene setting. worth it when the scene has a lot of overdraw.
+  bool useDepthPrePass = true;
+  bool validationFailed = false;
 };
 }  // namespace lve
\ No newline at end of file
@@ -0,0 +1,187 @@
+#include "kc_barnes_hut.hpp"
+
+// std
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <numeric>
+
+namespace kc_bonus {
+
+uint64_t BarnesHutTree::expandBits(uint32_t value) {
+  // spreads 21 bits to every third bit.
+  uint64_t x = value & 0x1fffff;
+  x = (x | x << 32) & 0x1f00000000ffffull;
+  x = (x | x << 16) & 0x1f0000ff0000ffull;
+  x = (x | x << 8) & 0x100f00f00f00f00full;
+  x = (x | x << 4) & 0x10c30c30c30c30c3ull;
+  x = (x | x << 2) & 0x1249249249249249ull;
+  return x;
+}
+
+void BarnesHutTree::build(const std::vector<glm::vec3> &positions,
+                          const std::vector<float> &masses) {
+  assert(positions.size() == masses.size() && "Mismatched body arrays.");
+  nodes.clear();
+  uint32_t bodyCount = static_cast<uint32_t>(positions.size());
+  sortedBodies.resize(bodyCount);
+  if (bodyCount == 0) return;
+
+  // bounding cube
+  glm::vec3 minCorner = positions[0];
+  glm::vec3 maxCorner = positions[0];
+  for (auto &position : positions) {
+    minCorner = glm::min(minCorner, position);
+    maxCorner = glm::max(maxCorner, position);
+  }
+  glm::vec3 extent = maxCorner - minCorner;
+  // NOTE: slightly larger, so the max corner still quantizes in range.
+  float size = std::max({extent.x, extent.y, extent.z, 1e-6f}) * 1.0001f;
+
+  // morton order
+  const float scale = static_cast<float>(1u << MAX_DEPTH) / size;
+  std::vector<uint64_t> codes(bodyCount);
+  for (uint32_t i = 0; i < bodyCount; i++) {
+    glm::uvec3 cell = glm::uvec3(glm::clamp(
+        (positions[i] - minCorner) * scale, glm::vec3{0.f},
+        glm::vec3{static_cast<float>((1u << MAX_DEPTH) - 1)}));
+    codes[i] = expandBits(cell.x) | expandBits(cell.y) << 1 |
+               expandBits(cell.z) << 2;
+  }
+  std::iota(sortedBodies.begin(), sortedBodies.end(), 0);
+  std::sort(sortedBodies.begin(), sortedBodies.end(),
+            [&](uint32_t a, uint32_t b) { return codes[a] < codes[b]; });
+  sortedCodes.resize(bodyCount);
+  sortedPositions.resize(bodyCount);
+  sortedMasses.resize(bodyCount);
+  for (uint32_t i = 0; i < bodyCount; i++) {
+    sortedCodes[i] = codes[sortedBodies[i]];
+    sortedPositions[i] = positions[sortedBodies[i]];
+    sortedMasses[i] = masses[sortedBodies[i]];
+  }
+
+  // top down: a node at level L splits its range by the L-th octal digit.
+  // children are appended together, so they are always after their parent.
+  struct Pending {
+    uint32_t node;
+    uint32_t level;
+  };
+  std::vector<Pending> pending;
+  Node root{};
+  root.center = minCorner + glm::vec3{size * .5f};
+  root.halfSize = size * .5f;
+  root.firstBody = 0;
+  root.bodyCount = bodyCount;
+  nodes.push_back(root);
+  pending.push_back({0, 0});
+  while (!pending.empty()) {
+    Pending current = pending.back();
+    pending.pop_back();
+    Node node = nodes[current.node];
+    if (node.bodyCount <= LEAF_SIZE || current.level == MAX_DEPTH) continue;
+
+    uint32_t shift = 3 * (MAX_DEPTH - 1 - current.level);
+    auto first = sortedCodes.begin() + node.firstBody;
+    auto last = first + node.bodyCount;
+    uint32_t firstChild = static_cast<uint32_t>(nodes.size());
+    uint32_t childCount = 0;
+    for (uint32_t digit = 0; digit < 8 && first != last; digit++) {
+      auto childLast = std::partition_point(first, last, [&](uint64_t code) {
+        return ((code >> shift) & 7) <= digit;
+      });
+      if (childLast == first) continue;
+
+      Node child{};
+      child.halfSize = node.halfSize * .5f;
+      // digit bits: x, y, z
+      glm::vec3 direction{digit & 1 ? 1.f : -1.f, digit & 2 ? 1.f : -1.f,
+                          digit & 4 ? 1.f : -1.f};
+      child.center = node.center + direction * child.halfSize;
+      child.firstBody = static_cast<uint32_t>(first - sortedCodes.begin());
+      child.bodyCount = static_cast<uint32_t>(childLast - first);
+      nodes.push_back(child);
+      childCount++;
+      first = childLast;
+    }
+    nodes[current.node].firstChild = firstChild;
+    nodes[current.node].childCount = childCount;
+    for (uint32_t i = 0; i < childCount; i++) {
+      pending.push_back({firstChild + i, current.level + 1});
+    }
+  }
+
+  // bottom up mass, children have larger indices than their parent.
+  for (size_t i = nodes.size(); i-- > 0;) {
+    Node &node = nodes[i];
+    glm::vec3 weightedPosition{0.f};
+    float mass = 0.f;
+    if (node.childCount == 0) {
+      for (uint32_t b = node.firstBody; b < node.firstBody + node.bodyCount;
+           b++) {
+        weightedPosition += sortedMasses[b] * sortedPositions[b];
+        mass += sortedMasses[b];
+      }
+    } else {
+      for (uint32_t c = node.firstChild;
+           c < node.firstChild + node.childCount; c++) {
+        weightedPosition += nodes[c].mass * nodes[c].centerOfMass;
+        mass += nodes[c].mass;
+      }
+    }
+    node.mass = mass;
+    node.centerOfMass = mass > 0.f ? weightedPosition / mass : node.center;
+  }
+}
+
+glm::vec3 BarnesHutTree::computeAcceleration(uint32_t body,
+                                             float openingAngle) const {
+  if (nodes.empty()) return glm::vec3{0.f};
+  const glm::vec3 position = sortedPositions[body];
+  const float openingAngleSquared = openingAngle * openingAngle;
+  glm::vec3 acceleration{0.f};
+  // same cut off as GravityPhysicsSystem::computeForce.
+  auto accumulate = [&](const glm::vec3 &otherPosition, float otherMass) {
+    glm::vec3 offset = otherPosition - position;
+    float distanceSquared = glm::dot(offset, offset);
+    if (distanceSquared < 1e-10f) return;
+    float inverseDistance = 1.f / glm::sqrt(distanceSquared);
+    acceleration += otherMass * inverseDistance * inverseDistance *
+                    inverseDistance * offset;
+  };
+
+  // depth first, at most 7 pending siblings per level.
+  std::array<uint32_t, 8 * MAX_DEPTH + 8> stack;
+  uint32_t stackSize = 0;
+  stack[stackSize++] = 0;
+  while (stackSize > 0) {
+    const Node &node = nodes[stack[--stackSize]];
+    if (node.childCount == 0) {
+      for (uint32_t b = node.firstBody; b < node.firstBody + node.bodyCount;
+           b++) {
+        if (b != body) accumulate(sortedPositions[b], sortedMasses[b]);
+      }
+      continue;
+    }
+
+    // NOTE: cells containing the body are always opened, so it never
+    // attracts itself through a center of mass.
+    glm::vec3 fromCenter = glm::abs(position - node.center);
+    bool containsBody = fromCenter.x <= node.halfSize &&
+                        fromCenter.y <= node.halfSize &&
+                        fromCenter.z <= node.halfSize;
+    glm::vec3 offset = node.centerOfMass - position;
+    float size = node.halfSize * 2.f;
+    if (!containsBody &&
+        size * size < openingAngleSquared * glm::dot(offset, offset)) {
+      accumulate(node.centerOfMass, node.mass);
+      continue;
+    }
+    for (uint32_t c = node.firstChild; c < node.firstChild + node.childCount;
+         c++) {
+      stack[stackSize++] = c;
+    }
+  }
+  return acceleration;
+}
+
+}  // namespace kc_bonus
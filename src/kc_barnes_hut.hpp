@@ -0,0 +1,67 @@
+#pragma once
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <cstdint>
+#include <vector>
+
+namespace kc_bonus {
+
+// linear octree for barnes-hut gravity, rebuilt from scratch every step.
+// bodies are sorted by morton code of their position in the bounding cube,
+// so every node covers a contiguous range of the sorted bodies and the
+// children of a node are stored next to each other.
+class BarnesHutTree {
+ public:
+  // bits per axis of the morton code, also the maximum depth.
+  static constexpr uint32_t MAX_DEPTH = 21;
+  static constexpr uint32_t LEAF_SIZE = 8;
+
+  BarnesHutTree() = default;
+
+  BarnesHutTree(const BarnesHutTree &) = delete;
+  BarnesHutTree &operator=(const BarnesHutTree &) = delete;
+
+  void build(const std::vector<glm::vec3> &positions,
+             const std::vector<float> &masses);
+
+  // sum of mass * offset / distance^3 over the other bodies (no gravity
+  // constant). body indexes getSortedBodies(). cells seen under an angle
+  // below openingAngle (size / distance) are taken as a point mass at their
+  // center of mass.
+  glm::vec3 computeAcceleration(uint32_t body, float openingAngle) const;
+
+  // bodies in morton order, traversing in this order keeps nearby bodies on
+  // the same thread.
+  const std::vector<uint32_t> &getSortedBodies() const { return sortedBodies; }
+  size_t getNodeCount() const { return nodes.size(); }
+
+ private:
+  struct Node {
+    glm::vec3 centerOfMass;
+    float mass;
+    glm::vec3 center;
+    float halfSize;
+    // range in sortedBodies
+    uint32_t firstBody;
+    uint32_t bodyCount;
+    // 0 children : leaf
+    uint32_t firstChild;
+    uint32_t childCount;
+  };
+
+  static uint64_t expandBits(uint32_t value);
+
+  std::vector<Node> nodes;
+  std::vector<uint32_t> sortedBodies;
+  std::vector<uint64_t> sortedCodes;
+  // copies in morton order, the traversal reads them linearly.
+  std::vector<glm::vec3> sortedPositions;
+  std::vector<float> sortedMasses;
+};
+
+}  // namespace kc_bonus
@@ -1,5 +1,6 @@
 #include "kc_bonus.hpp"
 
+#include "lve_cpu_profiler.hpp"
 #include "lve_game_object.hpp"
 #include "lve_model.hpp"
 
@@ -10,10 +11,14 @@
 #include <glm/gtc/constants.hpp>
 
 // std
+#include <algorithm>
 #include <array>
 #include <cassert>
+#include <chrono>
+#include <cmath>
 #include <iostream>
 #include <memory>
+#include <random>
 #include <stdexcept>
 #include <vector>
 
@@ -58,39 +63,115 @@ std::vector<lve::LveModel::Vertex> generate_sierpinski(
   return return_triangles;
 }
 
-GravityPhysicsSystem ::GravityPhysicsSystem(float strength)
-    : strengthGravity{strength} {}
+GravityPhysicsSystem ::GravityPhysicsSystem(float strength, Solver solver,
+                                            float openingAngle,
+                                            lve::LveThreadPool* threadPool)
+    : strengthGravity{strength},
+      solver{solver},
+      openingAngle{openingAngle},
+      threadPool{threadPool},
+      kernel{threadPool} {}
 
 void GravityPhysicsSystem::update(std::vector<lve::LveGameObject>& objs,
                                   float dt, unsigned int substeps) {
+  loadBodies(objs);
+  simulate(dt, substeps);
+  storeBodies(objs);
+}
+
+void GravityPhysicsSystem::simulate(float dt, unsigned int substeps) {
   const float stepDelta = dt / substeps;
   for (int i = 0; i < substeps; i++) {
-    stepSimulation(objs, stepDelta);
+    stepSimulation(stepDelta);
   }
 }
 
-void GravityPhysicsSystem::stepSimulation(
-    std::vector<lve::LveGameObject>& physicsObjs, float dt) {
-  // Loops through all pairs of objects and applies attractive force between
-  // them
-  for (auto iterA = physicsObjs.begin(); iterA != physicsObjs.end(); ++iterA) {
-    auto& objA = *iterA;
-    for (auto iterB = iterA; iterB != physicsObjs.end(); ++iterB) {
-      if (iterA == iterB) continue;
-      auto& objB = *iterB;
-
-      auto force = computeForce(objA, objB);
-      objA.rigidBody.velocity += dt * -force / objA.rigidBody.mass;
-      objB.rigidBody.velocity += dt * force / objB.rigidBody.mass;
-    }
+void GravityPhysicsSystem::loadBodies(
+    const std::vector<lve::LveGameObject>& physicsObjs) {
+  bodies.resize(physicsObjs.size());
+  for (size_t i = 0; i < physicsObjs.size(); i++) {
+    auto& obj = physicsObjs[i];
+    bodies.positionX[i] = obj.transform.translation.x;
+    bodies.positionY[i] = obj.transform.translation.y;
+    bodies.positionZ[i] = obj.transform.translation.z;
+    bodies.mass[i] = obj.rigidBody.mass;
+    bodies.velocityX[i] = obj.rigidBody.velocity.x;
+    bodies.velocityY[i] = obj.rigidBody.velocity.y;
+    bodies.velocityZ[i] = obj.rigidBody.velocity.z;
+  }
+}
+
+void GravityPhysicsSystem::storeBodies(
+    std::vector<lve::LveGameObject>& physicsObjs) const {
+  assert(physicsObjs.size() == bodies.size() && "Body store out of sync.");
+  for (size_t i = 0; i < physicsObjs.size(); i++) {
+    auto& obj = physicsObjs[i];
+    obj.transform.translation = {bodies.positionX[i], bodies.positionY[i],
+                                 bodies.positionZ[i]};
+    obj.rigidBody.velocity = {bodies.velocityX[i], bodies.velocityY[i],
+                              bodies.velocityZ[i]};
+  }
+}
+
+void GravityPhysicsSystem::stepSimulation(float dt) {
+  LVE_PROFILE_FUNCTION();
+  // every body sums the pull of all others into its own acceleration
+  if (solver == Solver::BARNES_HUT) {
+    computeBarnesHut();
+  } else {
+    kernel.computeAccelerations(bodies, strengthGravity);
   }
 
-  // update each objects position based on its final velocity
-  for (auto& obj : physicsObjs) {
-    obj.transform.translation += dt * obj.rigidBody.velocity;
+  // update each objects velocity, then its position based on the new one
+  for (size_t i = 0; i < bodies.size(); i++) {
+    bodies.velocityX[i] += dt * bodies.accelerationX[i];
+    bodies.velocityY[i] += dt * bodies.accelerationY[i];
+    bodies.velocityZ[i] += dt * bodies.accelerationZ[i];
+    bodies.positionX[i] += dt * bodies.velocityX[i];
+    bodies.positionY[i] += dt * bodies.velocityY[i];
+    bodies.positionZ[i] += dt * bodies.velocityZ[i];
   }
 }
 
+void GravityPhysicsSystem::computeBarnesHut() {
+  size_t bodyCount = bodies.size();
+  positions.resize(bodyCount);
+  masses.resize(bodyCount);
+  for (size_t i = 0; i < bodyCount; i++) {
+    positions[i] = {bodies.positionX[i], bodies.positionY[i],
+                    bodies.positionZ[i]};
+    masses[i] = bodies.mass[i];
+  }
+  {
+    LVE_PROFILE_SCOPE("build_octree");
+    tree.build(positions, masses);
+  }
+
+  // every body only writes its own acceleration, chunks never share writes.
+  auto traverse = [this](size_t first, size_t count) {
+    LVE_PROFILE_SCOPE("traverse_octree");
+    const auto& sortedBodies = tree.getSortedBodies();
+    for (size_t i = first; i < first + count; i++) {
+      glm::vec3 acceleration =
+          strengthGravity *
+          tree.computeAcceleration(static_cast<uint32_t>(i), openingAngle);
+      uint32_t body = sortedBodies[i];
+      bodies.accelerationX[body] = acceleration.x;
+      bodies.accelerationY[body] = acceleration.y;
+      bodies.accelerationZ[body] = acceleration.z;
+    }
+  };
+  if (threadPool == nullptr) {
+    traverse(0, bodyCount);
+    return;
+  }
+  threadPool->parallelFor(
+      bodyCount, MIN_BODIES_PER_CHUNK, 1,
+      [&traverse](size_t, size_t first, size_t count) {
+        traverse(first, count);
+      });
+}
+
 glm::vec3 GravityPhysicsSystem::computeForce(lve::LveGameObject& fromObj,
                                              lve::LveGameObject& toObj) const {
   auto offset = fromObj.transform.translation - toObj.transform.translation;
@@ -108,6 +189,171 @@ glm::vec3 GravityPhysicsSystem::computeForce(lve::LveGameObject& fromObj,
   return force * offset / glm::sqrt(distanceSquared);
 }
 
+void GravityPhysicsSystem::runBenchmark(uint32_t maxBodies,
+                                        uint32_t maxBruteForceBodies,
+                                        float openingAngle,
+                                        lve::LveThreadPool& threadPool) {
+  const float strength = .81f;
+  const float dt = 1.f / 60.f;
+  // plummer-like cluster, dense core like the demo scenes.
+  auto createBodies = [](uint32_t bodyCount) {
+    GravityBodies cluster = createClusterBodies(bodyCount);
+    std::vector<lve::LveGameObject> bodies;
+    bodies.reserve(bodyCount);
+    for (uint32_t i = 0; i < bodyCount; i++) {
+      auto body = lve::LveGameObject::createGameObject();
+      body.transform.translation = {cluster.positionX[i],
+                                    cluster.positionY[i],
+                                    cluster.positionZ[i]};
+      body.rigidBody.velocity = glm::vec3{0.f};
+      body.rigidBody.mass = cluster.mass[i];
+      bodies.push_back(std::move(body));
+    }
+    return bodies;
+  };
+  // repeats steps for at least 0.2 s, returns ms per step.
+  auto measure = [&](GravityPhysicsSystem& system, uint32_t bodyCount) {
+    auto bodies = createBodies(bodyCount);
+    uint32_t steps = 0;
+    auto startTime = std::chrono::steady_clock::now();
+    double seconds = 0.0;
+    do {
+      system.update(bodies, dt);
+      steps++;
+      seconds = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - startTime)
+                    .count();
+    } while (seconds < .2);
+    return seconds * 1e3 / steps;
+  };
+  // rms of the relative velocity change error after one step.
+  auto measureError = [&](uint32_t bodyCount) {
+    GravityPhysicsSystem bruteForce{strength, Solver::BRUTE_FORCE,
+                                    openingAngle, &threadPool};
+    GravityPhysicsSystem barnesHut{strength, Solver::BARNES_HUT, openingAngle,
+                                   &threadPool};
+    auto exactBodies = createBodies(bodyCount);
+    auto approximateBodies = createBodies(bodyCount);
+    bruteForce.update(exactBodies, dt);
+    barnesHut.update(approximateBodies, dt);
+    double errorSquaredSum = 0.0;
+    for (uint32_t i = 0; i < bodyCount; i++) {
+      glm::vec3 exact = exactBodies[i].rigidBody.velocity;
+      glm::vec3 error = approximateBodies[i].rigidBody.velocity - exact;
+      float exactLength = glm::length(exact);
+      if (exactLength <= 0.f) continue;
+      errorSquaredSum += glm::dot(error, error) / (exactLength * exactLength);
+    }
+    return std::sqrt(errorSquaredSum / bodyCount);
+  };
+
+  // simd kernel against the scalar reference on one step of forces.
+  auto compareKernels = [&](uint32_t bodyCount) {
+    GravityPhysicsSystem reference{strength};
+    reference.loadBodies(createBodies(bodyCount));
+    GravityBodies scalar = reference.getBodies();
+    GravityBodies simd = reference.getBodies();
+    auto startTime = std::chrono::steady_clock::now();
+    GravityKernel::computeScalar(scalar, strength, 0, bodyCount);
+    auto scalarTime = std::chrono::steady_clock::now();
+    GravityKernel kernel{&threadPool};
+    kernel.computeAccelerations(simd, strength);
+    auto simdTime = std::chrono::steady_clock::now();
+    double maxError = 0.0;
+    for (uint32_t i = 0; i < bodyCount; i++) {
+      glm::vec3 exact{scalar.accelerationX[i], scalar.accelerationY[i],
+                      scalar.accelerationZ[i]};
+      glm::vec3 actual{simd.accelerationX[i], simd.accelerationY[i],
+                       simd.accelerationZ[i]};
+      float exactLength = glm::length(exact);
+      if (exactLength <= 0.f) continue;
+      maxError = std::max<double>(
+          maxError, glm::length(actual - exact) / exactLength);
+    }
+    std::cout << "brute force kernel " << GravityKernel::getSimdName()
+              << ", " << bodyCount << " bodies: scalar "
+              << std::chrono::duration<double, std::milli>(scalarTime -
+                                                           startTime)
+                     .count()
+              << " ms, simd threaded "
+              << std::chrono::duration<double, std::milli>(simdTime -
+                                                           scalarTime)
+                     .count()
+              << " ms, max relative error " << maxError << std::endl;
+  };
+
+  std::cout << "gravity benchmark: theta " << openingAngle << ", "
+            << threadPool.getThreadCount() << " threads" << std::endl;
+  compareKernels(std::min<uint32_t>(maxBruteForceBodies, 4096));
+  double lastBruteForceMs = 0.0;
+  uint32_t lastBruteForceBodies = 0;
+  uint32_t crossover = 0;
+  for (uint32_t bodyCount = 100; bodyCount <= maxBodies; bodyCount *= 10) {
+    GravityPhysicsSystem barnesHut{strength, Solver::BARNES_HUT, openingAngle,
+                                   &threadPool};
+    double barnesHutMs = measure(barnesHut, bodyCount);
+
+    bool isMeasured = bodyCount <= maxBruteForceBodies;
+    double bruteForceMs = 0.0;
+    if (isMeasured) {
+      GravityPhysicsSystem bruteForce{strength, Solver::BRUTE_FORCE,
+                                      openingAngle, &threadPool};
+      bruteForceMs = measure(bruteForce, bodyCount);
+      lastBruteForceMs = bruteForceMs;
+      lastBruteForceBodies = bodyCount;
+    } else {
+      double ratio = static_cast<double>(bodyCount) / lastBruteForceBodies;
+      bruteForceMs = lastBruteForceMs * ratio * ratio;
+    }
+    if (crossover == 0 && barnesHutMs < bruteForceMs) {
+      crossover = bodyCount;
+    }
+
+    std::cout << bodyCount << " bodies: brute force " << bruteForceMs
+              << " ms" << (isMeasured ? "" : " (extrapolated)")
+              << ", barnes-hut " << barnesHutMs << " ms, speedup "
+              << bruteForceMs / barnesHutMs;
+    if (isMeasured) {
+      std::cout << ", rms error " << measureError(bodyCount);
+    }
+    std::cout << std::endl;
+  }
+  if (crossover > 0) {
+    std::cout << "barnes-hut is faster from " << crossover << " bodies"
+              << std::endl;
+  } else {
+    std::cout << "brute force is faster up to " << maxBodies << " bodies"
+              << std::endl;
+  }
+}
+
+GravityBodies createClusterBodies(uint32_t bodyCount, float radius,
+                                  glm::vec3 center) {
+  std::default_random_engine randomEngine;
+  randomEngine.seed(1111);
+  std::uniform_real_distribution<float> randomDist(0.f, 1.f);
+  GravityBodies bodies{};
+  bodies.resize(bodyCount);
+  for (uint32_t i = 0; i < bodyCount; i++) {
+    // inverse of the enclosed mass, clipped to keep the halo finite.
+    float massFraction = randomDist(randomEngine) * .99f + .01f;
+    float distance =
+        radius /
+        glm::sqrt(glm::pow(massFraction, -2.f / 3.f) - 1.f + 1e-3f);
+    float cosTheta = randomDist(randomEngine) * 2.f - 1.f;
+    float phi = glm::two_pi<float>() * randomDist(randomEngine);
+    float sinTheta = glm::sqrt(1.f - cosTheta * cosTheta);
+    bodies.positionX[i] = center.x + distance * sinTheta * glm::cos(phi);
+    bodies.positionY[i] = center.y + distance * sinTheta * glm::sin(phi);
+    bodies.positionZ[i] = center.z + distance * cosTheta;
+    bodies.mass[i] = 1.f / bodyCount;
+    bodies.velocityX[i] = 0.f;
+    bodies.velocityY[i] = 0.f;
+    bodies.velocityZ[i] = 0.f;
+  }
+  return bodies;
+}
+
 std::unique_ptr<lve::LveModel> createCircleModel(lve::LveDevice& device,
                                                  unsigned int numSides) {
   std::vector<lve::LveModel::Vertex> uniqueVertices{};
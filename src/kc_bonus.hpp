@@ -1,7 +1,10 @@
 #pragma once
 
+#include "kc_barnes_hut.hpp"
+#include "kc_gravity_kernel.hpp"
 #include "lve_game_object.hpp"
 #include "lve_model.hpp"
+#include "lve_thread_pool.hpp"
 #include "systems/simple_render_system.hpp"
 
 // libs
@@ -22,21 +25,61 @@ std::vector<lve::LveModel::Vertex> generate_sierpinski(
 
 class GravityPhysicsSystem {
  public:
-  GravityPhysicsSystem(float strength);
+  // BRUTE_FORCE: all pairs, O(n^2).
+  // BARNES_HUT: octree rebuilt every substep, O(n log n) but approximate.
+  enum class Solver { BRUTE_FORCE, BARNES_HUT };
+  // bodies per barnes-hut traversal task.
+  static constexpr size_t MIN_BODIES_PER_CHUNK = 1024;
+
+  // openingAngle: barnes-hut theta, 0 is exact, larger is faster.
+  // threadPool: parallel force computation, nullptr runs on the caller.
+  GravityPhysicsSystem(float strength, Solver solver = Solver::BRUTE_FORCE,
+                       float openingAngle = .5f,
+                       lve::LveThreadPool* threadPool = nullptr);
   const float strengthGravity;
   // dt: specific amout of time delta
   // substeps: intervals to divide time delta.
   // trade-off. stable simulation vs. computation.
+  // NOTE: objs are copied into the body store once and written back after
+  // the last substep.
   void update(std::vector<lve::LveGameObject>& objs, float dt,
               unsigned int substeps = 1);
+  // same as update on the body store, for callers that keep their bodies in
+  // it between updates.
+  void simulate(float dt, unsigned int substeps = 1);
+  GravityBodies& getBodies() { return bodies; }
   // fromObj attract toObj
   glm::vec3 computeForce(lve::LveGameObject& fromObj,
                          lve::LveGameObject& toObj) const;
 
+  // step time of both solvers from 100 to maxBodies bodies (x10), with the
+  // barnes-hut acceleration error. brute force is extrapolated (n^2) above
+  // maxBruteForceBodies.
+  static void runBenchmark(uint32_t maxBodies, uint32_t maxBruteForceBodies,
+                           float openingAngle, lve::LveThreadPool& threadPool);
+
  private:
-  void stepSimulation(std::vector<lve::LveGameObject>& physicsObjs, float dt);
+  void loadBodies(const std::vector<lve::LveGameObject>& physicsObjs);
+  void storeBodies(std::vector<lve::LveGameObject>& physicsObjs) const;
+  void stepSimulation(float dt);
+  void computeBarnesHut();
+
+  Solver solver;
+  float openingAngle;
+  lve::LveThreadPool* threadPool;
+  GravityBodies bodies;
+  GravityKernel kernel;
+  BarnesHutTree tree;
+  // scratch of the octree build, reused across steps.
+  std::vector<glm::vec3> positions;
+  std::vector<float> masses;
 };
 
+// plummer-like cluster at rest, dense core and a clipped halo (about 30
+// radius). the total mass is 1.
+GravityBodies createClusterBodies(uint32_t bodyCount, float radius = 1.f,
+                                  glm::vec3 center = glm::vec3{0.f});
+
 std::unique_ptr<lve::LveModel> createCircleModel(lve::LveDevice& device,
                                                  unsigned int numSides);
 
@@ -0,0 +1,264 @@
+#include "kc_gravity_kernel.hpp"
+
+#include "lve_cpu_profiler.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+// wider lanes are built per function and picked at runtime, the rest of the
+// build stays on the baseline instruction set.
+#define KC_GRAVITY_RUNTIME_ISA
+#define KC_TARGET(isa) __attribute__((target(isa)))
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define KC_GRAVITY_SSE2
+#endif
+
+namespace kc_bonus {
+
+namespace {
+
+// the lane operations of the simd loop.
+#if defined(KC_GRAVITY_RUNTIME_ISA)
+struct Avx512Lanes {
+  using Type = __m512;
+  static constexpr size_t WIDTH = 16;
+  KC_TARGET("avx512f") static Type zero() { return _mm512_setzero_ps(); }
+  KC_TARGET("avx512f") static Type set(float value) {
+    return _mm512_set1_ps(value);
+  }
+  KC_TARGET("avx512f") static Type load(const float *source) {
+    return _mm512_loadu_ps(source);
+  }
+  KC_TARGET("avx512f") static void store(float *target, Type a) {
+    _mm512_storeu_ps(target, a);
+  }
+  KC_TARGET("avx512f") static Type sub(Type a, Type b) {
+    return _mm512_sub_ps(a, b);
+  }
+  KC_TARGET("avx512f") static Type mul(Type a, Type b) {
+    return _mm512_mul_ps(a, b);
+  }
+  // a * b + c
+  KC_TARGET("avx512f") static Type fma(Type a, Type b, Type c) {
+    return _mm512_fmadd_ps(a, b, c);
+  }
+  KC_TARGET("avx512f") static Type rsqrt(Type a) {
+    return _mm512_rsqrt14_ps(a);
+  }
+  // a where limit <= distanceSquared, 0 otherwise.
+  KC_TARGET("avx512f")
+  static Type maskNear(Type distanceSquared, Type limit, Type a) {
+    return _mm512_maskz_mov_ps(
+        _mm512_cmp_ps_mask(distanceSquared, limit, _CMP_GE_OQ), a);
+  }
+};
+
+struct AvxLanes {
+  using Type = __m256;
+  static constexpr size_t WIDTH = 8;
+  KC_TARGET("avx") static Type zero() { return _mm256_setzero_ps(); }
+  KC_TARGET("avx") static Type set(float value) {
+    return _mm256_set1_ps(value);
+  }
+  KC_TARGET("avx") static Type load(const float *source) {
+    return _mm256_loadu_ps(source);
+  }
+  KC_TARGET("avx") static void store(float *target, Type a) {
+    _mm256_storeu_ps(target, a);
+  }
+  KC_TARGET("avx") static Type sub(Type a, Type b) {
+    return _mm256_sub_ps(a, b);
+  }
+  KC_TARGET("avx") static Type mul(Type a, Type b) {
+    return _mm256_mul_ps(a, b);
+  }
+  KC_TARGET("avx") static Type fma(Type a, Type b, Type c) {
+    return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+  }
+  KC_TARGET("avx") static Type rsqrt(Type a) { return _mm256_rsqrt_ps(a); }
+  KC_TARGET("avx")
+  static Type maskNear(Type distanceSquared, Type limit, Type a) {
+    return _mm256_and_ps(_mm256_cmp_ps(distanceSquared, limit, _CMP_GE_OQ),
+                         a);
+  }
+};
+
+struct Avx2Lanes : AvxLanes {
+  KC_TARGET("avx2,fma") static Type fma(Type a, Type b, Type c) {
+    return _mm256_fmadd_ps(a, b, c);
+  }
+};
+#endif
+
+#if defined(KC_GRAVITY_SSE2)
+struct Sse2Lanes {
+  using Type = __m128;
+  static constexpr size_t WIDTH = 4;
+  static Type zero() { return _mm_setzero_ps(); }
+  static Type set(float value) { return _mm_set1_ps(value); }
+  static Type load(const float *source) { return _mm_loadu_ps(source); }
+  static void store(float *target, Type a) { _mm_storeu_ps(target, a); }
+  static Type sub(Type a, Type b) { return _mm_sub_ps(a, b); }
+  static Type mul(Type a, Type b) { return _mm_mul_ps(a, b); }
+  static Type fma(Type a, Type b, Type c) {
+    return _mm_add_ps(_mm_mul_ps(a, b), c);
+  }
+  static Type rsqrt(Type a) { return _mm_rsqrt_ps(a); }
+  static Type maskNear(Type distanceSquared, Type limit, Type a) {
+    return _mm_and_ps(_mm_cmpge_ps(distanceSquared, limit), a);
+  }
+};
+#endif
+
+// whole lanes of [first, first + count), returns the first body left to the
+// scalar path.
+using ComputeLanes = size_t (*)(GravityBodies &bodies, float strength,
+                                size_t first, size_t count);
+
+#if defined(KC_GRAVITY_RUNTIME_ISA)
+KC_TARGET("avx512f")
+size_t computeAvx512(GravityBodies &bodies, float strength, size_t first,
+                     size_t count) {
+  using Lanes = Avx512Lanes;
+#include "kc_gravity_lanes.inl"
+}
+
+KC_TARGET("avx2,fma")
+size_t computeAvx2(GravityBodies &bodies, float strength, size_t first,
+                   size_t count) {
+  using Lanes = Avx2Lanes;
+#include "kc_gravity_lanes.inl"
+}
+
+KC_TARGET("avx")
+size_t computeAvx(GravityBodies &bodies, float strength, size_t first,
+                  size_t count) {
+  using Lanes = AvxLanes;
+#include "kc_gravity_lanes.inl"
+}
+#endif
+
+#if defined(KC_GRAVITY_SSE2)
+size_t computeSse2(GravityBodies &bodies, float strength, size_t first,
+                   size_t count) {
+  using Lanes = Sse2Lanes;
+#include "kc_gravity_lanes.inl"
+}
+#endif
+
+struct SimdPath {
+  const char *name;
+  // nullptr : scalar only.
+  ComputeLanes compute;
+};
+
+SimdPath selectSimdPath() {
+#if defined(KC_GRAVITY_RUNTIME_ISA)
+  if (__builtin_cpu_supports("avx512f")) return {"avx-512", computeAvx512};
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    return {"avx2", computeAvx2};
+  }
+  if (__builtin_cpu_supports("avx")) return {"avx", computeAvx};
+#endif
+#if defined(KC_GRAVITY_SSE2)
+  return {"sse2", computeSse2};
+#else
+  return {"scalar", nullptr};
+#endif
+}
+
+// cpu checked once, on the first computation.
+const SimdPath &getSimdPath() {
+  static const SimdPath simdPath = selectSimdPath();
+  return simdPath;
+}
+
+}  // namespace
+
+void GravityBodies::resize(size_t count) {
+  positionX.resize(count);
+  positionY.resize(count);
+  positionZ.resize(count);
+  mass.resize(count);
+  velocityX.resize(count);
+  velocityY.resize(count);
+  velocityZ.resize(count);
+  accelerationX.resize(count);
+  accelerationY.resize(count);
+  accelerationZ.resize(count);
+}
+
+GravityKernel::GravityKernel(lve::LveThreadPool *threadPool)
+    : threadPool{threadPool} {}
+
+void GravityKernel::computeAccelerations(GravityBodies &bodies,
+                                         float strength) {
+  LVE_PROFILE_FUNCTION();
+  size_t bodyCount = bodies.size();
+  if (bodyCount == 0) return;
+
+  if (threadPool == nullptr) {
+    computeSimd(bodies, strength, 0, bodyCount);
+    return;
+  }
+  threadPool->parallelFor(
+      bodyCount, MIN_BODIES_PER_CHUNK,
+      lve::LveThreadPool::FLOATS_PER_CACHE_LINE,
+      [&bodies, strength](size_t, size_t first, size_t count) {
+        LVE_PROFILE_SCOPE("gravity_chunk");
+        computeSimd(bodies, strength, first, count);
+      });
+}
+
+void GravityKernel::computeScalar(GravityBodies &bodies, float strength,
+                                  size_t first, size_t count) {
+  const float *positionX = bodies.positionX.data();
+  const float *positionY = bodies.positionY.data();
+  const float *positionZ = bodies.positionZ.data();
+  const float *mass = bodies.mass.data();
+  size_t bodyCount = bodies.size();
+
+  for (size_t i = first; i < first + count; i++) {
+    float ax = 0.f;
+    float ay = 0.f;
+    float az = 0.f;
+    for (size_t j = 0; j < bodyCount; j++) {
+      float dx = positionX[j] - positionX[i];
+      float dy = positionY[j] - positionY[i];
+      float dz = positionZ[j] - positionZ[i];
+      float distanceSquared = dx * dx + dy * dy + dz * dz;
+      // also skips the body itself.
+      if (distanceSquared < MIN_DISTANCE_SQUARED) continue;
+      float inverseDistance = 1.f / std::sqrt(distanceSquared);
+      float weight =
+          mass[j] * inverseDistance * inverseDistance * inverseDistance;
+      ax += weight * dx;
+      ay += weight * dy;
+      az += weight * dz;
+    }
+    bodies.accelerationX[i] = strength * ax;
+    bodies.accelerationY[i] = strength * ay;
+    bodies.accelerationZ[i] = strength * az;
+  }
+}
+
+void GravityKernel::computeSimd(GravityBodies &bodies, float strength,
+                                size_t first, size_t count) {
+  const SimdPath &simdPath = getSimdPath();
+  size_t end = first + count;
+  size_t vectorEnd = simdPath.compute != nullptr
+                         ? simdPath.compute(bodies, strength, first, count)
+                         : first;
+  // remaining bodies
+  computeScalar(bodies, strength, vectorEnd, end - vectorEnd);
+}
+
+const char *GravityKernel::getSimdName() { return getSimdPath().name; }
+
+}  // namespace kc_bonus
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "lve_thread_pool.hpp"
+
+// std
+#include <cstddef>
+#include <vector>
+
+namespace kc_bonus {
+
+// bodies of GravityPhysicsSystem as structure of arrays, owned by the physics
+// system and synced with the game objects once per update.
+struct GravityBodies {
+  std::vector<float> positionX;
+  std::vector<float> positionY;
+  std::vector<float> positionZ;
+  std::vector<float> mass;
+  std::vector<float> velocityX;
+  std::vector<float> velocityY;
+  std::vector<float> velocityZ;
+  // written by the solvers every substep.
+  std::vector<float> accelerationX;
+  std::vector<float> accelerationY;
+  std::vector<float> accelerationZ;
+
+  size_t size() const { return positionX.size(); }
+  void resize(size_t count);
+};
+
+// all pairs gravity. every body sums the pull of all others into its own
+// acceleration instead of applying each pair to both bodies, so ranges of
+// bodies run on different threads without sharing writes.
+// the simd path uses the widest of AVX-512, AVX2 (with FMA), AVX and SSE2 the
+// cpu has.
+class GravityKernel {
+ public:
+  // source bodies per tile (16 KB), stays in L1 while every target of a range
+  // passes over it.
+  static constexpr size_t TILE_SIZE = 1024;
+  // per thread chunk, also keeps chunks on separate cache lines.
+  static constexpr size_t MIN_BODIES_PER_CHUNK = 256;
+  // same cut off as GravityPhysicsSystem::computeForce.
+  static constexpr float MIN_DISTANCE_SQUARED = 1e-10f;
+
+  // threadPool nullptr : runs on the calling thread only.
+  explicit GravityKernel(lve::LveThreadPool *threadPool = nullptr);
+
+  GravityKernel(const GravityKernel &) = delete;
+  GravityKernel &operator=(const GravityKernel &) = delete;
+
+  // accelerations of every body times strength, split across the pool.
+  void computeAccelerations(GravityBodies &bodies, float strength);
+
+  // accelerations of the bodies [first, first + count) from all bodies.
+  static void computeScalar(GravityBodies &bodies, float strength,
+                            size_t first, size_t count);
+  // NOTE: reciprocal square root with one newton step instead of a divide,
+  // about 1e-7 relative off the scalar path.
+  static void computeSimd(GravityBodies &bodies, float strength, size_t first,
+                          size_t count);
+  // "avx-512", "avx2", "avx", "sse2" or "scalar"
+  static const char *getSimdName();
+
+ private:
+  lve::LveThreadPool *threadPool;
+};
+
+}  // namespace kc_bonus
@@ -0,0 +1,73 @@
+// body of the simd loop of GravityKernel, included by one function per
+// instruction set (kc_gravity_kernel.cpp), built with that instruction set.
+// expects: Lanes, bodies, strength, first, count. returns the first body left
+// to the scalar path.
+// NOTE: a template would be built once without the instruction set, its lane
+// operations could not be inlined.
+  constexpr float MIN_DISTANCE_SQUARED = GravityKernel::MIN_DISTANCE_SQUARED;
+  constexpr size_t TILE_SIZE = GravityKernel::TILE_SIZE;
+  using Type = Lanes::Type;
+  const float *positionX = bodies.positionX.data();
+  const float *positionY = bodies.positionY.data();
+  const float *positionZ = bodies.positionZ.data();
+  const float *mass = bodies.mass.data();
+  float *accelerationX = bodies.accelerationX.data();
+  float *accelerationY = bodies.accelerationY.data();
+  float *accelerationZ = bodies.accelerationZ.data();
+  size_t bodyCount = bodies.size();
+  size_t vectorEnd = first + count / Lanes::WIDTH * Lanes::WIDTH;
+
+  const Type minDistanceSquared = Lanes::set(MIN_DISTANCE_SQUARED);
+  const Type half = Lanes::set(.5f);
+  const Type threeHalves = Lanes::set(1.5f);
+  // targets in lanes, sources broadcast. the partial sums of a tile are
+  // added to the ones of the previous tiles.
+  for (size_t tileStart = 0; tileStart < bodyCount; tileStart += TILE_SIZE) {
+    size_t tileEnd = std::min(tileStart + TILE_SIZE, bodyCount);
+    for (size_t i = first; i < vectorEnd; i += Lanes::WIDTH) {
+      Type x = Lanes::load(positionX + i);
+      Type y = Lanes::load(positionY + i);
+      Type z = Lanes::load(positionZ + i);
+      Type ax = tileStart == 0 ? Lanes::zero() : Lanes::load(accelerationX + i);
+      Type ay = tileStart == 0 ? Lanes::zero() : Lanes::load(accelerationY + i);
+      Type az = tileStart == 0 ? Lanes::zero() : Lanes::load(accelerationZ + i);
+      for (size_t j = tileStart; j < tileEnd; j++) {
+        Type dx = Lanes::sub(Lanes::set(positionX[j]), x);
+        Type dy = Lanes::sub(Lanes::set(positionY[j]), y);
+        Type dz = Lanes::sub(Lanes::set(positionZ[j]), z);
+        Type distanceSquared =
+            Lanes::fma(dz, dz, Lanes::fma(dy, dy, Lanes::mul(dx, dx)));
+        // one newton step: r = r * (1.5 - 0.5 * d^2 * r^2)
+        Type inverseDistance = Lanes::rsqrt(distanceSquared);
+        inverseDistance = Lanes::mul(
+            inverseDistance,
+            Lanes::sub(threeHalves,
+                       Lanes::mul(Lanes::mul(half, distanceSquared),
+                                  Lanes::mul(inverseDistance,
+                                             inverseDistance))));
+        Type weight = Lanes::mul(
+            Lanes::set(mass[j]),
+            Lanes::mul(inverseDistance,
+                       Lanes::mul(inverseDistance, inverseDistance)));
+        // NOTE: also clears the nan of the body itself (rsqrt(0) = inf).
+        weight = Lanes::maskNear(distanceSquared, minDistanceSquared, weight);
+        ax = Lanes::fma(weight, dx, ax);
+        ay = Lanes::fma(weight, dy, ay);
+        az = Lanes::fma(weight, dz, az);
+      }
+      Lanes::store(accelerationX + i, ax);
+      Lanes::store(accelerationY + i, ay);
+      Lanes::store(accelerationZ + i, az);
+    }
+  }
+
+  const Type strengthLanes = Lanes::set(strength);
+  for (size_t i = first; i < vectorEnd; i += Lanes::WIDTH) {
+    Lanes::store(accelerationX + i,
+                 Lanes::mul(strengthLanes, Lanes::load(accelerationX + i)));
+    Lanes::store(accelerationY + i,
+                 Lanes::mul(strengthLanes, Lanes::load(accelerationY + i)));
+    Lanes::store(accelerationZ + i,
+                 Lanes::mul(strengthLanes, Lanes::load(accelerationZ + i)));
+  }
+  return vectorEnd;
@@ -14,6 +14,8 @@ void LveCamera::setOrthographicProjection(float left, float right, float top,
   projectionMatrix[3][0] = -(right + left) / (right - left);
   projectionMatrix[3][1] = -(bottom + top) / (bottom - top);
   projectionMatrix[3][2] = -near / (far - near);
+  nearPlane = near;
+  farPlane = far;
 }
 
 void LveCamera::setPerspectiveProjection(float fovy, float aspect, float near,
@@ -26,6 +28,8 @@ void LveCamera::setPerspectiveProjection(float fovy, float aspect, float near,
   projectionMatrix[2][2] = far / (far - near);
   projectionMatrix[2][3] = 1.f;
   projectionMatrix[3][2] = -(far * near) / (far - near);
+  nearPlane = near;
+  farPlane = far;
 }
 
 void LveCamera::setViewDirection(glm::vec3 position, glm::vec3 direction,
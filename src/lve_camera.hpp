@@ -25,10 +25,14 @@ class LveCamera {
   const glm::vec3 getPosition() const {
     return glm::vec3(inverseViewMatrix[3]);
   }
+  float getNear() const { return nearPlane; }
+  float getFar() const { return farPlane; }
 
  private:
   glm::mat4 projectionMatrix{1.f};
   glm::mat4 viewMatrix{1.f};
   glm::mat4 inverseViewMatrix{1.f};
+  float nearPlane = 0.1f;
+  float farPlane = 100.f;
 };
 }  // namespace lve
\ No newline at end of file
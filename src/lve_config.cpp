@@ -0,0 +1,190 @@
+#include "lve_config.hpp"
+
+#include "lve_frame_context.hpp"
+
+// std
+#include <iostream>
+#include <stdexcept>
+
+namespace lve {
+
+namespace {
+uint32_t parseCount(const std::string &option, const char *value) {
+  try {
+    size_t parsed = 0;
+    unsigned long count = std::stoul(value, &parsed);
+    if (value[parsed] != '\0') throw std::invalid_argument(value);
+    return static_cast<uint32_t>(count);
+  } catch (const std::logic_error &) {
+    throw std::runtime_error("invalid value for " + option + ": " + value);
+  }
+}
+
+float parseFloat(const std::string &option, const char *value) {
+  try {
+    size_t parsed = 0;
+    float number = std::stof(value, &parsed);
+    if (value[parsed] != '\0') throw std::invalid_argument(value);
+    return number;
+  } catch (const std::logic_error &) {
+    throw std::runtime_error("invalid value for " + option + ": " + value);
+  }
+}
+
+VkPresentModeKHR parsePresentMode(const std::string &value) {
+  if (value == "fifo") return VK_PRESENT_MODE_FIFO_KHR;
+  if (value == "fifo-relaxed") return VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+  if (value == "mailbox") return VK_PRESENT_MODE_MAILBOX_KHR;
+  if (value == "immediate") return VK_PRESENT_MODE_IMMEDIATE_KHR;
+  throw std::runtime_error("invalid value for --present-mode: " + value);
+}
+
+bool parseGravityBackend(const std::string &value) {
+  if (value == "gpu") return true;
+  if (value == "cpu") return false;
+  throw std::runtime_error("invalid value for --gravity-backend: " + value);
+}
+}  // namespace
+
+LveConfig LveConfig::fromArgs(int argc, char *argv[]) {
+  LveConfig config{};
+  for (int i = 1; i < argc; i++) {
+    std::string option = argv[i];
+    // every option except the flags takes one value.
+    auto nextValue = [&]() -> const char * {
+      if (i + 1 >= argc) {
+        throw std::runtime_error("missing value for " + option);
+      }
+      return argv[++i];
+    };
+
+    if (option == "--headless") {
+      config.headless = true;
+    } else if (option == "--width") {
+      config.width = parseCount(option, nextValue());
+    } else if (option == "--height") {
+      config.height = parseCount(option, nextValue());
+    } else if (option == "--frames") {
+      config.frameCount = parseCount(option, nextValue());
+    } else if (option == "--capture") {
+      config.captureDir = nextValue();
+    } else if (option == "--capture-every") {
+      config.captureEvery = parseCount(option, nextValue());
+    } else if (option == "--present-mode") {
+      config.presentMode = parsePresentMode(nextValue());
+    } else if (option == "--swap-images") {
+      config.swapImageCount = parseCount(option, nextValue());
+    } else if (option == "--latency-csv") {
+      config.latencyCsv = nextValue();
+    } else if (option == "--frames-in-flight") {
+      config.framesInFlight = parseCount(option, nextValue());
+    } else if (option == "--cpu-trace") {
+      config.cpuTrace = nextValue();
+    } else if (option == "--gpu-stats") {
+      config.gpuStats = true;
+    } else if (option == "--gpu-budget-ms") {
+      config.gpuBudgetMs = parseFloat(option, nextValue());
+    } else if (option == "--min-render-scale") {
+      config.minRenderScale = parseFloat(option, nextValue());
+    } else if (option == "--particles") {
+      config.particleCapacity = parseCount(option, nextValue());
+    } else if (option == "--particle-benchmark") {
+      config.particleBenchmark = true;
+    } else if (option == "--cpu-particle-benchmark") {
+      config.cpuParticleBenchmark = true;
+    } else if (option == "--validate-particles") {
+      config.validateParticles = true;
+    } else if (option == "--gravity-benchmark") {
+      config.gravityBenchmarkBodies = parseCount(option, nextValue());
+    } else if (option == "--gravity-theta") {
+      config.gravityTheta = parseFloat(option, nextValue());
+    } else if (option == "--gravity-bodies") {
+      config.gravityBodies = parseCount(option, nextValue());
+    } else if (option == "--gravity-backend") {
+      config.gravityOnGpu = parseGravityBackend(nextValue());
+    } else if (option == "--validate-gravity") {
+      config.validateGravity = true;
+    } else if (option == "--tick-rate") {
+      config.tickRate = parseFloat(option, nextValue());
+    } else if (option == "--max-ticks") {
+      config.maxTicksPerFrame = parseCount(option, nextValue());
+    } else {
+      throw std::runtime_error("unknown option: " + option);
+    }
+  }
+
+  if (config.width == 0 || config.height == 0) {
+    throw std::runtime_error("render target size must not be zero");
+  }
+  if (config.framesInFlight < LveFrameContext::MIN_FRAMES_IN_FLIGHT ||
+      config.framesInFlight > LveFrameContext::MAX_FRAMES_IN_FLIGHT) {
+    throw std::runtime_error("--frames-in-flight must be in [1, 4]");
+  }
+  if (config.gpuBudgetMs < 0.f) {
+    throw std::runtime_error("--gpu-budget-ms must not be negative");
+  }
+  if (!(config.minRenderScale > 0.f && config.minRenderScale <= 1.f)) {
+    throw std::runtime_error("--min-render-scale must be in (0, 1]");
+  }
+  if (config.gravityTheta < 0.f) {
+    throw std::runtime_error("--gravity-theta must not be negative");
+  }
+  if (config.validateGravity &&
+      (config.gravityBodies == 0 || !config.gravityOnGpu)) {
+    throw std::runtime_error(
+        "--validate-gravity needs --gravity-bodies on the gpu backend");
+  }
+  if (!(config.tickRate > 0.f)) {
+    throw std::runtime_error("--tick-rate must be positive");
+  }
+  if (config.maxTicksPerFrame == 0) {
+    throw std::runtime_error("--max-ticks must be at least 1");
+  }
+  if (config.particleCapacity == 0) {
+    throw std::runtime_error("--particles must be at least 1");
+  }
+  if (config.captureEvery == 0) {
+    throw std::runtime_error("--capture-every must be at least 1");
+  }
+  if (!config.captureDir.empty() && !config.headless) {
+    throw std::runtime_error("--capture is only supported with --headless");
+  }
+  // NOTE: nothing would ever stop a headless run otherwise.
+  if (config.headless && config.frameCount == 0) {
+    config.frameCount = 600;
+  }
+  return config;
+}
+
+void LveConfig::printUsage(const char *programName) {
+  std::cerr << "usage: " << programName
+            << " [--headless] [--width N] [--height N] [--frames N]"
+               " [--capture DIR] [--capture-every N]"
+               " [--present-mode fifo|fifo-relaxed|mailbox|immediate]"
+               " [--swap-images N] [--latency-csv FILE]"
+               " [--frames-in-flight N] [--cpu-trace FILE] [--gpu-stats]"
+               " [--gpu-budget-ms MS] [--min-render-scale S]"
+               " [--particles N] [--particle-benchmark]"
+               " [--cpu-particle-benchmark] [--validate-particles]"
+               " [--gravity-benchmark N] [--gravity-theta T]"
+               " [--gravity-bodies N] [--gravity-backend cpu|gpu]"
+               " [--validate-gravity] [--tick-rate HZ] [--max-ticks N]"
+            << std::endl;
+}
+
+const char *LveConfig::presentModeName(VkPresentModeKHR presentMode) {
+  switch (presentMode) {
+    case VK_PRESENT_MODE_FIFO_KHR:
+      return "fifo";
+    case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+      return "fifo-relaxed";
+    case VK_PRESENT_MODE_MAILBOX_KHR:
+      return "mailbox";
+    case VK_PRESENT_MODE_IMMEDIATE_KHR:
+      return "immediate";
+    default:
+      return "unknown";
+  }
+}
+
+}  // namespace lve
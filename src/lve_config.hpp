@@ -0,0 +1,78 @@
+#pragma once
+
+// libs
+#include <vulkan/vulkan.h>
+
+// std
+#include <cstdint>
+#include <string>
+
+namespace lve {
+
+// run options parsed from the command line.
+//   --headless            render offscreen, no window / surface / swap chain
+//   --width N --height N  render target size
+//   --frames N            stop after N frames (0: until the window closes)
+//   --capture DIR         write frames to DIR as PPM (headless only)
+//   --capture-every N     capture interval in frames
+//   --present-mode MODE   fifo | fifo-relaxed | mailbox | immediate
+//   --swap-images N       swap chain image count (0: minImageCount + 1)
+//   --latency-csv FILE    write per-frame input-to-present latency on exit
+//   --frames-in-flight N  frames recorded ahead of the GPU (1-4)
+//   --cpu-trace FILE      write CPU profiler scopes as Chrome trace on exit
+//   --gpu-stats           print the GPU profiler scope timings every second
+//   --gpu-budget-ms MS    scale the render resolution to hold this GPU frame
+//                         time (0: always full resolution)
+//   --min-render-scale S  lowest render scale of the budget (0.5)
+//   --particles N         gpu particle pool capacity
+//   --particle-benchmark  keep the particle pool full and report the
+//                         simulate kernel throughput on exit
+//   --cpu-particle-benchmark  run the CPU particle integrator benchmark on
+//                         --particles particles and exit (no gpu needed)
+//   --validate-particles  compare one gpu simulate frame against the CPU
+//                         integrator via readback
+//   --gravity-benchmark N scale GravityPhysicsSystem from 100 to N bodies,
+//                         brute force vs barnes-hut, and exit
+//   --gravity-theta T     barnes-hut opening angle of the benchmark (0.5)
+//   --gravity-bodies N    n-body cluster of N bodies in the scene (0: none)
+//   --gravity-backend B   cpu | gpu, where the cluster is simulated (gpu)
+//   --validate-gravity    compare a few gpu gravity steps against the CPU
+//                         solver via readback
+//   --tick-rate HZ        fixed simulation ticks per second (60)
+//   --max-ticks N         ticks simulated per frame at most, time beyond is
+//                         dropped (8)
+struct LveConfig {
+  bool headless = false;
+  uint32_t width = 640;
+  uint32_t height = 440;
+  uint32_t frameCount = 0;
+  std::string captureDir{};
+  uint32_t captureEvery = 60;
+  // preferred mode, falls back to FIFO when the surface lacks it.
+  VkPresentModeKHR presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+  uint32_t swapImageCount = 0;
+  std::string latencyCsv{};
+  uint32_t framesInFlight = 2;
+  std::string cpuTrace{};
+  bool gpuStats = false;
+  float gpuBudgetMs = 0.f;
+  float minRenderScale = .5f;
+  uint32_t particleCapacity = 1 << 20;
+  bool particleBenchmark = false;
+  bool cpuParticleBenchmark = false;
+  bool validateParticles = false;
+  uint32_t gravityBenchmarkBodies = 0;
+  float gravityTheta = .5f;
+  uint32_t gravityBodies = 0;
+  bool gravityOnGpu = true;
+  bool validateGravity = false;
+  float tickRate = 60.f;
+  uint32_t maxTicksPerFrame = 8;
+
+  // throws std::runtime_error on unknown or malformed options.
+  static LveConfig fromArgs(int argc, char *argv[]);
+  static void printUsage(const char *programName);
+  static const char *presentModeName(VkPresentModeKHR presentMode);
+};
+
+}  // namespace lve
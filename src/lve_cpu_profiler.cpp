@@ -0,0 +1,126 @@
+#include "lve_cpu_profiler.hpp"
+
+// std
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace lve {
+
+// buffers are owned here so events of exited threads can still be written.
+struct LveCpuProfiler::Registry {
+  std::mutex mutex;
+  std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+};
+
+namespace {
+void writeJsonString(std::ostream &out, const std::string &text) {
+  out << '"';
+  for (char c : text) {
+    if (c == '"' || c == '\\') out << '\\';
+    out << c;
+  }
+  out << '"';
+}
+}  // namespace
+
+LveCpuProfiler::Registry &LveCpuProfiler::registry() {
+  static Registry instance{};
+  return instance;
+}
+
+LveCpuProfiler::ThreadBuffer &LveCpuProfiler::threadBuffer() {
+  thread_local ThreadBuffer *buffer = nullptr;
+  if (buffer != nullptr) return *buffer;
+
+  // NOTE: locks once per thread, on its first event.
+  auto &reg = registry();
+  std::lock_guard<std::mutex> lock{reg.mutex};
+  reg.buffers.push_back(std::make_unique<ThreadBuffer>());
+  buffer = reg.buffers.back().get();
+  buffer->threadId = static_cast<uint32_t>(reg.buffers.size());
+  buffer->threadName = "thread " + std::to_string(buffer->threadId);
+  return *buffer;
+}
+
+void LveCpuProfiler::record(const char *name, uint64_t startNs,
+                            uint64_t durationNs) {
+  auto &buffer = threadBuffer();
+  // single writer per buffer, only the reader needs the published count.
+  uint64_t index = buffer.written.load(std::memory_order_relaxed);
+  auto &event = buffer.events[index % EVENTS_PER_THREAD];
+  event.name.store(name, std::memory_order_relaxed);
+  event.startNs.store(startNs, std::memory_order_relaxed);
+  event.durationNs.store(durationNs, std::memory_order_relaxed);
+  buffer.written.store(index + 1, std::memory_order_release);
+}
+
+void LveCpuProfiler::setThreadName(const std::string &name) {
+  auto &buffer = threadBuffer();
+  std::lock_guard<std::mutex> lock{registry().mutex};
+  buffer.threadName = name;
+}
+
+void LveCpuProfiler::writeChromeTrace(const std::string &filepath) {
+  std::ofstream file{filepath};
+  if (!file.is_open()) {
+    throw std::runtime_error("failed to open cpu trace file: " + filepath);
+  }
+
+  struct Snapshot {
+    const char *name;
+    uint64_t startNs;
+    uint64_t durationNs;
+  };
+
+  auto &reg = registry();
+  std::lock_guard<std::mutex> lock{reg.mutex};
+  size_t eventCount = 0;
+  file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+  bool first = true;
+  for (auto &buffer : reg.buffers) {
+    file << (first ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\","
+         << "\"pid\":1,\"tid\":" << buffer->threadId << ",\"args\":{\"name\":";
+    writeJsonString(file, buffer->threadName);
+    file << "}}";
+    first = false;
+
+    uint64_t end = buffer->written.load(std::memory_order_acquire);
+    uint64_t begin = end > EVENTS_PER_THREAD ? end - EVENTS_PER_THREAD : 0;
+    std::vector<Snapshot> snapshots;
+    snapshots.reserve(end - begin);
+    for (uint64_t i = begin; i < end; i++) {
+      auto &event = buffer->events[i % EVENTS_PER_THREAD];
+      snapshots.push_back({event.name.load(std::memory_order_relaxed),
+                           event.startNs.load(std::memory_order_relaxed),
+                           event.durationNs.load(std::memory_order_relaxed)});
+    }
+    // slots the writer reused meanwhile may be torn, drop them.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t written = buffer->written.load(std::memory_order_relaxed);
+    uint64_t firstValid =
+        written > EVENTS_PER_THREAD ? written - EVENTS_PER_THREAD + 1 : 0;
+
+    file << std::fixed << std::setprecision(3);
+    for (uint64_t i = std::max(begin, firstValid); i < end; i++) {
+      auto &snapshot = snapshots[i - begin];
+      // trace_event timestamps are in microseconds.
+      file << ",\n{\"name\":";
+      writeJsonString(file, snapshot.name);
+      file << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->threadId
+           << ",\"ts\":" << snapshot.startNs * 1e-3
+           << ",\"dur\":" << snapshot.durationNs * 1e-3 << "}";
+      eventCount++;
+    }
+  }
+  file << "\n]}\n";
+  std::cout << "cpu trace: " << eventCount << " events written to "
+            << filepath << std::endl;
+}
+
+}  // namespace lve
@@ -0,0 +1,91 @@
+#pragma once
+
+// std
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace lve {
+
+// Scoped CPU timing, exported as Chrome trace_event JSON (chrome://tracing,
+// perfetto). every thread appends to its own ring buffer without locking,
+// the ring keeps the latest EVENTS_PER_THREAD events of that thread.
+// NOTE: scope names must outlive the profiler (string literals, __func__).
+class LveCpuProfiler {
+ public:
+  static constexpr size_t EVENTS_PER_THREAD = 1 << 16;
+#ifdef LVE_ENABLE_PROFILER
+  static constexpr bool ENABLED = true;
+#else
+  static constexpr bool ENABLED = false;
+#endif
+
+  class Scope {
+   public:
+    explicit Scope(const char *name) : name{name}, startNs{nowNs()} {}
+    ~Scope() { record(name, startNs, nowNs() - startNs); }
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+   private:
+    const char *name;
+    uint64_t startNs;
+  };
+
+  // ns since the first call in the process.
+  static uint64_t nowNs() {
+    using Clock = std::chrono::steady_clock;
+    static const Clock::time_point epoch = Clock::now();
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() -
+                                                             epoch)
+            .count());
+  }
+
+  static void record(const char *name, uint64_t startNs, uint64_t durationNs);
+  // shown as the thread name in the trace.
+  static void setThreadName(const std::string &name);
+  // snapshot of every thread buffer. safe while other threads record.
+  static void writeChromeTrace(const std::string &filepath);
+
+ private:
+  // fields are relaxed atomics so a reader racing the writer of a reused
+  // slot is well defined, torn events are dropped by the reader.
+  struct Event {
+    std::atomic<const char *> name{nullptr};
+    std::atomic<uint64_t> startNs{0};
+    std::atomic<uint64_t> durationNs{0};
+  };
+  struct ThreadBuffer {
+    uint32_t threadId = 0;
+    std::string threadName{};
+    // total events written, slot = written % EVENTS_PER_THREAD
+    std::atomic<uint64_t> written{0};
+    std::array<Event, EVENTS_PER_THREAD> events;
+  };
+
+  struct Registry;
+
+  static Registry &registry();
+  static ThreadBuffer &threadBuffer();
+};
+}  // namespace lve
+
+#ifdef LVE_ENABLE_PROFILER
+#define LVE_PROFILE_CONCAT_INNER(a, b) a##b
+#define LVE_PROFILE_CONCAT(a, b) LVE_PROFILE_CONCAT_INNER(a, b)
+#define LVE_PROFILE_SCOPE(name)                                 \
+  ::lve::LveCpuProfiler::Scope LVE_PROFILE_CONCAT(lveProfileScope, \
+                                                  __LINE__) {     \
+    name                                                          \
+  }
+#define LVE_PROFILE_FUNCTION() LVE_PROFILE_SCOPE(__func__)
+#define LVE_PROFILE_THREAD(name) ::lve::LveCpuProfiler::setThreadName(name)
+#else
+#define LVE_PROFILE_SCOPE(name)
+#define LVE_PROFILE_FUNCTION()
+#define LVE_PROFILE_THREAD(name)
+#endif
@@ -10,7 +10,8 @@ namespace lve {
 
 LveDescriptorSetLayout::Builder &LveDescriptorSetLayout::Builder::addBinding(
     uint32_t binding, VkDescriptorType descriptorType,
-    VkShaderStageFlags stageFlags, uint32_t count) {
+    VkShaderStageFlags stageFlags, uint32_t count,
+    VkDescriptorBindingFlags flags) {
   assert(bindings.count(binding) == 0 && "Binding already in use");
   VkDescriptorSetLayoutBinding layoutBinding{};
   layoutBinding.binding = binding;
@@ -18,32 +19,61 @@ LveDescriptorSetLayout::Builder &LveDescriptorSetLayout::Builder::addBinding(
   layoutBinding.descriptorCount = count;
   layoutBinding.stageFlags = stageFlags;
   bindings[binding] = layoutBinding;
+  if (flags != 0) {
+    bindingFlags[binding] = flags;
+  }
+  return *this;
+}
+
+LveDescriptorSetLayout::Builder &
+LveDescriptorSetLayout::Builder::setLayoutFlags(
+    VkDescriptorSetLayoutCreateFlags flags) {
+  layoutFlags = flags;
   return *this;
 }
 
 std::unique_ptr<LveDescriptorSetLayout> LveDescriptorSetLayout::Builder::build()
     const {
-  return std::make_unique<LveDescriptorSetLayout>(lveDevice, bindings);
+  return std::make_unique<LveDescriptorSetLayout>(lveDevice, bindings,
+                                                  bindingFlags, layoutFlags);
 }
 
 // *************** Descriptor Set Layout *********************
 
 LveDescriptorSetLayout::LveDescriptorSetLayout(
     LveDevice &lveDevice,
-    std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings)
+    std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings,
+    std::unordered_map<uint32_t, VkDescriptorBindingFlags> bindingFlags,
+    VkDescriptorSetLayoutCreateFlags layoutFlags)
     : lveDevice{lveDevice}, bindings{bindings} {
   std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings{};
+  // NOTE: flags array must follow the same order as pBindings
+  std::vector<VkDescriptorBindingFlags> setLayoutBindingFlags{};
   for (auto kv : bindings) {
     setLayoutBindings.push_back(kv.second);
+    auto flagIt = bindingFlags.find(kv.first);
+    setLayoutBindingFlags.push_back(
+        flagIt == bindingFlags.end() ? 0 : flagIt->second);
   }
 
   VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{};
   descriptorSetLayoutInfo.sType =
       VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  descriptorSetLayoutInfo.flags = layoutFlags;
   descriptorSetLayoutInfo.bindingCount =
       static_cast<uint32_t>(setLayoutBindings.size());
   descriptorSetLayoutInfo.pBindings = setLayoutBindings.data();
 
+  VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+  if (!bindingFlags.empty()) {
+    bindingFlagsInfo.sType =
+        VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    bindingFlagsInfo.bindingCount =
+        static_cast<uint32_t>(setLayoutBindingFlags.size());
+    bindingFlagsInfo.pBindingFlags = setLayoutBindingFlags.data();
+    descriptorSetLayoutInfo.pNext = &bindingFlagsInfo;
+  }
+
   if (vkCreateDescriptorSetLayout(lveDevice.device(), &descriptorSetLayoutInfo,
                                   nullptr,
                                   &descriptorSetLayout) != VK_SUCCESS) {
@@ -162,19 +192,21 @@ LveDescriptorWriter &LveDescriptorWriter::writeBuffer(
 }
 
 LveDescriptorWriter &LveDescriptorWriter::writeImage(
-    uint32_t binding, VkDescriptorImageInfo *imageInfo) {
+    uint32_t binding, VkDescriptorImageInfo *imageInfo, uint32_t arrayElement) {
   assert(setLayout.bindings.count(binding) == 1 &&
          "Layout does not contain specified binding");
 
   auto &bindingDescription = setLayout.bindings[binding];
 
-  assert(bindingDescription.descriptorCount == 1 &&
-         "Binding single descriptor info, but binding expects multiple");
+  // descriptor arrays are written one element at a time
+  assert(arrayElement < bindingDescription.descriptorCount &&
+         "Array element out of range for binding");
 
   VkWriteDescriptorSet write{};
   write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
   write.descriptorType = bindingDescription.descriptorType;
   write.dstBinding = binding;
+  write.dstArrayElement = arrayElement;
   write.pImageInfo = imageInfo;
   write.descriptorCount = 1;
 
@@ -16,17 +16,24 @@ class LveDescriptorSetLayout {
     Builder(LveDevice &lveDevice) : lveDevice{lveDevice} {}
 
     Builder &addBinding(uint32_t binding, VkDescriptorType descriptorType,
-                        VkShaderStageFlags stageFlags, uint32_t count = 1);
+                        VkShaderStageFlags stageFlags, uint32_t count = 1,
+                        VkDescriptorBindingFlags bindingFlags = 0);
+    Builder &setLayoutFlags(VkDescriptorSetLayoutCreateFlags flags);
     std::unique_ptr<LveDescriptorSetLayout> build() const;
 
    private:
     LveDevice &lveDevice;
     std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings{};
+    std::unordered_map<uint32_t, VkDescriptorBindingFlags> bindingFlags{};
+    VkDescriptorSetLayoutCreateFlags layoutFlags = 0;
   };
 
   LveDescriptorSetLayout(
       LveDevice &lveDevice,
-      std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings);
+      std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings,
+      std::unordered_map<uint32_t, VkDescriptorBindingFlags> bindingFlags =
+          {},
+      VkDescriptorSetLayoutCreateFlags layoutFlags = 0);
   ~LveDescriptorSetLayout();
   LveDescriptorSetLayout(const LveDescriptorSetLayout &) = delete;
   LveDescriptorSetLayout &operator=(const LveDescriptorSetLayout &) = delete;
@@ -90,7 +97,8 @@ class LveDescriptorWriter {
   LveDescriptorWriter &writeBuffer(uint32_t binding,
                                    VkDescriptorBufferInfo *bufferInfo);
   LveDescriptorWriter &writeImage(uint32_t binding,
-                                  VkDescriptorImageInfo *imageInfo);
+                                  VkDescriptorImageInfo *imageInfo,
+                                  uint32_t arrayElement = 0);
 
   bool build(VkDescriptorSet &set);
   void overwrite(VkDescriptorSet &set);
@@ -1,7 +1,13 @@
 #include "lve_device.hpp"
 
+#include "lve_cpu_profiler.hpp"
+
 // std headers
+#include <cassert>
+#include <chrono>
+#include <cstdio>
 #include <cstring>
+#include <fstream>
 #include <iostream>
 #include <set>
 #include <unordered_set>
@@ -44,15 +50,27 @@ void DestroyDebugUtilsMessengerEXT(VkInstance instance,
 
 // class member functions
 LveDevice::LveDevice(LveWindow &window) : window{window} {
+  if (window.isHeadless()) {
+    deviceExtensions.clear();
+  }
   createInstance();
   setupDebugMessenger();
   createSurface();
   pickPhysicalDevice();
   createLogicalDevice();
   createCommandPool();
+  createPipelineCache();
+
+  graphicsTimeline_ = std::make_unique<LveTimelineSemaphore>(device_);
+  computeTimeline_ = std::make_unique<LveTimelineSemaphore>(device_);
 }
 
 LveDevice::~LveDevice() {
+  savePipelineCache();
+  graphicsTimeline_.reset();
+  computeTimeline_.reset();
+  vkDestroyPipelineCache(device_, pipelineCache, nullptr);
+  vkDestroyCommandPool(device_, computeCommandPool, nullptr);
   vkDestroyCommandPool(device_, commandPool, nullptr);
   vkDestroyDevice(device_, nullptr);
 
@@ -60,7 +78,9 @@ LveDevice::~LveDevice() {
     DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
   }
 
-  vkDestroySurfaceKHR(instance, surface_, nullptr);
+  if (surface_ != VK_NULL_HANDLE) {
+    vkDestroySurfaceKHR(instance, surface_, nullptr);
+  }
   vkDestroyInstance(instance, nullptr);
 }
 
@@ -75,7 +95,7 @@ void LveDevice::createInstance() {
   appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
   appInfo.pEngineName = "No Engine";
   appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-  appInfo.apiVersion = VK_API_VERSION_1_0;
+  appInfo.apiVersion = VK_API_VERSION_1_2;
 
   VkInstanceCreateInfo createInfo = {};
   createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -143,7 +163,8 @@ void LveDevice::createLogicalDevice() {
 
   std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
   std::set<uint32_t> uniqueQueueFamilies = {
-      indices.graphicsAndComputeFamily.value(), indices.presentFamily.value()};
+      indices.graphicsAndComputeFamily.value(), indices.presentFamily.value(),
+      indices.computeFamily.value()};
 
   float queuePriority = 1.0f;
   for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -159,6 +180,8 @@ void LveDevice::createLogicalDevice() {
 
   // for smaple shading
   deviceFeatures.sampleRateShading = VK_TRUE;
+  // bindless texture array indexed by push constant
+  deviceFeatures.shaderSampledImageArrayDynamicIndexing = VK_TRUE;
 
 #ifdef _WIN32
   deviceFeatures.samplerAnisotropy = VK_TRUE;
@@ -175,6 +198,57 @@ void LveDevice::createLogicalDevice() {
   createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
   createInfo.pEnabledFeatures = &deviceFeatures;
+
+  // descriptor indexing (core in 1.2) for bindless textures
+  VkPhysicalDeviceVulkan12Features vulkan12Features{};
+  vulkan12Features.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+  vulkan12Features.runtimeDescriptorArray = VK_TRUE;
+  vulkan12Features.descriptorBindingPartiallyBound = VK_TRUE;
+  vulkan12Features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+  vulkan12Features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+  // frame synchronization between the compute and graphics submits
+  vulkan12Features.timelineSemaphore = VK_TRUE;
+
+  // optional: host side query reset for gpu timestamps
+  VkPhysicalDeviceVulkan12Features supported12Features{};
+  supported12Features.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+  VkPhysicalDeviceFeatures2 supportedFeatures2{};
+  supportedFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+  supportedFeatures2.pNext = &supported12Features;
+  vkGetPhysicalDeviceFeatures2(physicalDevice, &supportedFeatures2);
+  hostQueryResetEnabled = supported12Features.hostQueryReset == VK_TRUE;
+  vulkan12Features.hostQueryReset = supported12Features.hostQueryReset;
+
+  // optional: present id / wait for frame latency measurement.
+  VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures{};
+  presentIdFeatures.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+  VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures{};
+  presentWaitFeatures.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+  presentIdFeatures.pNext = &presentWaitFeatures;
+  if (!isHeadless() &&
+      checkOptionalExtensionSupport(physicalDevice,
+                                    VK_KHR_PRESENT_ID_EXTENSION_NAME) &&
+      checkOptionalExtensionSupport(physicalDevice,
+                                    VK_KHR_PRESENT_WAIT_EXTENSION_NAME)) {
+    VkPhysicalDeviceFeatures2 presentFeatures2{};
+    presentFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    presentFeatures2.pNext = &presentIdFeatures;
+    vkGetPhysicalDeviceFeatures2(physicalDevice, &presentFeatures2);
+    presentWaitEnabled =
+        presentIdFeatures.presentId && presentWaitFeatures.presentWait;
+  }
+  if (presentWaitEnabled) {
+    deviceExtensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+    deviceExtensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+    vulkan12Features.pNext = &presentIdFeatures;
+  }
+  std::cout << "present wait: " << presentWaitEnabled << std::endl;
+
+  createInfo.pNext = &vulkan12Features;
   createInfo.enabledExtensionCount =
       static_cast<uint32_t>(deviceExtensions.size());
   createInfo.ppEnabledExtensionNames = deviceExtensions.data();
@@ -196,38 +270,167 @@ void LveDevice::createLogicalDevice() {
 
   vkGetDeviceQueue(device_, indices.graphicsAndComputeFamily.value(), 0,
                    &graphicsQueue_);
-  vkGetDeviceQueue(device_, indices.graphicsAndComputeFamily.value(), 0,
-                   &computeQueue_);
+  vkGetDeviceQueue(device_, indices.computeFamily.value(), 0, &computeQueue_);
+  std::cout << "async compute: " << indices.hasDedicatedCompute()
+            << " (family " << indices.computeFamily.value() << ")"
+            << std::endl;
   vkGetDeviceQueue(device_, indices.presentFamily.value(), 0, &presentQueue_);
+
+  if (presentWaitEnabled) {
+    vkWaitForPresentKHR_ = reinterpret_cast<PFN_vkWaitForPresentKHR>(
+        vkGetDeviceProcAddr(device_, "vkWaitForPresentKHR"));
+    presentWaitEnabled = vkWaitForPresentKHR_ != nullptr;
+  }
+}
+
+VkResult LveDevice::waitForPresent(VkSwapchainKHR swapChain,
+                                   uint64_t presentId, uint64_t timeout) {
+  assert(presentWaitEnabled && "present wait is not enabled");
+  return vkWaitForPresentKHR_(device_, swapChain, presentId, timeout);
 }
 
 void LveDevice::createCommandPool() {
   QueueFamilyIndices queueFamilyIndices = findPhysicalQueueFamilies();
 
+  commandPool =
+      createCommandPool(queueFamilyIndices.graphicsAndComputeFamily.value());
+  computeCommandPool =
+      createCommandPool(queueFamilyIndices.computeFamily.value());
+}
+
+VkCommandPool LveDevice::createCommandPool(uint32_t queueFamilyIndex) {
   VkCommandPoolCreateInfo poolInfo = {};
   poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-  poolInfo.queueFamilyIndex =
-      queueFamilyIndices.graphicsAndComputeFamily.value();
+  poolInfo.queueFamilyIndex = queueFamilyIndex;
   poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT |
                    VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 
-  if (vkCreateCommandPool(device_, &poolInfo, nullptr, &commandPool) !=
-      VK_SUCCESS) {
+  VkCommandPool pool;
+  if (vkCreateCommandPool(device_, &poolInfo, nullptr, &pool) != VK_SUCCESS) {
     throw std::runtime_error("failed to create command pool!");
   }
+  return pool;
 }
 
 void LveDevice::createSurface() {
+  if (window.isHeadless()) {
+    surface_ = VK_NULL_HANDLE;
+    return;
+  }
   window.createWindowSurface(instance, &surface_);
 }
 
+void LveDevice::createPipelineCache() {
+  auto startTime = std::chrono::high_resolution_clock::now();
+
+  std::vector<char> cacheData;
+  std::ifstream file(pipelineCachePath, std::ios::ate | std::ios::binary);
+  if (file.is_open()) {
+    cacheData.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(cacheData.data(), cacheData.size());
+    file.close();
+  }
+
+  // NOTE: stale cache from other gpu/driver is ignored, not an error.
+  if (!cacheData.empty() && !isPipelineCacheCompatible(cacheData)) {
+    std::cout << "pipeline cache: incompatible header, ignoring "
+              << pipelineCachePath << std::endl;
+    cacheData.clear();
+  }
+
+  VkPipelineCacheCreateInfo cacheInfo{};
+  cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+  cacheInfo.initialDataSize = cacheData.size();
+  cacheInfo.pInitialData = cacheData.empty() ? nullptr : cacheData.data();
+  if (vkCreatePipelineCache(device_, &cacheInfo, nullptr, &pipelineCache) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to create pipeline cache!");
+  }
+
+  float loadMs = std::chrono::duration<float, std::chrono::milliseconds::period>(
+                     std::chrono::high_resolution_clock::now() - startTime)
+                     .count();
+  std::cout << "pipeline cache: "
+            << (cacheData.empty() ? "cold start" : "loaded") << " ("
+            << cacheData.size() << " bytes, " << loadMs << " ms)" << std::endl;
+}
+
+bool LveDevice::isPipelineCacheCompatible(const std::vector<char> &cacheData) {
+  // VkPipelineCacheHeaderVersionOne layout
+  // https://registry.khronos.org/vulkan/specs/1.3-extensions/man/html/VkPipelineCacheHeaderVersionOne.html
+  constexpr size_t headerSize = 16 + VK_UUID_SIZE;
+  if (cacheData.size() < headerSize) {
+    return false;
+  }
+  uint32_t header[4];
+  std::memcpy(header, cacheData.data(), sizeof(header));
+  uint32_t headerLength = header[0];
+  uint32_t headerVersion = header[1];
+  uint32_t vendorID = header[2];
+  uint32_t deviceID = header[3];
+  const char *cacheUUID = cacheData.data() + sizeof(header);
+
+  return headerLength >= headerSize &&
+         headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+         vendorID == properties.vendorID && deviceID == properties.deviceID &&
+         std::memcmp(cacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) ==
+             0;
+}
+
+void LveDevice::savePipelineCache() {
+  size_t cacheSize = 0;
+  if (vkGetPipelineCacheData(device_, pipelineCache, &cacheSize, nullptr) !=
+          VK_SUCCESS ||
+      cacheSize == 0) {
+    return;
+  }
+  std::vector<char> cacheData(cacheSize);
+  if (vkGetPipelineCacheData(device_, pipelineCache, &cacheSize,
+                             cacheData.data()) != VK_SUCCESS) {
+    std::cerr << "pipeline cache: failed to get cache data" << std::endl;
+    return;
+  }
+
+  // write to temp file first, so a crash never leaves a truncated cache.
+  std::string tempPath = pipelineCachePath + ".tmp";
+  {
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+      std::cerr << "pipeline cache: failed to open " << tempPath << std::endl;
+      return;
+    }
+    file.write(cacheData.data(), cacheSize);
+    file.close();
+    // a full disk only shows up in the stream state.
+    if (!file) {
+      std::cerr << "pipeline cache: failed to write " << tempPath
+                << std::endl;
+      std::remove(tempPath.c_str());
+      return;
+    }
+  }
+  // NOTE: rename replaces the target atomically on POSIX. windows refuses
+  // an existing target, only then the old cache is removed first.
+  if (std::rename(tempPath.c_str(), pipelineCachePath.c_str()) != 0 &&
+      (std::remove(pipelineCachePath.c_str()) != 0 ||
+       std::rename(tempPath.c_str(), pipelineCachePath.c_str()) != 0)) {
+    std::cerr << "pipeline cache: failed to save " << pipelineCachePath
+              << std::endl;
+    std::remove(tempPath.c_str());
+    return;
+  }
+  std::cout << "pipeline cache: saved " << cacheSize << " bytes" << std::endl;
+}
+
 bool LveDevice::isDeviceSuitable(VkPhysicalDevice device) {
   QueueFamilyIndices indices = findQueueFamilies(device);
 
   bool extensionsSupported = checkDeviceExtensionSupport(device);
 
-  bool swapChainAdequate = false;
-  if (extensionsSupported) {
+  // nothing to present to in headless mode.
+  bool swapChainAdequate = window.isHeadless();
+  if (extensionsSupported && !window.isHeadless()) {
     SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
     swapChainAdequate = !swapChainSupport.formats.empty() &&
                         !swapChainSupport.presentModes.empty();
@@ -235,22 +438,52 @@ bool LveDevice::isDeviceSuitable(VkPhysicalDevice device) {
 
   VkPhysicalDeviceFeatures supportedFeatures;
   vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
+  bool descriptorIndexingSupported = checkDescriptorIndexingSupport(device);
+  bool timelineSemaphoreSupported = checkTimelineSemaphoreSupport(device);
   std::cout << "queue family indices isComplete :" << indices.isComplete()
             << std::endl
             << "extensionsSupported: " << extensionsSupported << std::endl
             << "swapChainAdequate: " << swapChainAdequate << std::endl
+            << "descriptorIndexingSupported: " << descriptorIndexingSupported
+            << std::endl
+            << "timelineSemaphoreSupported: " << timelineSemaphoreSupported
+            << std::endl
             << "supportedFeatures.samplerAnisotropy: "
             << supportedFeatures.samplerAnisotropy << std::endl;
 
   // not sure, in WSL can not use samplerAnisotropy. may be relevant to vGPU?
 #ifdef _WIN32
   return indices.isComplete() && extensionsSupported && swapChainAdequate &&
+         descriptorIndexingSupported && timelineSemaphoreSupported &&
          supportedFeatures.samplerAnisotropy;
 #else
-  return indices.isComplete() && extensionsSupported && swapChainAdequate;
+  return indices.isComplete() && extensionsSupported && swapChainAdequate &&
+         descriptorIndexingSupported && timelineSemaphoreSupported;
 #endif
 }
 
+bool LveDevice::checkDescriptorIndexingSupport(VkPhysicalDevice device) {
+  VkPhysicalDeviceProperties deviceProperties;
+  vkGetPhysicalDeviceProperties(device, &deviceProperties);
+  if (deviceProperties.apiVersion < VK_API_VERSION_1_2) {
+    return false;
+  }
+
+  VkPhysicalDeviceVulkan12Features vulkan12Features{};
+  vulkan12Features.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+  VkPhysicalDeviceFeatures2 features2{};
+  features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+  features2.pNext = &vulkan12Features;
+  vkGetPhysicalDeviceFeatures2(device, &features2);
+
+  return features2.features.shaderSampledImageArrayDynamicIndexing &&
+         vulkan12Features.runtimeDescriptorArray &&
+         vulkan12Features.descriptorBindingPartiallyBound &&
+         vulkan12Features.descriptorBindingSampledImageUpdateAfterBind &&
+         vulkan12Features.descriptorBindingUpdateUnusedWhilePending;
+}
+
 void LveDevice::populateDebugMessengerCreateInfo(
     VkDebugUtilsMessengerCreateInfoEXT &createInfo) {
   createInfo = {};
@@ -300,12 +533,14 @@ bool LveDevice::checkValidationLayerSupport() {
 }
 
 std::vector<const char *> LveDevice::getRequiredExtensions() {
-  uint32_t glfwExtensionCount = 0;
-  const char **glfwExtensions;
-  glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-
-  std::vector<const char *> extensions(glfwExtensions,
-                                       glfwExtensions + glfwExtensionCount);
+  std::vector<const char *> extensions;
+  // surface extensions only when there is a window.
+  if (!window.isHeadless()) {
+    uint32_t glfwExtensionCount = 0;
+    const char **glfwExtensions;
+    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+    extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+  }
 
   if (enableValidationLayers) {
     extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -357,6 +592,42 @@ bool LveDevice::checkDeviceExtensionSupport(VkPhysicalDevice device) {
   return requiredExtensions.empty();
 }
 
+bool LveDevice::checkTimelineSemaphoreSupport(VkPhysicalDevice device) {
+  VkPhysicalDeviceProperties deviceProperties;
+  vkGetPhysicalDeviceProperties(device, &deviceProperties);
+  if (deviceProperties.apiVersion < VK_API_VERSION_1_2) {
+    return false;
+  }
+
+  VkPhysicalDeviceVulkan12Features vulkan12Features{};
+  vulkan12Features.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+  VkPhysicalDeviceFeatures2 features2{};
+  features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+  features2.pNext = &vulkan12Features;
+  vkGetPhysicalDeviceFeatures2(device, &features2);
+
+  return vulkan12Features.timelineSemaphore;
+}
+
+bool LveDevice::checkOptionalExtensionSupport(VkPhysicalDevice device,
+                                              const char *extensionName) {
+  uint32_t extensionCount;
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount,
+                                       nullptr);
+
+  std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount,
+                                       availableExtensions.data());
+
+  for (const auto &extension : availableExtensions) {
+    if (std::strcmp(extension.extensionName, extensionName) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
 QueueFamilyIndices LveDevice::findQueueFamilies(VkPhysicalDevice device) {
   QueueFamilyIndices indices;
 
@@ -375,8 +646,15 @@ QueueFamilyIndices LveDevice::findQueueFamilies(VkPhysicalDevice device) {
       indices.graphicsAndComputeFamily = i;
     }
 
+    // headless: never presents, the graphics queue stands in.
     VkBool32 presentSupport = false;
-    vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
+    if (window.isHeadless()) {
+      presentSupport =
+          indices.graphicsAndComputeFamily == static_cast<uint32_t>(i);
+    } else {
+      vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_,
+                                           &presentSupport);
+    }
     if (queueFamily.queueCount > 0 && presentSupport) {
       indices.presentFamily = i;
     }
@@ -387,6 +665,20 @@ QueueFamilyIndices LveDevice::findQueueFamilies(VkPhysicalDevice device) {
     i++;
   }
 
+  // compute without graphics: runs alongside the graphics queue.
+  for (uint32_t family = 0; family < queueFamilyCount; family++) {
+    const auto &queueFamily = queueFamilies[family];
+    if (queueFamily.queueCount > 0 &&
+        (queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT) &&
+        !(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)) {
+      indices.computeFamily = family;
+      break;
+    }
+  }
+  if (!indices.computeFamily.has_value()) {
+    indices.computeFamily = indices.graphicsAndComputeFamily;
+  }
+
   return indices;
 }
 
@@ -421,32 +713,48 @@ VkFormat LveDevice::findSupportedFormat(const std::vector<VkFormat> &candidates,
                                         VkImageTiling tiling,
                                         VkFormatFeatureFlags features) {
   for (VkFormat format : candidates) {
-    VkFormatProperties props;
-    vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &props);
-
-    if (tiling == VK_IMAGE_TILING_LINEAR &&
-        (props.linearTilingFeatures & features) == features) {
-      return format;
-    } else if (tiling == VK_IMAGE_TILING_OPTIMAL &&
-               (props.optimalTilingFeatures & features) == features) {
+    if (isFormatSupported(format, tiling, features)) {
       return format;
     }
   }
   throw std::runtime_error("failed to find supported format!");
 }
 
+bool LveDevice::isFormatSupported(VkFormat format, VkImageTiling tiling,
+                                  VkFormatFeatureFlags features) {
+  VkFormatProperties props;
+  vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &props);
+
+  if (tiling == VK_IMAGE_TILING_LINEAR) {
+    return (props.linearTilingFeatures & features) == features;
+  } else if (tiling == VK_IMAGE_TILING_OPTIMAL) {
+    return (props.optimalTilingFeatures & features) == features;
+  }
+  return false;
+}
+
 uint32_t LveDevice::findMemoryType(uint32_t typeFilter,
                                    VkMemoryPropertyFlags properties) {
+  uint32_t memoryTypeIndex;
+  if (!findMemoryType(typeFilter, properties, memoryTypeIndex)) {
+    throw std::runtime_error("failed to find suitable memory type!");
+  }
+  return memoryTypeIndex;
+}
+
+bool LveDevice::findMemoryType(uint32_t typeFilter,
+                               VkMemoryPropertyFlags properties,
+                               uint32_t &memoryTypeIndex) {
   VkPhysicalDeviceMemoryProperties memProperties;
   vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
   for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
     if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags &
                                     properties) == properties) {
-      return i;
+      memoryTypeIndex = i;
+      return true;
     }
   }
-
-  throw std::runtime_error("failed to find suitable memory type!");
+  return false;
 }
 
 void LveDevice::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
@@ -480,10 +788,26 @@ void LveDevice::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
 }
 
 VkCommandBuffer LveDevice::beginSingleTimeCommands() {
+  return beginSingleTimeCommands(commandPool);
+}
+
+void LveDevice::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
+  endSingleTimeCommands(commandBuffer, commandPool, graphicsQueue_);
+}
+
+VkCommandBuffer LveDevice::beginSingleTimeComputeCommands() {
+  return beginSingleTimeCommands(computeCommandPool);
+}
+
+void LveDevice::endSingleTimeComputeCommands(VkCommandBuffer commandBuffer) {
+  endSingleTimeCommands(commandBuffer, computeCommandPool, computeQueue_);
+}
+
+VkCommandBuffer LveDevice::beginSingleTimeCommands(VkCommandPool pool) {
   VkCommandBufferAllocateInfo allocInfo{};
   allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
   allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-  allocInfo.commandPool = commandPool;
+  allocInfo.commandPool = pool;
   allocInfo.commandBufferCount = 1;
 
   VkCommandBuffer commandBuffer;
@@ -497,7 +821,8 @@ VkCommandBuffer LveDevice::beginSingleTimeCommands() {
   return commandBuffer;
 }
 
-void LveDevice::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
+void LveDevice::endSingleTimeCommands(VkCommandBuffer commandBuffer,
+                                      VkCommandPool pool, VkQueue queue) {
   vkEndCommandBuffer(commandBuffer);
 
   VkSubmitInfo submitInfo{};
@@ -505,14 +830,15 @@ void LveDevice::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
   submitInfo.commandBufferCount = 1;
   submitInfo.pCommandBuffers = &commandBuffer;
 
-  vkQueueSubmit(graphicsQueue_, 1, &submitInfo, VK_NULL_HANDLE);
-  vkQueueWaitIdle(graphicsQueue_);
+  vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+  vkQueueWaitIdle(queue);
 
-  vkFreeCommandBuffers(device_, commandPool, 1, &commandBuffer);
+  vkFreeCommandBuffers(device_, pool, 1, &commandBuffer);
 }
 
 void LveDevice::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer,
                            VkDeviceSize size) {
+  LVE_PROFILE_SCOPE("copyBuffer");
   VkCommandBuffer commandBuffer = beginSingleTimeCommands();
 
   VkBufferCopy copyRegion{};
@@ -624,12 +950,44 @@ void LveDevice::createImageWithInfo(const VkImageCreateInfo &imageInfo,
 
   VkMemoryRequirements memRequirements;
   vkGetImageMemoryRequirements(device_, image, &memRequirements);
+  allocateImageMemory(
+      image, findMemoryType(memRequirements.memoryTypeBits, properties),
+      memRequirements.size, imageMemory);
+}
 
+bool LveDevice::createTransientImage(const VkImageCreateInfo &imageInfo,
+                                     VkImage &image,
+                                     VkDeviceMemory &imageMemory) {
+  assert((imageInfo.usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) &&
+         "Transient image without transient attachment usage.");
+  if (vkCreateImage(device_, &imageInfo, nullptr, &image) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create image!");
+  }
+
+  VkMemoryRequirements memRequirements;
+  vkGetImageMemoryRequirements(device_, image, &memRequirements);
+  uint32_t memoryTypeIndex;
+  bool lazilyAllocated = findMemoryType(
+      memRequirements.memoryTypeBits,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT |
+          VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT,
+      memoryTypeIndex);
+  if (!lazilyAllocated) {
+    memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits,
+                                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  }
+  allocateImageMemory(image, memoryTypeIndex, memRequirements.size,
+                      imageMemory);
+  return lazilyAllocated;
+}
+
+void LveDevice::allocateImageMemory(VkImage image, uint32_t memoryTypeIndex,
+                                    VkDeviceSize size,
+                                    VkDeviceMemory &imageMemory) {
   VkMemoryAllocateInfo allocInfo{};
   allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  allocInfo.allocationSize = memRequirements.size;
-  allocInfo.memoryTypeIndex =
-      findMemoryType(memRequirements.memoryTypeBits, properties);
+  allocInfo.allocationSize = size;
+  allocInfo.memoryTypeIndex = memoryTypeIndex;
 
   if (vkAllocateMemory(device_, &allocInfo, nullptr, &imageMemory) !=
       VK_SUCCESS) {
@@ -1,8 +1,10 @@
 #pragma once
 
+#include "lve_timeline_semaphore.hpp"
 #include "lve_window.hpp"
 
 // std lib headers
+#include <memory>
 #include <optional>
 #include <string>
 #include <vector>
@@ -18,10 +20,17 @@ struct SwapChainSupportDetails {
 struct QueueFamilyIndices {
   std::optional<uint32_t> graphicsAndComputeFamily;
   std::optional<uint32_t> presentFamily;
+  // compute only family when the device has one (async compute), otherwise
+  // the graphics family.
+  std::optional<uint32_t> computeFamily;
 
   bool isComplete() {
     return graphicsAndComputeFamily.has_value() && presentFamily.has_value();
   }
+  bool hasDedicatedCompute() const {
+    return computeFamily.has_value() &&
+           computeFamily != graphicsAndComputeFamily;
+  }
 };
 
 class LveDevice {
@@ -42,11 +51,21 @@ class LveDevice {
   LveDevice &operator=(LveDevice &&) = delete;
 
   VkCommandPool getCommandPool() { return commandPool; }
+  // compute family pool. same family as getCommandPool() without async
+  // compute.
+  VkCommandPool getComputeCommandPool() { return computeCommandPool; }
+  // every pipeline creation goes through this cache. persisted on disk.
+  VkPipelineCache getPipelineCache() { return pipelineCache; }
   VkDevice device() { return device_; }
   VkSurfaceKHR surface() { return surface_; }
   VkQueue graphicsQueue() { return graphicsQueue_; }
   VkQueue computeQueue() { return computeQueue_; }
   VkQueue presentQueue() { return presentQueue_; }
+  // one timeline per submission stream. every submit to the stream signals
+  // its next value, e.g. retire a resource once graphicsTimeline() reaches
+  // the value of the last frame that used it.
+  LveTimelineSemaphore &graphicsTimeline() { return *graphicsTimeline_; }
+  LveTimelineSemaphore &computeTimeline() { return *computeTimeline_; }
 
   SwapChainSupportDetails getSwapChainSupport() {
     return querySwapChainSupport(physicalDevice);
@@ -59,6 +78,8 @@ class LveDevice {
   VkFormat findSupportedFormat(const std::vector<VkFormat> &candidates,
                                VkImageTiling tiling,
                                VkFormatFeatureFlags features);
+  bool isFormatSupported(VkFormat format, VkImageTiling tiling,
+                         VkFormatFeatureFlags features);
 
   // Buffer Helper Functions
   void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
@@ -66,6 +87,10 @@ class LveDevice {
                     VkDeviceMemory &bufferMemory);
   VkCommandBuffer beginSingleTimeCommands();
   void endSingleTimeCommands(VkCommandBuffer commandBuffer);
+  // for resources used by the compute family, so no ownership transfer from
+  // the graphics family is needed.
+  VkCommandBuffer beginSingleTimeComputeCommands();
+  void endSingleTimeComputeCommands(VkCommandBuffer commandBuffer);
   void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
   void transitionImageLayout(VkImage image, VkFormat format,
                              VkImageLayout oldLayout, VkImageLayout newLayout,
@@ -76,10 +101,25 @@ class LveDevice {
   void createImageWithInfo(const VkImageCreateInfo &imageInfo,
                            VkMemoryPropertyFlags properties, VkImage &image,
                            VkDeviceMemory &imageMemory);
+  // attachments that live only inside a render pass (usage must include
+  // VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT). backed by lazily allocated
+  // memory when the device has it (tile based GPUs), device local otherwise.
+  // returns true when lazily allocated.
+  bool createTransientImage(const VkImageCreateInfo &imageInfo, VkImage &image,
+                            VkDeviceMemory &imageMemory);
   VkImageView createImageView(VkImage image, VkFormat format,
                               VkImageAspectFlags aspectFlags,
                               uint32_t mipLevels = 1u);
   VkSampleCountFlagBits getSampleCount() { return msaaSamples; }
+  // no surface / swap chain. frames are rendered into offscreen images.
+  bool isHeadless() const { return window.isHeadless(); }
+  // timestamp queries can be reset from the host (no reset command needed).
+  bool isHostQueryResetEnabled() const { return hostQueryResetEnabled; }
+  // VK_KHR_present_id + VK_KHR_present_wait, used for latency measurement.
+  bool isPresentWaitEnabled() const { return presentWaitEnabled; }
+  // only valid when isPresentWaitEnabled().
+  VkResult waitForPresent(VkSwapchainKHR swapChain, uint64_t presentId,
+                          uint64_t timeout);
 
   VkPhysicalDeviceProperties properties;
 
@@ -90,6 +130,18 @@ class LveDevice {
   void pickPhysicalDevice();
   void createLogicalDevice();
   void createCommandPool();
+  VkCommandPool createCommandPool(uint32_t queueFamilyIndex);
+  VkCommandBuffer beginSingleTimeCommands(VkCommandPool pool);
+  void endSingleTimeCommands(VkCommandBuffer commandBuffer,
+                             VkCommandPool pool, VkQueue queue);
+  void createPipelineCache();
+  void savePipelineCache();
+  bool isPipelineCacheCompatible(const std::vector<char> &cacheData);
+  // false when no memory type matches.
+  bool findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties,
+                      uint32_t &memoryTypeIndex);
+  void allocateImageMemory(VkImage image, uint32_t memoryTypeIndex,
+                           VkDeviceSize size, VkDeviceMemory &imageMemory);
 
   // helper functions
   bool isDeviceSuitable(VkPhysicalDevice device);
@@ -100,6 +152,10 @@ class LveDevice {
       VkDebugUtilsMessengerCreateInfoEXT &createInfo);
   void hasGflwRequiredInstanceExtensions();
   bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+  bool checkDescriptorIndexingSupport(VkPhysicalDevice device);
+  bool checkTimelineSemaphoreSupport(VkPhysicalDevice device);
+  bool checkOptionalExtensionSupport(VkPhysicalDevice device,
+                                     const char *extensionName);
   SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
   bool hasStencilComponent(VkFormat format);
   VkSampleCountFlagBits getMaxUsableSampleCount();
@@ -109,19 +165,30 @@ class LveDevice {
   VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
   LveWindow &window;
   VkCommandPool commandPool;
+  VkCommandPool computeCommandPool;
+  VkPipelineCache pipelineCache = VK_NULL_HANDLE;
 
   VkDevice device_;
   VkSurfaceKHR surface_;
   VkQueue graphicsQueue_;
   VkQueue computeQueue_;
   VkQueue presentQueue_;
+  std::unique_ptr<LveTimelineSemaphore> graphicsTimeline_;
+  std::unique_ptr<LveTimelineSemaphore> computeTimeline_;
+
+  // relative to working directory
+  const std::string pipelineCachePath = "pipeline_cache.bin";
 
   const std::vector<const char *> validationLayers = {
       "VK_LAYER_KHRONOS_validation"};
-  const std::vector<const char *> deviceExtensions = {
+  // NOTE: emptied in headless mode, VK_KHR_swapchain is not required there.
+  std::vector<const char *> deviceExtensions = {
       VK_KHR_SWAPCHAIN_EXTENSION_NAME};
 
   VkSampleCountFlagBits msaaSamples = VK_SAMPLE_COUNT_1_BIT;
+  bool hostQueryResetEnabled = false;
+  bool presentWaitEnabled = false;
+  PFN_vkWaitForPresentKHR vkWaitForPresentKHR_ = nullptr;
 };
 
 }  // namespace lve
\ No newline at end of file
@@ -0,0 +1,56 @@
+#include "lve_dynamic_resolution.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace lve {
+
+namespace {
+constexpr float SMOOTHING = .1f;
+}  // namespace
+
+LveDynamicResolution::LveDynamicResolution(const Settings &settings)
+    : settings{settings}, scale{settings.maxScale} {
+  if (settings.minScale <= 0.f || settings.minScale > settings.maxScale ||
+      settings.maxScale > 1.f) {
+    throw std::runtime_error("invalid dynamic resolution scale range!");
+  }
+}
+
+float LveDynamicResolution::update(float gpuMs) {
+  if (!isEnabled() || gpuMs <= 0.f) return scale;
+
+  smoothedMs = smoothedMs == 0.f
+                   ? gpuMs
+                   : smoothedMs + SMOOTHING * (gpuMs - smoothedMs);
+  if (cooldown > 0) {
+    cooldown--;
+    return scale;
+  }
+
+  float upper = settings.targetMs * (1.f + settings.hysteresis);
+  float lower = settings.targetMs * (1.f - settings.hysteresis);
+  bool overBudget = smoothedMs > upper && scale > settings.minScale;
+  bool underBudget = smoothedMs < lower && scale < settings.maxScale;
+  if (!overBudget && !underBudget) return scale;
+
+  // cost ~ scale^2, aim for the middle of the band.
+  float wanted = scale * std::sqrt(settings.targetMs / smoothedMs);
+  wanted = overBudget ? std::floor(wanted / SCALE_STEP) * SCALE_STEP
+                      : std::ceil(wanted / SCALE_STEP) * SCALE_STEP;
+  // at least one step, otherwise a small error never moves the scale.
+  wanted = overBudget ? std::min(wanted, scale - SCALE_STEP)
+                      : std::max(wanted, scale + SCALE_STEP);
+  float newScale = std::clamp(wanted, settings.minScale, settings.maxScale);
+
+  // predicted time at the new scale, so the old samples do not push further.
+  float ratio = newScale / scale;
+  smoothedMs *= ratio * ratio;
+  scale = newScale;
+  cooldown = settings.cooldownFrames;
+  return scale;
+}
+
+}  // namespace lve
@@ -0,0 +1,44 @@
+#pragma once
+
+// std
+#include <cstdint>
+
+namespace lve {
+
+// Picks the render scale that keeps the GPU frame time at a target.
+// frame cost is assumed to follow the pixel count (scale^2). the scale only
+// moves when the smoothed time leaves the band target * (1 +- hysteresis),
+// and then waits cooldownFrames for the measurements to catch up.
+class LveDynamicResolution {
+ public:
+  struct Settings {
+    // <= 0 : disabled, always maxScale.
+    float targetMs = 0.f;
+    float minScale = .5f;
+    float maxScale = 1.f;
+    float hysteresis = .1f;
+    // timestamps are read frames in flight later, plus the smoothing.
+    uint32_t cooldownFrames = 30;
+  };
+
+  explicit LveDynamicResolution(const Settings &settings);
+
+  LveDynamicResolution(const LveDynamicResolution &) = delete;
+  LveDynamicResolution &operator=(const LveDynamicResolution &) = delete;
+
+  // gpuMs <= 0 : no measurement this frame. returns the scale to use.
+  float update(float gpuMs);
+  float getScale() const { return scale; }
+  bool isEnabled() const { return settings.targetMs > 0.f; }
+
+ private:
+  // keeps the scale on a coarse grid so it does not jitter every update.
+  static constexpr float SCALE_STEP = 1.f / 32.f;
+
+  Settings settings;
+  float scale;
+  // exponential moving average of the measured gpu time
+  float smoothedMs = 0.f;
+  uint32_t cooldown = 0;
+};
+}  // namespace lve
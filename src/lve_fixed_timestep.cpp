@@ -0,0 +1,38 @@
+#include "lve_fixed_timestep.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace lve {
+
+LveFixedTimestep::LveFixedTimestep(const Settings &settings)
+    : settings{settings}, tickTime{1.f / settings.tickRate} {
+  if (!(settings.tickRate > 0.f) || settings.maxTicksPerFrame == 0) {
+    throw std::runtime_error("invalid fixed timestep settings!");
+  }
+}
+
+uint32_t LveFixedTimestep::advance(float frameTime) {
+  accumulator += std::max(frameTime, 0.f);
+  uint32_t ticks = 0;
+  while (accumulator >= tickTime && ticks < settings.maxTicksPerFrame) {
+    accumulator -= tickTime;
+    ticks++;
+  }
+  // behind by more than the cap, keep only the partial tick.
+  if (accumulator >= tickTime) {
+    double kept = std::fmod(accumulator, static_cast<double>(tickTime));
+    droppedTime += accumulator - kept;
+    accumulator = kept;
+  }
+  tickCount += ticks;
+  return ticks;
+}
+
+float LveFixedTimestep::getInterpolation() const {
+  return static_cast<float>(accumulator / tickTime);
+}
+
+}  // namespace lve
@@ -0,0 +1,43 @@
+#pragma once
+
+// std
+#include <cstdint>
+
+namespace lve {
+
+// Turns variable frame times into a whole number of fixed simulation ticks.
+// frame time is accumulated and spent in ticks of 1 / tickRate seconds, the
+// rest carries over to the next frame. rendering blends the last two ticks
+// by getInterpolation(), so it lags one tick behind the simulation.
+// at most maxTicksPerFrame run per frame, time beyond that is dropped so a
+// slow frame cannot make the next one slower (spiral of death).
+class LveFixedTimestep {
+ public:
+  struct Settings {
+    float tickRate = 60.f;
+    uint32_t maxTicksPerFrame = 8;
+  };
+
+  explicit LveFixedTimestep(const Settings &settings);
+
+  LveFixedTimestep(const LveFixedTimestep &) = delete;
+  LveFixedTimestep &operator=(const LveFixedTimestep &) = delete;
+
+  // adds frameTime, returns the ticks to simulate this frame.
+  uint32_t advance(float frameTime);
+  float getTickTime() const { return tickTime; }
+  // [0, 1), weight of the latest tick against the one before.
+  float getInterpolation() const;
+  uint64_t getTickCount() const { return tickCount; }
+  // seconds dropped by the catch up limit.
+  double getDroppedTime() const { return droppedTime; }
+
+ private:
+  Settings settings;
+  float tickTime;
+  // NOTE: double, small frame times must not vanish in a large remainder.
+  double accumulator = 0.0;
+  uint64_t tickCount = 0;
+  double droppedTime = 0.0;
+};
+}  // namespace lve
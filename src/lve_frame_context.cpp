@@ -0,0 +1,18 @@
+#include "lve_frame_context.hpp"
+
+// std
+#include <stdexcept>
+#include <string>
+
+namespace lve {
+
+LveFrameContext::LveFrameContext(uint32_t framesInFlight)
+    : framesInFlight{framesInFlight} {
+  if (framesInFlight < MIN_FRAMES_IN_FLIGHT ||
+      framesInFlight > MAX_FRAMES_IN_FLIGHT) {
+    throw std::runtime_error("frames in flight must be in [" +
+                             std::to_string(MIN_FRAMES_IN_FLIGHT) + ", " +
+                             std::to_string(MAX_FRAMES_IN_FLIGHT) + "]");
+  }
+}
+}  // namespace lve
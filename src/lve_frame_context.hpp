@@ -0,0 +1,35 @@
+#pragma once
+
+// std
+#include <cstdint>
+
+namespace lve {
+
+// Number of frames the CPU may record ahead of the GPU. every per frame
+// resource (command buffers, sync objects, ubos, descriptor sets, ...) is
+// sized from the one instance owned by the app.
+// 1 : lowest latency, CPU and GPU never overlap. 3 : more throughput on heavy
+// scenes at the cost of one more frame of latency.
+class LveFrameContext {
+ public:
+  static constexpr uint32_t MIN_FRAMES_IN_FLIGHT = 1;
+  static constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 4;
+
+  explicit LveFrameContext(uint32_t framesInFlight = 2);
+
+  LveFrameContext(const LveFrameContext &) = delete;
+  LveFrameContext &operator=(const LveFrameContext &) = delete;
+
+  uint32_t getFramesInFlight() const { return framesInFlight; }
+  int nextFrameIndex(int frameIndex) const {
+    return (frameIndex + 1) % static_cast<int>(framesInFlight);
+  }
+  int previousFrameIndex(int frameIndex) const {
+    return (frameIndex + static_cast<int>(framesInFlight) - 1) %
+           static_cast<int>(framesInFlight);
+  }
+
+ private:
+  const uint32_t framesInFlight;
+};
+}  // namespace lve
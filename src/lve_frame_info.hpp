@@ -8,10 +8,11 @@
 
 namespace lve {
 
-#define MAX_LIGHTS 10
+class LveGpuProfiler;
 
+// NOTE: lights are stored in a storage buffer (see ClusteredLightSystem).
 struct PointLight {
-  glm::vec4 position{};  // ignore w
+  glm::vec4 position{};  // w as radius of influence
   glm::vec4 color{};     // w as intensity
 };
 
@@ -21,8 +22,12 @@ struct GlobalUbo {
   alignas(16) glm::mat4 inverseView{1.f};
   alignas(16) glm::vec4 ambientLightColor{1.f, 1.f, 1.f,
                                           .02f};  // w as intensity
-  PointLight pointLights[MAX_LIGHTS];
-  int numLights;
+  // xyz: cluster grid dimension, w: number of lights
+  alignas(16) glm::uvec4 clusterCounts{};
+  // x: near, y: far, z: depth slice scale, w: depth slice bias
+  alignas(16) glm::vec4 clusterDepthParams{};
+  // xy: render target size, zw: 1 / size
+  alignas(16) glm::vec4 screenSize{};
 };
 
 struct FrameInfo {
@@ -32,5 +37,12 @@ struct FrameInfo {
   LveCamera &camera;
   VkDescriptorSet globalDescriptorSet;
   LveGameObject::Map &gameObjects;
+  // optional, systems record their gpu scopes when set.
+  LveGpuProfiler *gpuProfiler = nullptr;
+  // fixed simulation ticks of this frame, frameTime is tickCount ticks.
+  uint32_t tickCount = 0;
+  float tickTime = 0.f;
+  // blend of the last two ticks to draw (see LveFixedTimestep).
+  float interpolation = 1.f;
 };
 }  // namespace lve
\ No newline at end of file
@@ -1,5 +1,8 @@
 #include "lve_game_object.hpp"
 
+// libs
+#include <glm/gtc/constants.hpp>
+
 namespace lve {
 
 glm::mat4 TransformComponent::mat4() {
@@ -59,6 +62,20 @@ glm::mat3 TransformComponent::normalMatrix() {
   };
 }
 
+TransformComponent TransformComponent::interpolate(
+    const TransformComponent &from, const TransformComponent &to,
+    float alpha) {
+  TransformComponent result{};
+  result.translation = glm::mix(from.translation, to.translation, alpha);
+  result.scale = glm::mix(from.scale, to.scale, alpha);
+  // NOTE: wrapped angles (e.g. 2pi -> 0) must not spin back the long way.
+  glm::vec3 delta = to.rotation - from.rotation;
+  delta -= glm::two_pi<float>() *
+           glm::floor((delta + glm::pi<float>()) / glm::two_pi<float>());
+  result.rotation = from.rotation + delta * alpha;
+  return result;
+}
+
 LveGameObject LveGameObject::makePointLight(float intensity, float radius,
                                             glm::vec3 rotationCenter,
                                             float rotationRadius, float angle,
@@ -26,6 +26,11 @@ struct TransformComponent {
   // https://en.wikipedia.org/wiki/Euler_angles#Rotation_matrix
   glm::mat4 mat4();
   glm::mat3 normalMatrix();
+
+  // component wise blend, angles along the shorter way around.
+  static TransformComponent interpolate(const TransformComponent &from,
+                                        const TransformComponent &to,
+                                        float alpha);
 };
 
 struct PointLightComponent {
@@ -58,9 +63,16 @@ class LveGameObject {
   LveGameObject &operator=(LveGameObject &&) = default;
 
   id_t getId() const { return id; }
+  // transform to draw between the last two simulation ticks.
+  TransformComponent getInterpolatedTransform(float alpha) const {
+    return TransformComponent::interpolate(previousTransform, transform,
+                                           alpha);
+  }
 
   glm::vec3 color{};
   TransformComponent transform{};
+  // transform before the last simulation tick.
+  TransformComponent previousTransform{};
   RigidBodyComponent rigidBody{};
 
   // Optional pointer components
@@ -0,0 +1,178 @@
+#include "lve_gpu_profiler.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <stdexcept>
+
+namespace lve {
+
+LveGpuProfiler::Scope::Scope(FrameInfo& frameInfo, const char* name)
+    : frameInfo{frameInfo}, scope{INVALID_SCOPE} {
+  if (frameInfo.gpuProfiler == nullptr) return;
+  scope = frameInfo.gpuProfiler->beginScope(frameInfo.commandBuffer,
+                                            frameInfo.frameIndex, name);
+}
+
+LveGpuProfiler::Scope::~Scope() {
+  if (frameInfo.gpuProfiler == nullptr) return;
+  frameInfo.gpuProfiler->endScope(frameInfo.commandBuffer,
+                                  frameInfo.frameIndex, scope);
+}
+
+LveGpuProfiler::LveGpuProfiler(LveDevice& device,
+                               const LveFrameContext& frameContext,
+                               std::string queueName)
+    : lveDevice{device}, queueName{std::move(queueName)} {
+  enabled = lveDevice.isHostQueryResetEnabled() &&
+            lveDevice.properties.limits.timestampComputeAndGraphics;
+  if (!enabled) {
+    std::cout << "gpu timestamps not supported, " << this->queueName
+              << " profiler disabled" << std::endl;
+    return;
+  }
+
+  frames.resize(frameContext.getFramesInFlight());
+  for (auto& frame : frames) {
+    VkQueryPoolCreateInfo queryPoolInfo{};
+    queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolInfo.queryCount = MAX_SCOPES * 2;
+    if (vkCreateQueryPool(lveDevice.device(), &queryPoolInfo, nullptr,
+                          &frame.queryPool) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create timestamp query pool!");
+    }
+    // queries must be reset before first use.
+    vkResetQueryPool(lveDevice.device(), frame.queryPool, 0, MAX_SCOPES * 2);
+    frame.scopeNameIds.reserve(MAX_SCOPES);
+  }
+}
+
+LveGpuProfiler::~LveGpuProfiler() {
+  for (auto& frame : frames) {
+    vkDestroyQueryPool(lveDevice.device(), frame.queryPool, nullptr);
+  }
+}
+
+void LveGpuProfiler::beginFrame(int frameIndex) {
+  if (!enabled) return;
+
+  auto& frame = frames[frameIndex];
+  if (!frame.scopeNameIds.empty()) {
+    readResults(frame);
+    vkResetQueryPool(lveDevice.device(), frame.queryPool, 0,
+                     static_cast<uint32_t>(frame.scopeNameIds.size()) * 2);
+    frame.scopeNameIds.clear();
+  }
+}
+
+void LveGpuProfiler::readResults(FrameQueries& frame) {
+  uint32_t queryCount = static_cast<uint32_t>(frame.scopeNameIds.size()) * 2;
+  // [timestamp, availability] per query. no WAIT bit, skip unavailable.
+  std::vector<uint64_t> results(queryCount * 2);
+  vkGetQueryPoolResults(
+      lveDevice.device(), frame.queryPool, 0, queryCount,
+      results.size() * sizeof(uint64_t), results.data(), 2 * sizeof(uint64_t),
+      VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+  // timestampPeriod: nanoseconds per tick
+  double msPerTick = lveDevice.properties.limits.timestampPeriod * 1e-6;
+  std::vector<float> frameMs(histories.size(), 0.f);
+  std::vector<bool> measured(histories.size(), false);
+  for (size_t scope = 0; scope < frame.scopeNameIds.size(); scope++) {
+    const uint64_t* begin = &results[scope * 4];
+    const uint64_t* end = &results[scope * 4 + 2];
+    // never ended scopes stay unavailable.
+    if (begin[1] == 0 || end[1] == 0 || end[0] < begin[0]) continue;
+
+    uint32_t nameId = frame.scopeNameIds[scope];
+    frameMs[nameId] += static_cast<float>((end[0] - begin[0]) * msPerTick);
+    measured[nameId] = true;
+  }
+
+  for (size_t nameId = 0; nameId < histories.size(); nameId++) {
+    if (!measured[nameId]) continue;
+    auto& history = histories[nameId];
+    if (history.samples.size() < HISTORY_SIZE) {
+      history.samples.push_back(frameMs[nameId]);
+    } else {
+      history.samples[history.next] = frameMs[nameId];
+    }
+    history.next = (history.next + 1) % HISTORY_SIZE;
+  }
+}
+
+uint32_t LveGpuProfiler::getNameId(const char* name) {
+  auto it = nameIds.find(name);
+  if (it != nameIds.end()) return it->second;
+
+  uint32_t nameId = static_cast<uint32_t>(scopeNames.size());
+  nameIds.emplace(name, nameId);
+  scopeNames.emplace_back(name);
+  histories.emplace_back();
+  histories.back().samples.reserve(HISTORY_SIZE);
+  return nameId;
+}
+
+uint32_t LveGpuProfiler::beginScope(VkCommandBuffer commandBuffer,
+                                    int frameIndex, const char* name,
+                                    VkPipelineStageFlagBits stage) {
+  if (!enabled) return INVALID_SCOPE;
+  auto& frame = frames[frameIndex];
+  if (frame.scopeNameIds.size() >= MAX_SCOPES) return INVALID_SCOPE;
+
+  uint32_t scope = static_cast<uint32_t>(frame.scopeNameIds.size());
+  frame.scopeNameIds.push_back(getNameId(name));
+  vkCmdWriteTimestamp(commandBuffer, stage, frame.queryPool, scope * 2);
+  return scope;
+}
+
+void LveGpuProfiler::endScope(VkCommandBuffer commandBuffer, int frameIndex,
+                              uint32_t scope, VkPipelineStageFlagBits stage) {
+  if (scope == INVALID_SCOPE) return;
+  auto& frame = frames[frameIndex];
+  assert(scope < frame.scopeNameIds.size() && "Unknown gpu profiler scope.");
+
+  vkCmdWriteTimestamp(commandBuffer, stage, frame.queryPool, scope * 2 + 1);
+}
+
+float LveGpuProfiler::getLastMs(const std::string& name) const {
+  auto it = nameIds.find(name);
+  if (it == nameIds.end()) return 0.f;
+  auto& history = histories[it->second];
+  if (history.samples.empty()) return 0.f;
+  size_t last =
+      history.next == 0 ? history.samples.size() - 1 : history.next - 1;
+  return history.samples[last];
+}
+
+LveGpuProfiler::Stats LveGpuProfiler::getStats(const std::string& name) const {
+  Stats stats{};
+  auto it = nameIds.find(name);
+  if (it == nameIds.end()) return stats;
+  auto& history = histories[it->second];
+  if (history.samples.empty()) return stats;
+
+  size_t count = history.samples.size();
+  stats.lastMs = getLastMs(name);
+  stats.sampleCount = count;
+
+  std::vector<float> sorted = history.samples;
+  std::sort(sorted.begin(), sorted.end());
+  float total = 0.f;
+  for (float sample : sorted) total += sample;
+  stats.averageMs = total / static_cast<float>(count);
+  // nearest rank
+  auto percentile = [&](float p) {
+    size_t rank = static_cast<size_t>(p * static_cast<float>(count - 1) + 0.5f);
+    return sorted[std::min(rank, count - 1)];
+  };
+  stats.p50Ms = percentile(0.50f);
+  stats.p95Ms = percentile(0.95f);
+  stats.p99Ms = percentile(0.99f);
+  stats.maxMs = sorted.back();
+  return stats;
+}
+
+}  // namespace lve
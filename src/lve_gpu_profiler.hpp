@@ -0,0 +1,101 @@
+#pragma once
+
+#include "lve_device.hpp"
+#include "lve_frame_context.hpp"
+#include "lve_frame_info.hpp"
+
+// std
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace lve {
+
+// Named GPU timestamp scopes, one query pool per frame in flight.
+// results are read back when the frame slot comes around again, so reading
+// never stalls (the previous use of that slot is already waited).
+// a scope name used several times in a frame is summed for that frame.
+// NOTE: one profiler per queue (the pool of a slot is reset after the wait
+// of that queue only). not thread safe, record scopes on the main thread.
+class LveGpuProfiler {
+ public:
+  static constexpr uint32_t MAX_SCOPES = 32;
+  static constexpr uint32_t INVALID_SCOPE = ~0u;
+  // rolling window for the statistics, in frames.
+  static constexpr size_t HISTORY_SIZE = 240;
+
+  struct Stats {
+    float lastMs = 0.f;
+    float averageMs = 0.f;
+    float p50Ms = 0.f;
+    float p95Ms = 0.f;
+    float p99Ms = 0.f;
+    float maxMs = 0.f;
+    size_t sampleCount = 0;
+  };
+
+  // RAII scope in frameInfo.commandBuffer. no-op without frameInfo.gpuProfiler.
+  class Scope {
+   public:
+    Scope(FrameInfo &frameInfo, const char *name);
+    ~Scope();
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+   private:
+    FrameInfo &frameInfo;
+    uint32_t scope;
+  };
+
+  LveGpuProfiler(LveDevice &device, const LveFrameContext &frameContext,
+                 std::string queueName);
+  ~LveGpuProfiler();
+
+  LveGpuProfiler(const LveGpuProfiler &) = delete;
+  LveGpuProfiler &operator=(const LveGpuProfiler &) = delete;
+
+  // NOTE: call after the frame slot wait, before recording any scope.
+  void beginFrame(int frameIndex);
+  // begin and end may be recorded into different command buffers of the
+  // same queue and frame. returns INVALID_SCOPE when disabled or full.
+  uint32_t beginScope(
+      VkCommandBuffer commandBuffer, int frameIndex, const char *name,
+      VkPipelineStageFlagBits stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+  void endScope(
+      VkCommandBuffer commandBuffer, int frameIndex, uint32_t scope,
+      VkPipelineStageFlagBits stage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+
+  bool isEnabled() const { return enabled; }
+  const std::string &getQueueName() const { return queueName; }
+  // in order of first use.
+  const std::vector<std::string> &getScopeNames() const { return scopeNames; }
+  // zero stats for unknown names.
+  Stats getStats(const std::string &name) const;
+  // latest sample only, cheap enough to poll every frame.
+  float getLastMs(const std::string &name) const;
+
+ private:
+  struct FrameQueries {
+    VkQueryPool queryPool = VK_NULL_HANDLE;
+    // name id of every scope recorded this frame, 2 queries per scope.
+    std::vector<uint32_t> scopeNameIds;
+  };
+  struct History {
+    std::vector<float> samples;
+    size_t next = 0;
+  };
+
+  void readResults(FrameQueries &frame);
+  uint32_t getNameId(const char *name);
+
+  LveDevice &lveDevice;
+  std::string queueName;
+  bool enabled = false;
+
+  std::vector<FrameQueries> frames;
+  std::unordered_map<std::string, uint32_t> nameIds;
+  std::vector<std::string> scopeNames;
+  std::vector<History> histories;
+};
+}  // namespace lve
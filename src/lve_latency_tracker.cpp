@@ -0,0 +1,87 @@
+#include "lve_latency_tracker.hpp"
+
+// std
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+namespace lve {
+
+LveLatencyTracker::LveLatencyTracker()
+    : startTime{std::chrono::high_resolution_clock::now()} {}
+
+double LveLatencyTracker::nowMs() const {
+  return std::chrono::duration<double, std::chrono::milliseconds::period>(
+             std::chrono::high_resolution_clock::now() - startTime)
+      .count();
+}
+
+void LveLatencyTracker::markInput() {
+  current = FrameRecord{};
+  current.frameNumber = frameNumber++;
+  current.inputMs = nowMs();
+}
+
+void LveLatencyTracker::markSubmit() { current.submitMs = nowMs(); }
+
+void LveLatencyTracker::markPresent(uint64_t presentId) {
+  current.presentMs = nowMs();
+  current.presentId = presentId;
+  if (records.size() >= MAX_RECORDS) return;
+
+  records.push_back(current);
+  if (presentId != 0) {
+    pending.push_back(records.size() - 1);
+  }
+}
+
+void LveLatencyTracker::pollPresented(
+    const std::function<bool(uint64_t)> &isPresented) {
+  // ids are presented in order, stop at the first one still queued.
+  while (!pending.empty()) {
+    auto &record = records[pending.front()];
+    if (!isPresented(record.presentId)) break;
+    record.displayMs = nowMs();
+    pending.pop_front();
+  }
+}
+
+void LveLatencyTracker::dropPending() { pending.clear(); }
+
+double LveLatencyTracker::getAverageLatencyMs() const {
+  if (records.empty()) return 0.0;
+  double total = 0.0;
+  for (auto &record : records) {
+    double endMs = record.displayMs >= 0.0 ? record.displayMs
+                                           : record.presentMs;
+    total += endMs - record.inputMs;
+  }
+  return total / static_cast<double>(records.size());
+}
+
+void LveLatencyTracker::writeCsv(const std::string &filepath,
+                                 const std::string &presentModeName) const {
+  std::ofstream file{filepath};
+  if (!file.is_open()) {
+    throw std::runtime_error("failed to open file: " + filepath);
+  }
+
+  file << "frame,present_mode,present_id,input_ms,submit_ms,present_ms,"
+          "display_ms,input_to_present_ms,input_to_display_ms\n";
+  for (auto &record : records) {
+    file << record.frameNumber << "," << presentModeName << ","
+         << record.presentId << "," << record.inputMs << ","
+         << record.submitMs << "," << record.presentMs << ",";
+    // empty display columns when unknown
+    if (record.displayMs >= 0.0) {
+      file << record.displayMs << ","
+           << record.presentMs - record.inputMs << ","
+           << record.displayMs - record.inputMs << "\n";
+    } else {
+      file << "," << record.presentMs - record.inputMs << ",\n";
+    }
+  }
+  std::cout << "latency: " << records.size() << " frames written to "
+            << filepath << std::endl;
+}
+}  // namespace lve
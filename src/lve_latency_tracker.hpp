@@ -0,0 +1,66 @@
+#pragma once
+
+// std
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace lve {
+
+// Per frame input-to-present latency. all times are ms since construction.
+// with VK_KHR_present_wait the display time is known, otherwise only the CPU
+// side timestamps (input sampled, submitted, present returned) are recorded.
+class LveLatencyTracker {
+ public:
+  struct FrameRecord {
+    uint64_t frameNumber = 0;
+    // 0: frame was not presented with a present id.
+    uint64_t presentId = 0;
+    double inputMs = 0.0;
+    double submitMs = 0.0;
+    double presentMs = 0.0;
+    // < 0 : unknown (no present wait or swap chain recreated meanwhile).
+    double displayMs = -1.0;
+  };
+
+  // records beyond this are dropped, keeps long sessions bounded.
+  static constexpr size_t MAX_RECORDS = 1 << 18;
+
+  LveLatencyTracker();
+
+  LveLatencyTracker(const LveLatencyTracker &) = delete;
+  LveLatencyTracker &operator=(const LveLatencyTracker &) = delete;
+
+  // call right after polling input for the frame.
+  void markInput();
+  void markSubmit();
+  // returns the present id to attach, ids increase monotonically.
+  uint64_t nextPresentId() { return ++lastPresentId; }
+  void markPresent(uint64_t presentId);
+  // NOTE: isPresented must not block (timeout 0). the display time is the
+  // time of the poll, so its resolution is one poll interval.
+  void pollPresented(const std::function<bool(uint64_t)> &isPresented);
+  // present ids belong to a swap chain, forget them when it is recreated.
+  void dropPending();
+
+  size_t getRecordCount() const { return records.size(); }
+  // input -> display when known, input -> present call otherwise.
+  double getAverageLatencyMs() const;
+  void writeCsv(const std::string &filepath,
+                const std::string &presentModeName) const;
+
+ private:
+  double nowMs() const;
+
+  std::chrono::high_resolution_clock::time_point startTime;
+  FrameRecord current{};
+  std::vector<FrameRecord> records;
+  // indices into records, waiting for their present id.
+  std::deque<size_t> pending;
+  uint64_t frameNumber = 0;
+  uint64_t lastPresentId = 0;
+};
+}  // namespace lve
@@ -1,5 +1,6 @@
 #include "lve_model.hpp"
 
+#include "lve_cpu_profiler.hpp"
 #include "lve_utils.hpp"
 
 // libs
@@ -131,8 +132,12 @@ void LveModel::createTextureImage(const std::string& texture_path,
   }
   int texWidth, texHeight, texChannels;
   std::cout << texture_path << std::endl;
-  stbi_uc* pixels = stbi_load(texture_path.c_str(), &texWidth, &texHeight,
-                              &texChannels, STBI_rgb_alpha);
+  stbi_uc* pixels = nullptr;
+  {
+    LVE_PROFILE_SCOPE("stbi_load");
+    pixels = stbi_load(texture_path.c_str(), &texWidth, &texHeight,
+                       &texChannels, STBI_rgb_alpha);
+  }
 
   if (!pixels) {
     std::cout << "reason: " << stbi_failure_reason() << std::endl;
@@ -265,6 +270,7 @@ LveModel::Vertex::getAttributeDescriptions() {
 }
 
 void LveModel::Builder::loadModel(const std::string& filepath) {
+  LVE_PROFILE_SCOPE("loadModel");
   tinyobj::attrib_t attrib;
   std::vector<tinyobj::shape_t> shapes;
   std::vector<tinyobj::material_t> materials;
@@ -2,6 +2,7 @@
 
 #include "lve_buffer.hpp"
 #include "lve_device.hpp"
+#include "lve_texture_registry.hpp"
 #include "tut_texture.hpp"
 
 // libs
@@ -59,7 +60,8 @@ class LveModel {
   // if no texture image exists, return nullptr.
   tut::TutImage *getTextureImagePtr() { return textureImage.get(); }
   VkImageView getTextureImageView() { return textureImageView; }
-  VkDescriptorSet textureDescriptorSet = VK_NULL_HANDLE;
+  // slot in the bindless texture array.
+  uint32_t textureIndex = LveTextureRegistry::INVALID_INDEX;
 
  private:
   void createVertexBuffers(const std::vector<Vertex> &vertices);
@@ -15,9 +15,22 @@
 
 namespace lve {
 
+VkSpecializationInfo PipelineSpecialization::getInfo() const {
+  VkSpecializationInfo info{};
+  info.mapEntryCount = static_cast<uint32_t>(mapEntries.size());
+  info.pMapEntries = mapEntries.data();
+  info.dataSize = data.size();
+  info.pData = data.data();
+  return info;
+}
+
 LvePipeline::LvePipeline(LveDevice& device) : lveDevice{device} {}
 
 LvePipeline::~LvePipeline() {
+  // worker may still be writing the handles.
+  if (pendingBuild.valid()) {
+    pendingBuild.wait();
+  }
   vkDestroyShaderModule(lveDevice.device(), vertShaderModule, nullptr);
   vkDestroyShaderModule(lveDevice.device(), fragShaderModule, nullptr);
   vkDestroyShaderModule(lveDevice.device(), compShaderModule, nullptr);
@@ -53,10 +66,18 @@ void LvePipeline::createGraphicsPipeline(const std::string& vertFilepath,
          "configinfo.");
 
   auto vertCode = readFile(vertFilepath);
-  auto fragCode = readFile(fragFilepath);
-
   createShaderModule(vertCode, &vertShaderModule);
-  createShaderModule(fragCode, &fragShaderModule);
+
+  bool hasFragmentStage = !fragFilepath.empty();
+  if (hasFragmentStage) {
+    auto fragCode = readFile(fragFilepath);
+    createShaderModule(fragCode, &fragShaderModule);
+  }
+
+  VkSpecializationInfo specializationInfo =
+      configInfo.specialization.getInfo();
+  const VkSpecializationInfo* pSpecializationInfo =
+      configInfo.specialization.empty() ? nullptr : &specializationInfo;
 
   VkPipelineShaderStageCreateInfo shaderStages[2];
   shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -65,7 +86,7 @@ void LvePipeline::createGraphicsPipeline(const std::string& vertFilepath,
   shaderStages[0].pName = "main";
   shaderStages[0].flags = 0;
   shaderStages[0].pNext = nullptr;
-  shaderStages[0].pSpecializationInfo = nullptr;
+  shaderStages[0].pSpecializationInfo = pSpecializationInfo;
 
   shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
   shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
@@ -74,7 +95,7 @@ void LvePipeline::createGraphicsPipeline(const std::string& vertFilepath,
   shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
   shaderStages[1].flags = 0;
   shaderStages[1].pNext = nullptr;
-  shaderStages[1].pSpecializationInfo = nullptr;
+  shaderStages[1].pSpecializationInfo = pSpecializationInfo;
 
   auto& bindingDescriptions = configInfo.bindingDescriptions;
   auto& attributeDescriptions = configInfo.attributeDescriptions;
@@ -91,7 +112,7 @@ void LvePipeline::createGraphicsPipeline(const std::string& vertFilepath,
 
   VkGraphicsPipelineCreateInfo pipelineInfo{};
   pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-  pipelineInfo.stageCount = 2;
+  pipelineInfo.stageCount = hasFragmentStage ? 2 : 1;
   pipelineInfo.pStages = shaderStages;
   pipelineInfo.pVertexInputState = &vertexInputInfo;
   pipelineInfo.pInputAssemblyState = &configInfo.inputAssemblyInfo;
@@ -110,9 +131,9 @@ void LvePipeline::createGraphicsPipeline(const std::string& vertFilepath,
   pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
   pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-  if (vkCreateGraphicsPipelines(lveDevice.device(), VK_NULL_HANDLE, 1,
-                                &pipelineInfo, nullptr,
-                                &pipeline) != VK_SUCCESS) {
+  if (vkCreateGraphicsPipelines(lveDevice.device(),
+                                lveDevice.getPipelineCache(), 1, &pipelineInfo,
+                                nullptr, &pipeline) != VK_SUCCESS) {
     throw std::runtime_error("failed to create graphics pipeline.");
   }
 }
@@ -132,6 +153,11 @@ void LvePipeline::createComputePipeline(const std::string& compFilepath,
   computeShaderStageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
   computeShaderStageInfo.module = compShaderModule;
   computeShaderStageInfo.pName = "main";
+  VkSpecializationInfo specializationInfo =
+      configInfo.specialization.getInfo();
+  if (!configInfo.specialization.empty()) {
+    computeShaderStageInfo.pSpecializationInfo = &specializationInfo;
+  }
 
   VkComputePipelineCreateInfo pipelineInfo{};
   pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
@@ -141,9 +167,9 @@ void LvePipeline::createComputePipeline(const std::string& compFilepath,
 
   pipelineBindPoint = VK_PIPELINE_BIND_POINT_COMPUTE;
 
-  if (vkCreateComputePipelines(lveDevice.device(), VK_NULL_HANDLE, 1,
-                               &pipelineInfo, nullptr,
-                               &pipeline) != VK_SUCCESS) {
+  if (vkCreateComputePipelines(lveDevice.device(),
+                               lveDevice.getPipelineCache(), 1, &pipelineInfo,
+                               nullptr, &pipeline) != VK_SUCCESS) {
     throw std::runtime_error("failed to create compute pipeline!");
   }
 }
@@ -162,9 +188,18 @@ void LvePipeline::createShaderModule(const std::vector<char>& code,
 }
 
 void LvePipeline::bind(VkCommandBuffer commandBuffers) {
+  waitUntilReady();
   vkCmdBindPipeline(commandBuffers, pipelineBindPoint, pipeline);
 }
 
+void LvePipeline::waitUntilReady() {
+  if (ready.load(std::memory_order_acquire)) return;
+  // NOTE: may be called from several recording threads at once.
+  // get() rethrows a build failure.
+  pendingBuild.get();
+  ready.store(true, std::memory_order_release);
+}
+
 void LvePipeline::defaultPipelineConfigInfo(PipelineConfigInfo& configInfo) {
   configInfo.inputAssemblyInfo.sType =
       VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
@@ -3,11 +3,38 @@
 #include "lve_device.hpp"
 
 // std
+#include <atomic>
+#include <cstring>
+#include <future>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 namespace lve {
 
+// specialization constants, shared by every stage of a pipeline.
+// NOTE: constant ids a stage does not declare are ignored.
+struct PipelineSpecialization {
+  template <typename T>
+  PipelineSpecialization& add(uint32_t constantId, const T& value) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "specialization constant must be trivially copyable");
+    VkSpecializationMapEntry entry{};
+    entry.constantID = constantId;
+    entry.offset = static_cast<uint32_t>(data.size());
+    entry.size = sizeof(T);
+    mapEntries.push_back(entry);
+    data.resize(data.size() + sizeof(T));
+    std::memcpy(data.data() + entry.offset, &value, sizeof(T));
+    return *this;
+  }
+  bool empty() const { return mapEntries.empty(); }
+  VkSpecializationInfo getInfo() const;
+
+  std::vector<VkSpecializationMapEntry> mapEntries{};
+  std::vector<uint8_t> data{};
+};
+
 struct PipelineConfigInfo {
   PipelineConfigInfo() = default;
   PipelineConfigInfo(const PipelineConfigInfo&) = delete;
@@ -30,6 +57,7 @@ struct PipelineConfigInfo {
   VkPipelineLayout pipelineLayout = nullptr;
   VkRenderPass renderPass = nullptr;
   uint32_t subpass = 0;
+  PipelineSpecialization specialization{};
 };
 class LvePipeline {
  public:
@@ -41,8 +69,12 @@ class LvePipeline {
   LvePipeline(const LvePipeline&) = delete;
   LvePipeline& operator=(const LvePipeline&) = delete;
 
+  // NOTE: waits here if the pipeline is still being built asynchronously.
   void bind(VkCommandBuffer commandBuffers);
+  // blocks until an async build (LvePipelineCompiler) has finished.
+  void waitUntilReady();
 
+  // empty fragFilepath creates a vertex only pipeline (ex. depth pre-pass)
   void createGraphicsPipeline(const std::string& vertFilepath,
                               const std::string& fragFilepath,
                               const PipelineConfigInfo& configInfo);
@@ -53,15 +85,21 @@ class LvePipeline {
   static void enableAlphaBlending(PipelineConfigInfo& configInfo);
 
  private:
+  friend class LvePipelineCompiler;
+
   static std::vector<char> readFile(const std::string& filepath);
 
   void createShaderModule(const std::vector<char>& code,
                           VkShaderModule* shaderModule);
 
   LveDevice& lveDevice;
-  VkPipeline pipeline;
+  VkPipeline pipeline = VK_NULL_HANDLE;
   VkPipelineBindPoint pipelineBindPoint;
 
+  // async build state. checked on every bind, so keep a cheap flag.
+  std::shared_future<void> pendingBuild;
+  std::atomic<bool> ready{true};
+
   VkShaderModule vertShaderModule = VK_NULL_HANDLE;
   VkShaderModule fragShaderModule = VK_NULL_HANDLE;
 
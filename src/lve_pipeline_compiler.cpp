@@ -0,0 +1,138 @@
+#include "lve_pipeline_compiler.hpp"
+
+#include "lve_cpu_profiler.hpp"
+
+// std
+#include <iostream>
+
+namespace {
+void appendBytes(std::string& key, const void* data, size_t size) {
+  key.append(static_cast<const char*>(data), size);
+}
+template <typename T>
+void appendValue(std::string& key, const T& value) {
+  appendBytes(key, &value, sizeof(T));
+}
+template <typename T>
+void appendVector(std::string& key, const std::vector<T>& values) {
+  appendValue(key, values.size());
+  appendBytes(key, values.data(), values.size() * sizeof(T));
+}
+}  // namespace
+
+namespace lve {
+
+LvePipelineCompiler::LvePipelineCompiler(LveDevice& device,
+                                         LveThreadPool& threadPool)
+    : lveDevice{device}, threadPool{threadPool} {}
+
+LvePipelineCompiler::~LvePipelineCompiler() {
+  std::cout << "pipeline compiler: " << requestedCount
+            << " pipelines built async in " << getBuildMs()
+            << " ms worker time, " << variantHitCount << " variant cache hits"
+            << std::endl;
+}
+
+std::unique_ptr<LvePipeline> LvePipelineCompiler::createGraphicsPipeline(
+    const std::string& vertFilepath, const std::string& fragFilepath,
+    std::shared_ptr<PipelineConfigInfo> configInfo) {
+  auto pipeline = std::make_unique<LvePipeline>(lveDevice);
+  LvePipeline* target = pipeline.get();
+  // NOTE: pipeline cache is internally synchronized, so builds can run in
+  // parallel without locking.
+  target->ready.store(false, std::memory_order_release);
+  target->pendingBuild =
+      threadPool
+          .submit([this, target, vertFilepath, fragFilepath, configInfo]() {
+            LVE_PROFILE_SCOPE("pipeline_build");
+            auto startTime = std::chrono::steady_clock::now();
+            target->createGraphicsPipeline(vertFilepath, fragFilepath,
+                                           *configInfo);
+            addBuildTime(startTime);
+          })
+          .share();
+  requestedCount++;
+  return pipeline;
+}
+
+std::unique_ptr<LvePipeline> LvePipelineCompiler::createComputePipeline(
+    const std::string& compFilepath,
+    std::shared_ptr<PipelineConfigInfo> configInfo) {
+  auto pipeline = std::make_unique<LvePipeline>(lveDevice);
+  LvePipeline* target = pipeline.get();
+  target->ready.store(false, std::memory_order_release);
+  target->pendingBuild =
+      threadPool
+          .submit([this, target, compFilepath, configInfo]() {
+            LVE_PROFILE_SCOPE("pipeline_build");
+            auto startTime = std::chrono::steady_clock::now();
+            target->createComputePipeline(compFilepath, *configInfo);
+            addBuildTime(startTime);
+          })
+          .share();
+  requestedCount++;
+  return pipeline;
+}
+
+std::shared_ptr<LvePipeline> LvePipelineCompiler::getGraphicsVariant(
+    const std::string& vertFilepath, const std::string& fragFilepath,
+    std::shared_ptr<PipelineConfigInfo> configInfo) {
+  std::string key = variantKey(vertFilepath + "|" + fragFilepath, *configInfo);
+  if (auto pipeline = variants[key].lock()) {
+    variantHitCount++;
+    return pipeline;
+  }
+  std::shared_ptr<LvePipeline> pipeline =
+      createGraphicsPipeline(vertFilepath, fragFilepath, configInfo);
+  variants[key] = pipeline;
+  return pipeline;
+}
+
+std::shared_ptr<LvePipeline> LvePipelineCompiler::getComputeVariant(
+    const std::string& compFilepath,
+    std::shared_ptr<PipelineConfigInfo> configInfo) {
+  std::string key = variantKey(compFilepath, *configInfo);
+  if (auto pipeline = variants[key].lock()) {
+    variantHitCount++;
+    return pipeline;
+  }
+  std::shared_ptr<LvePipeline> pipeline =
+      createComputePipeline(compFilepath, configInfo);
+  variants[key] = pipeline;
+  return pipeline;
+}
+
+void LvePipelineCompiler::addBuildTime(
+    std::chrono::steady_clock::time_point startTime) {
+  buildMicroseconds += static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - startTime)
+          .count());
+}
+
+std::string LvePipelineCompiler::variantKey(
+    const std::string& shaderFilepaths, const PipelineConfigInfo& configInfo) {
+  // NOTE: only plain values go in. create infos carry pointers into the
+  // config itself, which differ between otherwise equal configs.
+  std::string key = shaderFilepaths;
+  appendVector(key, configInfo.specialization.mapEntries);
+  appendVector(key, configInfo.specialization.data);
+  appendValue(key, configInfo.pipelineLayout);
+  appendValue(key, configInfo.renderPass);
+  appendValue(key, configInfo.subpass);
+  appendVector(key, configInfo.bindingDescriptions);
+  appendVector(key, configInfo.attributeDescriptions);
+  appendValue(key, configInfo.inputAssemblyInfo.topology);
+  appendValue(key, configInfo.rasterizationInfo.polygonMode);
+  appendValue(key, configInfo.rasterizationInfo.cullMode);
+  appendValue(key, configInfo.rasterizationInfo.frontFace);
+  appendValue(key, configInfo.multisampleInfo.rasterizationSamples);
+  appendValue(key, configInfo.multisampleInfo.sampleShadingEnable);
+  appendValue(key, configInfo.colorBlendAttachment);
+  appendValue(key, configInfo.depthStencilInfo.depthTestEnable);
+  appendValue(key, configInfo.depthStencilInfo.depthWriteEnable);
+  appendValue(key, configInfo.depthStencilInfo.depthCompareOp);
+  return key;
+}
+
+}  // namespace lve
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "lve_device.hpp"
+#include "lve_pipeline.hpp"
+#include "lve_thread_pool.hpp"
+
+// std
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace lve {
+
+// Builds pipelines on the thread pool. returned pipelines are usable right
+// away; the first bind() waits only if the build has not finished yet.
+// NOTE: config is shared with the worker, since PipelineConfigInfo is not
+// copyable (it points into itself) and must outlive the build.
+// build times are summed up and reported once on destruction, workers never
+// print. builds report to the compiler, so it must outlive its pipelines.
+class LvePipelineCompiler {
+ public:
+  LvePipelineCompiler(LveDevice &device, LveThreadPool &threadPool);
+  ~LvePipelineCompiler();
+
+  LvePipelineCompiler(const LvePipelineCompiler &) = delete;
+  LvePipelineCompiler &operator=(const LvePipelineCompiler &) = delete;
+
+  std::unique_ptr<LvePipeline> createGraphicsPipeline(
+      const std::string &vertFilepath, const std::string &fragFilepath,
+      std::shared_ptr<PipelineConfigInfo> configInfo);
+  std::unique_ptr<LvePipeline> createComputePipeline(
+      const std::string &compFilepath,
+      std::shared_ptr<PipelineConfigInfo> configInfo);
+
+  // shader variants: requests with the same shaders, specialization constants
+  // and fixed function state share one pipeline while any owner keeps it.
+  std::shared_ptr<LvePipeline> getGraphicsVariant(
+      const std::string &vertFilepath, const std::string &fragFilepath,
+      std::shared_ptr<PipelineConfigInfo> configInfo);
+  std::shared_ptr<LvePipeline> getComputeVariant(
+      const std::string &compFilepath,
+      std::shared_ptr<PipelineConfigInfo> configInfo);
+
+  uint32_t getRequestedCount() const { return requestedCount; }
+  uint32_t getVariantHitCount() const { return variantHitCount; }
+  // worker time of the finished builds, cache hits are much shorter.
+  float getBuildMs() const { return buildMicroseconds.load() * 1e-3f; }
+
+ private:
+  static std::string variantKey(const std::string &shaderFilepaths,
+                                const PipelineConfigInfo &configInfo);
+  // worker side, after a build.
+  void addBuildTime(std::chrono::steady_clock::time_point startTime);
+
+  LveDevice &lveDevice;
+  LveThreadPool &threadPool;
+  uint32_t requestedCount = 0;
+  uint32_t variantHitCount = 0;
+  std::atomic<uint64_t> buildMicroseconds{0};
+  // NOTE: weak, owners release variants before destroying their layout.
+  std::unordered_map<std::string, std::weak_ptr<LvePipeline>> variants;
+};
+}  // namespace lve
@@ -0,0 +1,325 @@
+#include "lve_render_graph.hpp"
+
+#include "lve_gpu_profiler.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <stdexcept>
+
+namespace lve {
+
+LveRenderGraph::PassBuilder& LveRenderGraph::PassBuilder::read(
+    ResourceId resource, VkPipelineStageFlags stageMask,
+    VkAccessFlags accessMask) {
+  assert(resource < graph.resources.size() && "Unknown render graph resource");
+  graph.passes[passIndex].accesses.push_back(
+      {resource, stageMask, accessMask, false});
+  return *this;
+}
+
+LveRenderGraph::PassBuilder& LveRenderGraph::PassBuilder::write(
+    ResourceId resource, VkPipelineStageFlags stageMask,
+    VkAccessFlags accessMask) {
+  assert(resource < graph.resources.size() && "Unknown render graph resource");
+  graph.passes[passIndex].accesses.push_back(
+      {resource, stageMask, accessMask, true});
+  return *this;
+}
+
+LveRenderGraph::LveRenderGraph(LveDevice& device,
+                               const LveFrameContext& frameContext)
+    : lveDevice{device}, frameCount{frameContext.getFramesInFlight()} {}
+
+LveRenderGraph::~LveRenderGraph() { destroyTransients(); }
+
+LveRenderGraph::ResourceId LveRenderGraph::importResource(
+    const std::string& name) {
+  assert(!isCompiled && "Cannot add resources after compile");
+  Resource resource{};
+  resource.name = name;
+  resources.push_back(std::move(resource));
+  return static_cast<ResourceId>(resources.size() - 1);
+}
+
+LveRenderGraph::ResourceId LveRenderGraph::createTransientBuffer(
+    const std::string& name, VkDeviceSize size, VkBufferUsageFlags usage) {
+  assert(!isCompiled && "Cannot add resources after compile");
+  Resource resource{};
+  resource.name = name;
+  resource.isTransient = true;
+  resource.size = size;
+  resource.usage = usage;
+  resources.push_back(std::move(resource));
+  return static_cast<ResourceId>(resources.size() - 1);
+}
+
+void LveRenderGraph::addPass(const std::string& name,
+                             const std::function<void(PassBuilder&)>& setup,
+                             RecordFunction record) {
+  assert(!isCompiled && "Cannot add passes after compile");
+  Pass pass{};
+  pass.name = name;
+  pass.record = std::move(record);
+  passes.push_back(std::move(pass));
+
+  PassBuilder builder{*this, static_cast<uint32_t>(passes.size() - 1)};
+  setup(builder);
+}
+
+void LveRenderGraph::compile() {
+  assert(!isCompiled && "Render graph is already compiled");
+  cullPasses();
+  computeLifetimes();
+  allocateTransients();
+  computeBarriers();
+  isCompiled = true;
+
+  std::cout << "render graph: " << passes.size() << " passes ("
+            << getCulledPassCount() << " culled), transient memory "
+            << getTransientMemorySize() / 1024 << " KB ("
+            << getUnaliasedTransientMemorySize() / 1024
+            << " KB without aliasing)" << std::endl;
+}
+
+void LveRenderGraph::execute(FrameInfo& frameInfo) {
+  assert(isCompiled && "Cannot execute render graph before compile");
+  for (auto& pass : passes) {
+    if (pass.isCulled) continue;
+
+    auto& barrier = pass.barrier;
+    if (barrier.srcStageMask != 0) {
+      VkMemoryBarrier memoryBarrier{};
+      memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+      memoryBarrier.srcAccessMask = barrier.srcAccessMask;
+      memoryBarrier.dstAccessMask = barrier.dstAccessMask;
+      // NOTE: execution only dependency (write after read) has no access.
+      bool hasMemoryDependency = barrier.srcAccessMask != 0;
+      vkCmdPipelineBarrier(frameInfo.commandBuffer, barrier.srcStageMask,
+                           barrier.dstStageMask, 0,
+                           hasMemoryDependency ? 1 : 0, &memoryBarrier, 0,
+                           nullptr, 0, nullptr);
+    }
+    // NOTE: outside of the pass, passes may begin their own render pass.
+    LveGpuProfiler::Scope profileScope{frameInfo, pass.name.c_str()};
+    pass.record(frameInfo);
+  }
+}
+
+VkDescriptorBufferInfo LveRenderGraph::bufferInfo(ResourceId resource,
+                                                  int frameIndex) const {
+  assert(isCompiled && "Transient buffers are created in compile");
+  auto& res = resources[resource];
+  assert(res.isTransient && !res.buffers.empty() &&
+         "Resource is not a live transient buffer");
+  return VkDescriptorBufferInfo{res.buffers[frameIndex], 0, res.size};
+}
+
+uint32_t LveRenderGraph::getCulledPassCount() const {
+  return static_cast<uint32_t>(
+      std::count_if(passes.begin(), passes.end(),
+                    [](const Pass& pass) { return pass.isCulled; }));
+}
+
+VkDeviceSize LveRenderGraph::getTransientMemorySize() const {
+  VkDeviceSize size = 0;
+  for (auto& block : memoryBlocks) size += block.size;
+  return size;
+}
+
+VkDeviceSize LveRenderGraph::getUnaliasedTransientMemorySize() const {
+  VkDeviceSize size = 0;
+  for (auto& res : resources) {
+    if (!res.buffers.empty()) size += res.memoryRequirements.size;
+  }
+  return size;
+}
+
+void LveRenderGraph::cullPasses() {
+  // walk backwards: a pass lives if it writes an imported resource or a
+  // transient that a live pass reads later.
+  std::vector<bool> isNeeded(resources.size(), false);
+  for (auto it = passes.rbegin(); it != passes.rend(); ++it) {
+    bool isLive = false;
+    for (auto& access : it->accesses) {
+      if (!access.isWrite) continue;
+      auto& res = resources[access.resource];
+      if (!res.isTransient || isNeeded[access.resource]) {
+        isLive = true;
+      }
+    }
+    it->isCulled = !isLive;
+    if (!isLive) continue;
+
+    for (auto& access : it->accesses) {
+      if (!access.isWrite) isNeeded[access.resource] = true;
+    }
+  }
+}
+
+void LveRenderGraph::computeLifetimes() {
+  for (int i = 0; i < static_cast<int>(passes.size()); i++) {
+    if (passes[i].isCulled) continue;
+    for (auto& access : passes[i].accesses) {
+      auto& res = resources[access.resource];
+      if (res.firstPass < 0) res.firstPass = i;
+      res.lastPass = i;
+    }
+  }
+}
+
+void LveRenderGraph::allocateTransients() {
+  std::vector<ResourceId> transients;
+  for (ResourceId id = 0; id < resources.size(); id++) {
+    auto& res = resources[id];
+    if (!res.isTransient || res.firstPass < 0) continue;
+
+    res.buffers.resize(frameCount);
+    for (auto& buffer : res.buffers) {
+      VkBufferCreateInfo bufferInfo{};
+      bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+      bufferInfo.size = res.size;
+      bufferInfo.usage = res.usage;
+      bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+      if (vkCreateBuffer(lveDevice.device(), &bufferInfo, nullptr, &buffer) !=
+          VK_SUCCESS) {
+        throw std::runtime_error("failed to create transient buffer!");
+      }
+    }
+    vkGetBufferMemoryRequirements(lveDevice.device(), res.buffers[0],
+                                  &res.memoryRequirements);
+    transients.push_back(id);
+  }
+
+  // largest first, then first fit into a block with no overlapping lifetime.
+  std::sort(transients.begin(), transients.end(),
+            [this](ResourceId a, ResourceId b) {
+              return resources[a].memoryRequirements.size >
+                     resources[b].memoryRequirements.size;
+            });
+  for (ResourceId id : transients) {
+    auto& res = resources[id];
+    uint32_t blockIndex = 0;
+    for (; blockIndex < memoryBlocks.size(); blockIndex++) {
+      auto& block = memoryBlocks[blockIndex];
+      if ((block.memoryTypeBits & res.memoryRequirements.memoryTypeBits) == 0) {
+        continue;
+      }
+      bool isOverlapping = std::any_of(
+          block.resources.begin(), block.resources.end(),
+          [this, &res](ResourceId other) {
+            return resources[other].firstPass <= res.lastPass &&
+                   res.firstPass <= resources[other].lastPass;
+          });
+      if (!isOverlapping) break;
+    }
+    if (blockIndex == memoryBlocks.size()) {
+      memoryBlocks.emplace_back();
+    }
+    auto& block = memoryBlocks[blockIndex];
+    block.size = std::max(block.size, res.memoryRequirements.size);
+    block.memoryTypeBits &= res.memoryRequirements.memoryTypeBits;
+    block.resources.push_back(id);
+    res.memoryBlock = blockIndex;
+  }
+
+  // NOTE: every member binds at offset 0, the block is sized for the largest.
+  for (auto& block : memoryBlocks) {
+    block.memory.resize(frameCount);
+    for (uint32_t frame = 0; frame < frameCount; frame++) {
+      VkMemoryAllocateInfo allocInfo{};
+      allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+      allocInfo.allocationSize = block.size;
+      allocInfo.memoryTypeIndex = lveDevice.findMemoryType(
+          block.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+      if (vkAllocateMemory(lveDevice.device(), &allocInfo, nullptr,
+                           &block.memory[frame]) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate transient memory!");
+      }
+      for (ResourceId id : block.resources) {
+        vkBindBufferMemory(lveDevice.device(), resources[id].buffers[frame],
+                           block.memory[frame], 0);
+      }
+    }
+  }
+}
+
+void LveRenderGraph::computeBarriers() {
+  struct HazardState {
+    VkPipelineStageFlags writeStageMask = 0;
+    VkAccessFlags writeAccessMask = 0;
+    // reads since the last write
+    VkPipelineStageFlags readStageMask = 0;
+    // stages the last write is already visible to
+    VkPipelineStageFlags visibleStageMask = 0;
+  };
+  std::vector<HazardState> states(resources.size() + memoryBlocks.size());
+
+  for (auto& pass : passes) {
+    if (pass.isCulled) continue;
+    auto& barrier = pass.barrier;
+
+    // hazards against previous passes only, not within the pass itself.
+    for (auto& access : pass.accesses) {
+      auto& state = states[hazardSlot(access.resource)];
+      if (access.isWrite) {
+        if (state.readStageMask != 0) {
+          // write after read
+          barrier.srcStageMask |= state.readStageMask;
+          barrier.dstStageMask |= access.stageMask;
+        } else if (state.writeStageMask != 0) {
+          // write after write
+          barrier.srcStageMask |= state.writeStageMask;
+          barrier.srcAccessMask |= state.writeAccessMask;
+          barrier.dstStageMask |= access.stageMask;
+          barrier.dstAccessMask |= access.accessMask;
+        }
+      } else if (state.writeStageMask != 0 &&
+                 (access.stageMask & ~state.visibleStageMask) != 0) {
+        // read after write
+        barrier.srcStageMask |= state.writeStageMask;
+        barrier.srcAccessMask |= state.writeAccessMask;
+        barrier.dstStageMask |= access.stageMask;
+        barrier.dstAccessMask |= access.accessMask;
+      }
+    }
+
+    for (auto& access : pass.accesses) {
+      auto& state = states[hazardSlot(access.resource)];
+      if (access.isWrite) {
+        state = HazardState{};
+        state.writeStageMask = access.stageMask;
+        state.writeAccessMask = access.accessMask;
+      } else {
+        state.readStageMask |= access.stageMask;
+        state.visibleStageMask |= access.stageMask;
+      }
+    }
+  }
+}
+
+void LveRenderGraph::destroyTransients() {
+  for (auto& res : resources) {
+    for (auto buffer : res.buffers) {
+      vkDestroyBuffer(lveDevice.device(), buffer, nullptr);
+    }
+    res.buffers.clear();
+  }
+  for (auto& block : memoryBlocks) {
+    for (auto memory : block.memory) {
+      vkFreeMemory(lveDevice.device(), memory, nullptr);
+    }
+  }
+  memoryBlocks.clear();
+}
+
+uint32_t LveRenderGraph::hazardSlot(ResourceId resource) const {
+  auto& res = resources[resource];
+  if (res.isTransient) {
+    return static_cast<uint32_t>(resources.size()) + res.memoryBlock;
+  }
+  return resource;
+}
+
+}  // namespace lve
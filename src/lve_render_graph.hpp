@@ -0,0 +1,129 @@
+#pragma once
+
+#include "lve_device.hpp"
+#include "lve_frame_context.hpp"
+#include "lve_frame_info.hpp"
+
+// std
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace lve {
+
+// Frame graph of the commands recorded into one frame's command buffer.
+// passes declare the resources they read and write. compile() culls passes
+// whose results are never used, derives the barriers between passes and lets
+// transient buffers with disjoint lifetimes share memory.
+// NOTE: built once, executed every frame. imported resources are synchronized
+// outside the graph (host writes, other queue submissions).
+class LveRenderGraph {
+ public:
+  using ResourceId = uint32_t;
+  using RecordFunction = std::function<void(FrameInfo &)>;
+
+  class PassBuilder {
+   public:
+    PassBuilder &read(ResourceId resource, VkPipelineStageFlags stageMask,
+                      VkAccessFlags accessMask);
+    PassBuilder &write(ResourceId resource, VkPipelineStageFlags stageMask,
+                       VkAccessFlags accessMask);
+
+   private:
+    friend class LveRenderGraph;
+    PassBuilder(LveRenderGraph &graph, uint32_t passIndex)
+        : graph{graph}, passIndex{passIndex} {}
+
+    LveRenderGraph &graph;
+    uint32_t passIndex;
+  };
+
+  // one transient set per frame in flight.
+  LveRenderGraph(LveDevice &device, const LveFrameContext &frameContext);
+  ~LveRenderGraph();
+
+  LveRenderGraph(const LveRenderGraph &) = delete;
+  LveRenderGraph &operator=(const LveRenderGraph &) = delete;
+
+  // resources owned elsewhere. passes writing them are never culled.
+  ResourceId importResource(const std::string &name);
+  // device local buffer owned by the graph, valid after compile().
+  ResourceId createTransientBuffer(const std::string &name, VkDeviceSize size,
+                                   VkBufferUsageFlags usage);
+  // setup declares the pass resources and is called right away.
+  // passes execute in the order they were added.
+  void addPass(const std::string &name,
+               const std::function<void(PassBuilder &)> &setup,
+               RecordFunction record);
+
+  void compile();
+  // records every live pass into frameInfo.commandBuffer.
+  void execute(FrameInfo &frameInfo);
+
+  VkDescriptorBufferInfo bufferInfo(ResourceId resource, int frameIndex) const;
+  uint32_t getCulledPassCount() const;
+  // per frame, with and without aliasing.
+  VkDeviceSize getTransientMemorySize() const;
+  VkDeviceSize getUnaliasedTransientMemorySize() const;
+
+ private:
+  struct Access {
+    ResourceId resource;
+    VkPipelineStageFlags stageMask;
+    VkAccessFlags accessMask;
+    bool isWrite;
+  };
+  struct Resource {
+    std::string name;
+    bool isTransient = false;
+    VkDeviceSize size = 0;
+    VkBufferUsageFlags usage = 0;
+    // first/last live pass using it, -1 if unused.
+    int firstPass = -1;
+    int lastPass = -1;
+    uint32_t memoryBlock = 0;
+    VkMemoryRequirements memoryRequirements{};
+    // per frame in flight
+    std::vector<VkBuffer> buffers;
+  };
+  struct Barrier {
+    VkPipelineStageFlags srcStageMask = 0;
+    VkPipelineStageFlags dstStageMask = 0;
+    VkAccessFlags srcAccessMask = 0;
+    VkAccessFlags dstAccessMask = 0;
+  };
+  struct Pass {
+    std::string name;
+    std::vector<Access> accesses;
+    RecordFunction record;
+    bool isCulled = false;
+    // issued before the pass records its commands
+    Barrier barrier;
+  };
+  // aliased memory shared by transients whose lifetimes do not overlap.
+  struct MemoryBlock {
+    VkDeviceSize size = 0;
+    uint32_t memoryTypeBits = ~0u;
+    std::vector<ResourceId> resources;
+    // per frame in flight
+    std::vector<VkDeviceMemory> memory;
+  };
+
+  void cullPasses();
+  void computeLifetimes();
+  void allocateTransients();
+  void computeBarriers();
+  void destroyTransients();
+  // transients are tracked per memory block, so reusing aliased memory is
+  // ordered after the previous owner.
+  uint32_t hazardSlot(ResourceId resource) const;
+
+  LveDevice &lveDevice;
+  uint32_t frameCount;
+  std::vector<Resource> resources;
+  std::vector<Pass> passes;
+  std::vector<MemoryBlock> memoryBlocks;
+  bool isCompiled = false;
+};
+
+}  // namespace lve
@@ -1,6 +1,9 @@
 #include "lve_renderer.hpp"
 
+#include "lve_cpu_profiler.hpp"
+
 // std
+#include <algorithm>
 #include <array>
 #include <iostream>
 #include <memory>
@@ -8,31 +11,43 @@
 
 namespace lve {
 
-LveRenderer::LveRenderer(LveWindow& window, LveDevice& device)
-    : lveWindow{window}, lveDevice{device} {
+LveRenderer::LveRenderer(LveWindow& window, LveDevice& device,
+                         const LveFrameContext& frameContext,
+                         uint32_t recordThreadCount,
+                         const PresentSettings& presentSettings)
+    : lveWindow{window},
+      lveDevice{device},
+      frameContext{frameContext},
+      recordThreadCount{std::max(recordThreadCount, 1u)},
+      presentSettings{presentSettings} {
   recreateSwapChain();
+  createThreadCommandPools();
   createCommandBuffers();
   createComputeCommandBuffers();
 }
 LveRenderer::~LveRenderer() {
   freeCommandBuffers();
   freeComputeCommandBuffers();
+  destroyThreadCommandPools();
 }
 
 void LveRenderer::recreateSwapChain() {
   auto extent = lveWindow.getExtent();
-  // ex minimize
+  // ex minimize. (headless extent is fixed and never zero)
   while (extent.width == 0 || extent.height == 0) {
     extent = lveWindow.getExtent();
     glfwWaitEvents();
   }
   vkDeviceWaitIdle(lveDevice.device());
   if (lveSwapChain == nullptr) {
-    lveSwapChain = std::make_unique<LveSwapChain>(lveDevice, extent);
+    lveSwapChain = std::make_unique<LveSwapChain>(lveDevice, frameContext,
+                                                  extent, presentSettings);
   } else {
+    // present ids of the old swap chain can't be waited anymore.
+    latencyTracker.dropPending();
     std::shared_ptr<LveSwapChain> oldSwapChain = std::move(lveSwapChain);
-    lveSwapChain =
-        std::make_unique<LveSwapChain>(lveDevice, extent, oldSwapChain);
+    lveSwapChain = std::make_unique<LveSwapChain>(
+        lveDevice, frameContext, extent, oldSwapChain, presentSettings);
     if (!oldSwapChain->compareSwapFormats(*lveSwapChain.get())) {
       throw std::runtime_error(
           "Swap Chain image(or depth) format has changed!");
@@ -44,27 +59,71 @@ void LveRenderer::recreateSwapChain() {
   // createPipeline();
 }
 void LveRenderer::createCommandBuffers() {
-  commandBuffers.resize(LveSwapChain::MAX_FRAMES_IN_FLIGHT);
+  commandBuffers.resize(frameContext.getFramesInFlight());
 
-  VkCommandBufferAllocateInfo allocInfo{};
-  allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-  allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-  allocInfo.commandPool = lveDevice.getCommandPool();
-  allocInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
+  for (int i = 0; i < commandBuffers.size(); i++) {
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandPool = threadCommandPools[i][0].commandPool;
+    allocInfo.commandBufferCount = 1;
 
-  if (vkAllocateCommandBuffers(lveDevice.device(), &allocInfo,
-                               commandBuffers.data()) != VK_SUCCESS) {
-    throw std::runtime_error("failed to allocate command buffers!");
+    if (vkAllocateCommandBuffers(lveDevice.device(), &allocInfo,
+                                 &commandBuffers[i]) != VK_SUCCESS) {
+      throw std::runtime_error("failed to allocate command buffers!");
+    }
   }
 }
 
 void LveRenderer::freeCommandBuffers() {
-  vkFreeCommandBuffers(lveDevice.device(), lveDevice.getCommandPool(),
-                       static_cast<uint32_t>(commandBuffers.size()),
-                       commandBuffers.data());
+  for (int i = 0; i < commandBuffers.size(); i++) {
+    vkFreeCommandBuffers(lveDevice.device(),
+                         threadCommandPools[i][0].commandPool, 1,
+                         &commandBuffers[i]);
+  }
   commandBuffers.clear();
 }
 
+void LveRenderer::createThreadCommandPools() {
+  QueueFamilyIndices queueFamilyIndices = lveDevice.findPhysicalQueueFamilies();
+
+  threadCommandPools.resize(frameContext.getFramesInFlight());
+  for (auto& framePools : threadCommandPools) {
+    framePools.resize(recordThreadCount);
+    for (auto& threadPool : framePools) {
+      // NOTE: no RESET_COMMAND_BUFFER bit. whole pool is reset per frame,
+      // which is cheaper than resetting each buffer.
+      VkCommandPoolCreateInfo poolInfo{};
+      poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+      poolInfo.queueFamilyIndex =
+          queueFamilyIndices.graphicsAndComputeFamily.value();
+      poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+      if (vkCreateCommandPool(lveDevice.device(), &poolInfo, nullptr,
+                              &threadPool.commandPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create thread command pool!");
+      }
+    }
+  }
+}
+
+void LveRenderer::destroyThreadCommandPools() {
+  // command buffers are freed together with their pool.
+  for (auto& framePools : threadCommandPools) {
+    for (auto& threadPool : framePools) {
+      vkDestroyCommandPool(lveDevice.device(), threadPool.commandPool, nullptr);
+    }
+  }
+  threadCommandPools.clear();
+}
+
+void LveRenderer::resetThreadCommandPools(int frameIndex) {
+  for (auto& threadPool : threadCommandPools[frameIndex]) {
+    vkResetCommandPool(lveDevice.device(), threadPool.commandPool, 0);
+    threadPool.usedCount = 0;
+  }
+}
+
 // void LveRenderer::renderGameObjects(VkCommandBuffer commandBuffer) {
 //   // update
 //   int i = 0;
@@ -91,6 +150,7 @@ void LveRenderer::freeCommandBuffers() {
 // }
 
 VkCommandBuffer LveRenderer::beginFrame() {
+  LVE_PROFILE_SCOPE("beginFrame");
   assert(!isFrameStarted && "Can't call beginFrame while already in progress.");
 
   auto result = lveSwapChain->acquireNextImage(&currentImageIndex);
@@ -105,6 +165,23 @@ VkCommandBuffer LveRenderer::beginFrame() {
 
   isFrameStarted = true;
 
+  // fixed for the whole frame, the scale may change in between.
+  VkExtent2D swapChainExtent = lveSwapChain->getSwapChainExtent();
+  renderExtent.width = std::max(
+      1u, static_cast<uint32_t>(swapChainExtent.width * renderScale + .5f));
+  renderExtent.height = std::max(
+      1u, static_cast<uint32_t>(swapChainExtent.height * renderScale + .5f));
+  renderExtent.width = std::min(renderExtent.width, swapChainExtent.width);
+  renderExtent.height = std::min(renderExtent.height, swapChainExtent.height);
+  if (!lveSwapChain->supportsUpscale()) renderExtent = swapChainExtent;
+
+  latencyTracker.pollPresented([this](uint64_t presentId) {
+    return lveSwapChain->waitForPresent(presentId, 0);
+  });
+
+  // previous use of this frame slot is already waited in acquireNextImage.
+  resetThreadCommandPools(currentFrameIndex);
+
   auto commandBuffer = getCurrentCommandBuffer();
   VkCommandBufferBeginInfo beginInfo{};
   beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -114,6 +191,7 @@ VkCommandBuffer LveRenderer::beginFrame() {
   return commandBuffer;
 }
 void LveRenderer::endFrame() {
+  LVE_PROFILE_SCOPE("endFrame");
   assert(isFrameStarted &&
          "Can't call endFrame while frame is not in progress.");
   auto commandBuffer = getCurrentCommandBuffer();
@@ -122,8 +200,14 @@ void LveRenderer::endFrame() {
     throw std::runtime_error("failed to record command buffer!");
   }
 
-  auto result =
-      lveSwapChain->submitCommandBuffers(&commandBuffer, &currentImageIndex);
+  uint64_t presentId = 0;
+  if (lveDevice.isPresentWaitEnabled()) {
+    presentId = latencyTracker.nextPresentId();
+  }
+  latencyTracker.markSubmit();
+  auto result = lveSwapChain->submitCommandBuffers(
+      &commandBuffer, &currentImageIndex, presentId);
+  latencyTracker.markPresent(presentId);
   // suboptimal : no longer matches the surface properties exactly, but can
   // still be used.
   if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR ||
@@ -134,10 +218,10 @@ void LveRenderer::endFrame() {
     throw std::runtime_error("failed to present swap chain image!");
   }
   isFrameStarted = false;
-  currentFrameIndex =
-      (currentFrameIndex + 1) % LveSwapChain::MAX_FRAMES_IN_FLIGHT;
+  currentFrameIndex = frameContext.nextFrameIndex(currentFrameIndex);
 }
-void LveRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer) {
+void LveRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer,
+                                           VkSubpassContents contents) {
   assert(isFrameStarted &&
          "Can't call beginSwapChainRenderPass if frame is not in progress.");
   assert(commandBuffer == getCurrentCommandBuffer() &&
@@ -146,10 +230,10 @@ void LveRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer) {
   VkRenderPassBeginInfo renderPassInfo{};
   renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
   renderPassInfo.renderPass = lveSwapChain->getRenderPass();
-  renderPassInfo.framebuffer = lveSwapChain->getFrameBuffer(currentImageIndex);
+  renderPassInfo.framebuffer = lveSwapChain->getFrameBuffer(currentFrameIndex);
 
   renderPassInfo.renderArea.offset = {0, 0};
-  renderPassInfo.renderArea.extent = lveSwapChain->getSwapChainExtent();
+  renderPassInfo.renderArea.extent = renderExtent;
 
   std::array<VkClearValue, 2> clearValues{};
   clearValues[0].color = {0.01f, 0.01f, 0.01f, 1.0f};
@@ -157,17 +241,20 @@ void LveRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer) {
   renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
   renderPassInfo.pClearValues = clearValues.data();
 
-  vkCmdBeginRenderPass(commandBuffer, &renderPassInfo,
-                       VK_SUBPASS_CONTENTS_INLINE);
+  vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, contents);
+  // NOTE: only vkCmdExecuteCommands is allowed in this subpass.
+  // secondary buffers set their own dynamic state.
+  if (contents == VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS) {
+    return;
+  }
   VkViewport viewport{};
   viewport.x = 0.0f;
   viewport.y = 0.0f;
-  viewport.width = static_cast<float>(lveSwapChain->getSwapChainExtent().width);
-  viewport.height =
-      static_cast<float>(lveSwapChain->getSwapChainExtent().height);
+  viewport.width = static_cast<float>(renderExtent.width);
+  viewport.height = static_cast<float>(renderExtent.height);
   viewport.minDepth = 0.0f;
   viewport.maxDepth = 1.0f;
-  VkRect2D scissor{{0, 0}, lveSwapChain->getSwapChainExtent()};
+  VkRect2D scissor{{0, 0}, renderExtent};
   vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
   vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 }
@@ -178,15 +265,85 @@ void LveRenderer::endSwapChainRenderPass(VkCommandBuffer commandBuffer) {
          "Can't end render pass on command buffer from a different frame.");
 
   vkCmdEndRenderPass(commandBuffer);
+  lveSwapChain->recordUpscale(commandBuffer, currentFrameIndex,
+                              currentImageIndex, renderExtent);
+}
+
+void LveRenderer::setRenderScale(float scale) {
+  assert(scale > 0.f && scale <= 1.f && "Render scale out of range.");
+  renderScale = scale;
+}
+
+VkCommandBuffer LveRenderer::beginSecondaryCommandBuffer(
+    uint32_t threadIndex) {
+  assert(isFrameStarted &&
+         "Can't begin secondary command buffer if frame is not in progress.");
+  assert(threadIndex < recordThreadCount && "Thread index out of range.");
+
+  auto& threadPool = threadCommandPools[currentFrameIndex][threadIndex];
+  // buffers are kept across frames and only allocated when a thread records
+  // more chunks than ever before.
+  if (threadPool.usedCount == threadPool.secondaryCommandBuffers.size()) {
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+    allocInfo.commandPool = threadPool.commandPool;
+    allocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer newCommandBuffer;
+    if (vkAllocateCommandBuffers(lveDevice.device(), &allocInfo,
+                                 &newCommandBuffer) != VK_SUCCESS) {
+      throw std::runtime_error("failed to allocate secondary command buffer!");
+    }
+    threadPool.secondaryCommandBuffers.push_back(newCommandBuffer);
+  }
+  auto commandBuffer =
+      threadPool.secondaryCommandBuffers[threadPool.usedCount++];
+
+  VkCommandBufferInheritanceInfo inheritanceInfo{};
+  inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+  inheritanceInfo.renderPass = lveSwapChain->getRenderPass();
+  inheritanceInfo.subpass = 0;
+  inheritanceInfo.framebuffer = lveSwapChain->getFrameBuffer(currentFrameIndex);
+
+  VkCommandBufferBeginInfo beginInfo{};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT |
+                    VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+  beginInfo.pInheritanceInfo = &inheritanceInfo;
+  if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+    throw std::runtime_error(
+        "failed to begin recording secondary command buffer!");
+  }
+
+  // dynamic state is not inherited from the primary buffer.
+  VkViewport viewport{};
+  viewport.x = 0.0f;
+  viewport.y = 0.0f;
+  viewport.width = static_cast<float>(renderExtent.width);
+  viewport.height = static_cast<float>(renderExtent.height);
+  viewport.minDepth = 0.0f;
+  viewport.maxDepth = 1.0f;
+  VkRect2D scissor{{0, 0}, renderExtent};
+  vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+  vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+  return commandBuffer;
+}
+
+void LveRenderer::endSecondaryCommandBuffer(VkCommandBuffer commandBuffer) {
+  if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+    throw std::runtime_error("failed to record secondary command buffer!");
+  }
 }
 
 void LveRenderer::createComputeCommandBuffers() {
-  computeCommandBuffers.resize(LveSwapChain::MAX_FRAMES_IN_FLIGHT);
+  computeCommandBuffers.resize(frameContext.getFramesInFlight());
 
   VkCommandBufferAllocateInfo allocInfo{};
   allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
   allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-  allocInfo.commandPool = lveDevice.getCommandPool();
+  // NOTE: recorded for the compute queue, which may be a separate family.
+  allocInfo.commandPool = lveDevice.getComputeCommandPool();
   allocInfo.commandBufferCount =
       static_cast<uint32_t>(computeCommandBuffers.size());
 
@@ -196,17 +353,23 @@ void LveRenderer::createComputeCommandBuffers() {
   }
 }
 void LveRenderer::freeComputeCommandBuffers() {
-  vkFreeCommandBuffers(lveDevice.device(), lveDevice.getCommandPool(),
+  vkFreeCommandBuffers(lveDevice.device(), lveDevice.getComputeCommandPool(),
                        static_cast<uint32_t>(computeCommandBuffers.size()),
                        computeCommandBuffers.data());
   computeCommandBuffers.clear();
 }
 
+void LveRenderer::saveLastFrame(const std::string& filepath) {
+  assert(!isFrameStarted && "Can't save a frame while it is being recorded.");
+  // currentImageIndex still refers to the image submitted by endFrame.
+  lveSwapChain->saveImage(currentImageIndex, filepath);
+}
+
 VkCommandBuffer LveRenderer::beginComputeFrame() {
   assert(!isComputeFrameStarted &&
          "Can't call beginComputeFrame while already in progress.");
 
-  // call swapchain compute fence wait
+  // wait for the compute work of this frame slot (compute timeline)
   lveSwapChain->prepareCompute();
 
   isComputeFrameStarted = true;
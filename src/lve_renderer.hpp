@@ -1,18 +1,26 @@
 #pragma once
 
 #include "lve_device.hpp"
+#include "lve_frame_context.hpp"
+#include "lve_latency_tracker.hpp"
 #include "lve_swap_chain.hpp"
 #include "lve_window.hpp"
 
 // std
 #include <cassert>
 #include <memory>
+#include <string>
 #include <vector>
 
 namespace lve {
 class LveRenderer {
  public:
-  LveRenderer(LveWindow &window, LveDevice &device);
+  // recordThreadCount : number of threads that record secondary command
+  // buffers (thread index 0 is the main thread).
+  LveRenderer(LveWindow &window, LveDevice &device,
+              const LveFrameContext &frameContext,
+              uint32_t recordThreadCount = 1,
+              const PresentSettings &presentSettings = PresentSettings{});
   ~LveRenderer();
 
   LveRenderer(const LveRenderer &) = delete;
@@ -22,7 +30,26 @@ class LveRenderer {
     return lveSwapChain->getRenderPass();
   }
   float getAspectRatio() const { return lveSwapChain->extentAspectRatio(); }
+  VkExtent2D getSwapChainExtent() const {
+    return lveSwapChain->getSwapChainExtent();
+  }
+  // fraction of the swap chain extent the scene is rendered at, upscaled to
+  // the swap chain image at the end of the render pass.
+  // NOTE: takes effect from the next beginFrame.
+  void setRenderScale(float scale);
+  float getRenderScale() const { return renderScale; }
+  // render pass area of the current frame.
+  VkExtent2D getRenderExtent() const {
+    assert(isFrameStarted &&
+           "Cannot get render extent when frame not in progress.");
+    return renderExtent;
+  }
   bool isFrameInProgress() const { return isFrameStarted; }
+  // the mode actually in use, may differ from the requested one.
+  VkPresentModeKHR getPresentMode() const {
+    return lveSwapChain->getPresentMode();
+  }
+  LveLatencyTracker &getLatencyTracker() { return latencyTracker; }
 
   VkCommandBuffer getCurrentCommandBuffer() const {
     assert(isFrameStarted &&
@@ -37,7 +64,9 @@ class LveRenderer {
   }
   VkCommandBuffer beginFrame();
   void endFrame();
-  void beginSwapChainRenderPass(VkCommandBuffer commandBuffer);
+  void beginSwapChainRenderPass(
+      VkCommandBuffer commandBuffer,
+      VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
   void endSwapChainRenderPass(VkCommandBuffer commandBuffer);
   VkCommandBuffer beginComputeFrame();
   void endComputeFrame();
@@ -47,21 +76,51 @@ class LveRenderer {
     return computeCommandBuffers[currentFrameIndex];
   }
 
+  // NOTE: also records the upscale blit to the swap chain image.
+  // secondary command buffers continue the swap chain render pass.
+  // each thread must use its own threadIndex (see LveThreadPool), so the
+  // per-thread command pools never need locking.
+  VkCommandBuffer beginSecondaryCommandBuffer(uint32_t threadIndex);
+  void endSecondaryCommandBuffer(VkCommandBuffer commandBuffer);
+  uint32_t getRecordThreadCount() const { return recordThreadCount; }
+
+  // headless only: writes the last submitted frame as a PPM image.
+  void saveLastFrame(const std::string &filepath);
+
  private:
+  // one pool per (frame in flight, thread). reset once per frame.
+  struct ThreadCommandPool {
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+    std::vector<VkCommandBuffer> secondaryCommandBuffers;
+    uint32_t usedCount = 0;
+  };
+
   void createCommandBuffers();
   void freeCommandBuffers();
   void recreateSwapChain();
   void createComputeCommandBuffers();
   void freeComputeCommandBuffers();
+  void createThreadCommandPools();
+  void destroyThreadCommandPools();
+  void resetThreadCommandPools(int frameIndex);
 
   LveWindow &lveWindow;
   LveDevice &lveDevice;
+  const LveFrameContext &frameContext;
   std::unique_ptr<LveSwapChain> lveSwapChain;
+  uint32_t recordThreadCount;
+  PresentSettings presentSettings;
+  LveLatencyTracker latencyTracker;
+  // [frameIndex][threadIndex]
+  std::vector<std::vector<ThreadCommandPool>> threadCommandPools;
+  // primary buffers live in the main thread(index 0) pool of each frame.
   std::vector<VkCommandBuffer> commandBuffers;
   std::vector<VkCommandBuffer> computeCommandBuffers;
 
   uint32_t currentImageIndex;
   int currentFrameIndex{0};
+  float renderScale{1.f};
+  VkExtent2D renderExtent{};
   bool isFrameStarted{false};
   bool isComputeFrameStarted{false};
 };
@@ -1,11 +1,17 @@
 #include "lve_swap_chain.hpp"
 
+#include "lve_buffer.hpp"
+#include "lve_config.hpp"
+#include "lve_cpu_profiler.hpp"
 #include "tut_texture.hpp"
 
 // std
+#include <algorithm>
 #include <array>
+#include <cassert>
 #include <cstdlib>
 #include <cstring>
+#include <fstream>
 #include <iostream>
 #include <limits>
 #include <set>
@@ -13,13 +19,25 @@
 
 namespace lve {
 
-LveSwapChain::LveSwapChain(LveDevice &deviceRef, VkExtent2D extent)
-    : device{deviceRef}, windowExtent{extent} {
+LveSwapChain::LveSwapChain(LveDevice &deviceRef,
+                           const LveFrameContext &frameContext,
+                           VkExtent2D extent, const PresentSettings &settings)
+    : device{deviceRef},
+      frameContext{frameContext},
+      windowExtent{extent},
+      settings{settings} {
   init();
 }
-LveSwapChain::LveSwapChain(LveDevice &deviceRef, VkExtent2D extent,
-                           std::shared_ptr<LveSwapChain> previous)
-    : device{deviceRef}, windowExtent{extent}, oldSwapChain{previous} {
+LveSwapChain::LveSwapChain(LveDevice &deviceRef,
+                           const LveFrameContext &frameContext,
+                           VkExtent2D extent,
+                           std::shared_ptr<LveSwapChain> previous,
+                           const PresentSettings &settings)
+    : device{deviceRef},
+      frameContext{frameContext},
+      windowExtent{extent},
+      oldSwapChain{previous},
+      settings{settings} {
   init();
 
   // clean up
@@ -27,10 +45,15 @@ LveSwapChain::LveSwapChain(LveDevice &deviceRef, VkExtent2D extent,
 }
 
 void LveSwapChain::init() {
-  createSwapChain();
+  if (device.isHeadless()) {
+    createOffscreenImages();
+  } else {
+    createSwapChain();
+  }
   createImageViews();
   createRenderPass();
   createColorResources();
+  createSceneResources();
   createDepthResources();
   createFramebuffers();
   createSyncObjects();
@@ -46,6 +69,10 @@ LveSwapChain::~LveSwapChain() {
     vkDestroySwapchainKHR(device.device(), swapChain, nullptr);
     swapChain = nullptr;
   }
+  for (int i = 0; i < offscreenImageMemorys.size(); i++) {
+    vkDestroyImage(device.device(), swapChainImages[i], nullptr);
+    vkFreeMemory(device.device(), offscreenImageMemorys[i], nullptr);
+  }
 
   for (int i = 0; i < depthImages.size(); i++) {
     vkDestroyImageView(device.device(), depthImageViews[i], nullptr);
@@ -59,6 +86,12 @@ LveSwapChain::~LveSwapChain() {
     vkFreeMemory(device.device(), colorImageMemorys[i], nullptr);
   }
 
+  for (int i = 0; i < sceneImages.size(); i++) {
+    vkDestroyImageView(device.device(), sceneImageViews[i], nullptr);
+    vkDestroyImage(device.device(), sceneImages[i], nullptr);
+    vkFreeMemory(device.device(), sceneImageMemorys[i], nullptr);
+  }
+
   for (auto framebuffer : swapChainFramebuffers) {
     vkDestroyFramebuffer(device.device(), framebuffer, nullptr);
   }
@@ -66,19 +99,26 @@ LveSwapChain::~LveSwapChain() {
   vkDestroyRenderPass(device.device(), renderPass, nullptr);
 
   // cleanup synchronization objects
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+  for (size_t i = 0; i < frameContext.getFramesInFlight(); i++) {
     vkDestroySemaphore(device.device(), renderFinishedSemaphores[i], nullptr);
     vkDestroySemaphore(device.device(), imageAvailableSemaphores[i], nullptr);
-    vkDestroyFence(device.device(), inFlightFences[i], nullptr);
-    vkDestroySemaphore(device.device(), computeFinishedSemaphores[i], nullptr);
-    vkDestroyFence(device.device(), computeInFlightFences[i], nullptr);
   }
 }
 
 VkResult LveSwapChain::acquireNextImage(uint32_t *imageIndex) {
-  vkWaitForFences(device.device(), 1, &inFlightFences[currentFrame], VK_TRUE,
-                  std::numeric_limits<uint64_t>::max());
+  {
+    LVE_PROFILE_SCOPE("wait_frame_slot");
+    device.graphicsTimeline().wait(graphicsFrameValues[currentFrame]);
+  }
 
+  // NOTE: one offscreen image per frame in flight, the wait above already
+  // guarantees its previous use has finished.
+  if (device.isHeadless()) {
+    *imageIndex = static_cast<uint32_t>(currentFrame);
+    return VK_SUCCESS;
+  }
+
+  LVE_PROFILE_SCOPE("acquire_image");
   VkResult result = vkAcquireNextImageKHR(
       device.device(), swapChain, std::numeric_limits<uint64_t>::max(),
       imageAvailableSemaphores[currentFrame],  // must be a not signaled
@@ -92,37 +132,69 @@ VkResult LveSwapChain::acquireNextImage(uint32_t *imageIndex) {
 }
 
 VkResult LveSwapChain::submitCommandBuffers(const VkCommandBuffer *buffers,
-                                            uint32_t *imageIndex) {
+                                            uint32_t *imageIndex,
+                                            uint64_t presentId) {
   VkSubmitInfo submitInfo = {};
   submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-  VkSemaphore waitSemaphores[] = {computeFinishedSemaphores[currentFrame],
+  bool headless = device.isHeadless();
+  auto &graphicsTimeline = device.graphicsTimeline();
+  auto &computeTimeline = device.computeTimeline();
+  uint64_t signalValue = graphicsTimeline.nextSignalValue();
+
+  // particles of this frame are read at draw indirect and vertex input. the
+  // compute submit of this frame is the latest one on the compute timeline.
+  // the acquired image is only written by the upscale blit (transfer).
+  // headless: no image acquire and no present to synchronize with.
+  VkSemaphore waitSemaphores[] = {computeTimeline.getSemaphore(),
                                   imageAvailableSemaphores[currentFrame]};
+  // NOTE: values of binary semaphores are ignored.
+  uint64_t waitValues[] = {computeTimeline.getLastSubmittedValue(), 0};
+  // NOTE: the acquire barriers of the compute buffers use the same stages
+  // as their source scope, so they chain with this wait.
   VkPipelineStageFlags waitStages[] = {
-      VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
-      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-  submitInfo.waitSemaphoreCount = 2;
+      VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+      VK_PIPELINE_STAGE_TRANSFER_BIT};
+  submitInfo.waitSemaphoreCount = headless ? 1 : 2;
   submitInfo.pWaitSemaphores = waitSemaphores;
   submitInfo.pWaitDstStageMask = waitStages;
 
   submitInfo.commandBufferCount = 1;
   submitInfo.pCommandBuffers = buffers;
 
-  VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[currentFrame]};
-  submitInfo.signalSemaphoreCount = 1;
+  VkSemaphore signalSemaphores[] = {graphicsTimeline.getSemaphore(),
+                                    renderFinishedSemaphores[currentFrame]};
+  uint64_t signalValues[] = {signalValue, 0};
+  submitInfo.signalSemaphoreCount = headless ? 1 : 2;
   submitInfo.pSignalSemaphores = signalSemaphores;
 
-  vkResetFences(device.device(), 1, &inFlightFences[currentFrame]);
-  if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo,
-                    inFlightFences[currentFrame]) != VK_SUCCESS) {
-    throw std::runtime_error("failed to submit draw command buffer!");
+  VkTimelineSemaphoreSubmitInfo timelineInfo{};
+  timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+  timelineInfo.waitSemaphoreValueCount = submitInfo.waitSemaphoreCount;
+  timelineInfo.pWaitSemaphoreValues = waitValues;
+  timelineInfo.signalSemaphoreValueCount = submitInfo.signalSemaphoreCount;
+  timelineInfo.pSignalSemaphoreValues = signalValues;
+  submitInfo.pNext = &timelineInfo;
+
+  {
+    LVE_PROFILE_SCOPE("queue_submit");
+    if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo,
+                      VK_NULL_HANDLE) != VK_SUCCESS) {
+      throw std::runtime_error("failed to submit draw command buffer!");
+    }
+  }
+  graphicsFrameValues[currentFrame] = signalValue;
+
+  if (headless) {
+    currentFrame = frameContext.nextFrameIndex(static_cast<int>(currentFrame));
+    return VK_SUCCESS;
   }
 
   VkPresentInfoKHR presentInfo = {};
   presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
   presentInfo.waitSemaphoreCount = 1;
-  presentInfo.pWaitSemaphores = signalSemaphores;
+  presentInfo.pWaitSemaphores = &renderFinishedSemaphores[currentFrame];
 
   VkSwapchainKHR swapChains[] = {swapChain};
   presentInfo.swapchainCount = 1;
@@ -130,23 +202,42 @@ VkResult LveSwapChain::submitCommandBuffers(const VkCommandBuffer *buffers,
 
   presentInfo.pImageIndices = imageIndex;
 
+  VkPresentIdKHR presentIdInfo{};
+  presentIdInfo.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+  presentIdInfo.swapchainCount = 1;
+  presentIdInfo.pPresentIds = &presentId;
+  if (presentId != 0 && device.isPresentWaitEnabled()) {
+    presentInfo.pNext = &presentIdInfo;
+  }
+
+  LVE_PROFILE_SCOPE("queue_present");
   auto result = vkQueuePresentKHR(device.presentQueue(), &presentInfo);
 
-  currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+  currentFrame = frameContext.nextFrameIndex(static_cast<int>(currentFrame));
 
   return result;
 }
 
+bool LveSwapChain::waitForPresent(uint64_t presentId, uint64_t timeout) {
+  if (swapChain == VK_NULL_HANDLE || !device.isPresentWaitEnabled()) {
+    return false;
+  }
+  return device.waitForPresent(swapChain, presentId, timeout) == VK_SUCCESS;
+}
+
 void LveSwapChain::createSwapChain() {
   SwapChainSupportDetails swapChainSupport = device.getSwapChainSupport();
 
   VkSurfaceFormatKHR surfaceFormat =
       chooseSwapSurfaceFormat(swapChainSupport.formats);
-  VkPresentModeKHR presentMode =
-      chooseSwapPresentMode(swapChainSupport.presentModes);
+  presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
   VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
 
   uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
+  if (settings.imageCount > 0) {
+    imageCount = std::max(settings.imageCount,
+                          swapChainSupport.capabilities.minImageCount);
+  }
   if (swapChainSupport.capabilities.maxImageCount > 0 &&
       imageCount > swapChainSupport.capabilities.maxImageCount) {
     imageCount = swapChainSupport.capabilities.maxImageCount;
@@ -166,7 +257,13 @@ void LveSwapChain::createSwapChain() {
   createInfo.imageColorSpace = surfaceFormat.colorSpace;
   createInfo.imageExtent = extent;
   createInfo.imageArrayLayers = 1;
-  createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+  // written by the upscale blit, never rendered to directly.
+  if ((swapChainSupport.capabilities.supportedUsageFlags &
+       VK_IMAGE_USAGE_TRANSFER_DST_BIT) == 0) {
+    throw std::runtime_error("swap chain images do not support transfer dst!");
+  }
+  createInfo.imageUsage =
+      VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
 
   QueueFamilyIndices indices = device.findPhysicalQueueFamilies();
   uint32_t queueFamilyIndices[] = {indices.graphicsAndComputeFamily.value(),
@@ -218,7 +315,45 @@ void LveSwapChain::createSwapChain() {
   swapChainExtent = extent;
 }
 
+void LveSwapChain::createOffscreenImages() {
+  // NOTE: same format as the usual surface format, so the render pass and
+  // every pipeline stay compatible with the windowed path.
+  swapChainImageFormat = VK_FORMAT_B8G8R8A8_SRGB;
+  swapChainExtent = windowExtent;
+
+  swapChainImages.resize(frameContext.getFramesInFlight());
+  offscreenImageMemorys.resize(frameContext.getFramesInFlight());
+  for (int i = 0; i < swapChainImages.size(); i++) {
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent.width = swapChainExtent.width;
+    imageInfo.extent.height = swapChainExtent.height;
+    imageInfo.extent.depth = 1;
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = swapChainImageFormat;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    // upscale blit destination, transfer src for readback
+    imageInfo.usage =
+        VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.flags = 0;
+
+    device.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                               swapChainImages[i], offscreenImageMemorys[i]);
+  }
+  std::cout << "headless: " << swapChainImages.size() << " offscreen images ("
+            << swapChainExtent.width << "x" << swapChainExtent.height << ")"
+            << std::endl;
+}
+
 void LveSwapChain::createImageViews() {
+  // NOTE: offscreen images are transfer only (blit target, readback source),
+  // a view of them would be invalid and nothing renders into them.
+  if (device.isHeadless()) return;
   swapChainImageViews.resize(swapChainImages.size());
   for (size_t i = 0; i < swapChainImages.size(); i++) {
     swapChainImageViews[i] = device.createImageView(
@@ -246,7 +381,8 @@ void LveSwapChain::createRenderPass() {
   colorAttachment.format = getSwapChainImageFormat();
   colorAttachment.samples = device.getSampleCount();
   colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-  colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  // only the resolve attachment is kept.
+  colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
   colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
   colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
   colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -264,7 +400,8 @@ void LveSwapChain::createRenderPass() {
   colorAttachmentResolve.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
   colorAttachmentResolve.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
   colorAttachmentResolve.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-  colorAttachmentResolve.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+  // scene image, blitted to the swap chain image afterwards.
+  colorAttachmentResolve.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
 
   VkAttachmentReference colorAttachmentResolveRef{};
   colorAttachmentResolveRef.attachment = 2;
@@ -307,13 +444,13 @@ void LveSwapChain::createRenderPass() {
 }
 
 void LveSwapChain::createFramebuffers() {
-  swapChainFramebuffers.resize(imageCount());
-  for (size_t i = 0; i < imageCount(); i++) {
+  swapChainFramebuffers.resize(frameContext.getFramesInFlight());
+  for (size_t i = 0; i < swapChainFramebuffers.size(); i++) {
     // attachment ref index order
     std::array<VkImageView, 3> attachments = {
         colorImageViews[i],
         depthImageViews[i],
-        swapChainImageViews[i],
+        sceneImageViews[i],
     };
 
     VkExtent2D swapChainExtent = getSwapChainExtent();
@@ -339,9 +476,10 @@ void LveSwapChain::createDepthResources() {
   swapChainDepthFormat = depthFormat;
   VkExtent2D swapChainExtent = getSwapChainExtent();
 
-  depthImages.resize(imageCount());
-  depthImageMemorys.resize(imageCount());
-  depthImageViews.resize(imageCount());
+  uint32_t framesInFlight = frameContext.getFramesInFlight();
+  depthImages.resize(framesInFlight);
+  depthImageMemorys.resize(framesInFlight);
+  depthImageViews.resize(framesInFlight);
 
   for (int i = 0; i < depthImages.size(); i++) {
     VkImageCreateInfo imageInfo{};
@@ -355,51 +493,38 @@ void LveSwapChain::createDepthResources() {
     imageInfo.format = depthFormat;
     imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
     imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    // cleared on load, never stored.
+    imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+                      VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
     imageInfo.samples = device.getSampleCount();
     imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
     imageInfo.flags = 0;
 
-    device.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                               depthImages[i], depthImageMemorys[i]);
+    // NOTE: initial layout of the render pass is UNDEFINED, no transition.
+    device.createTransientImage(imageInfo, depthImages[i],
+                                depthImageMemorys[i]);
 
     depthImageViews[i] = device.createImageView(depthImages[i], depthFormat,
                                                 VK_IMAGE_ASPECT_DEPTH_BIT);
-
-    // NOTE: depth mask condition
-    device.transitionImageLayout(
-        depthImages[i], depthFormat, VK_IMAGE_LAYOUT_UNDEFINED,
-        VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
   }
 }
 
 void LveSwapChain::createSyncObjects() {
-  imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-  renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-  inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-
-  computeFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-  computeInFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
+  imageAvailableSemaphores.resize(frameContext.getFramesInFlight());
+  renderFinishedSemaphores.resize(frameContext.getFramesInFlight());
+  // 0 : nothing submitted yet, waits return immediately.
+  graphicsFrameValues.assign(frameContext.getFramesInFlight(), 0);
+  computeFrameValues.assign(frameContext.getFramesInFlight(), 0);
   std::cout << "image count : " << imageCount() << std::endl;
 
   VkSemaphoreCreateInfo semaphoreInfo = {};
   semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-  VkFenceCreateInfo fenceInfo = {};
-  fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-  fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+  for (size_t i = 0; i < frameContext.getFramesInFlight(); i++) {
     if ((vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr,
                            &imageAvailableSemaphores[i]) != VK_SUCCESS) ||
         (vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr,
-                           &renderFinishedSemaphores[i]) != VK_SUCCESS) ||
-        (vkCreateFence(device.device(), &fenceInfo, nullptr,
-                       &inFlightFences[i]) != VK_SUCCESS) ||
-        (vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr,
-                           &computeFinishedSemaphores[i]) != VK_SUCCESS) ||
-        (vkCreateFence(device.device(), &fenceInfo, nullptr,
-                       &computeInFlightFences[i]) != VK_SUCCESS)) {
+                           &renderFinishedSemaphores[i]) != VK_SUCCESS)) {
       throw std::runtime_error(
           "failed to create synchronization objects for a frame!");
     }
@@ -420,21 +545,21 @@ VkSurfaceFormatKHR LveSwapChain::chooseSwapSurfaceFormat(
 
 VkPresentModeKHR LveSwapChain::chooseSwapPresentMode(
     const std::vector<VkPresentModeKHR> &availablePresentModes) {
+  // FIFO : v-sync, highest latency. MAILBOX : latest image replaces the queued
+  // one. IMMEDIATE : no wait at all, may tear.
   for (const auto &availablePresentMode : availablePresentModes) {
-    if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-      std::cout << "Present mode: Mailbox" << std::endl;
+    if (availablePresentMode == settings.presentMode) {
+      std::cout << "Present mode: "
+                << LveConfig::presentModeName(availablePresentMode)
+                << std::endl;
       return availablePresentMode;
     }
   }
 
-  // for (const auto &availablePresentMode : availablePresentModes) {
-  //   if (availablePresentMode == VK_PRESENT_MODE_IMMEDIATE_KHR) {
-  //     std::cout << "Present mode: Immediate" << std::endl;
-  //     return availablePresentMode;
-  //   }
-  // }
-
-  std::cout << "Present mode: V-Sync" << std::endl;
+  // FIFO is the only mode that is always supported.
+  std::cout << "Present mode: "
+            << LveConfig::presentModeName(settings.presentMode)
+            << " not supported, V-Sync" << std::endl;
   return VK_PRESENT_MODE_FIFO_KHR;
 }
 
@@ -466,9 +591,12 @@ void LveSwapChain::createColorResources() {
   VkFormat colorFormat = swapChainImageFormat;
   VkExtent2D swapChainExtent = getSwapChainExtent();
 
-  colorImages.resize(imageCount());
-  colorImageMemorys.resize(imageCount());
-  colorImageViews.resize(imageCount());
+  // NOTE: only the frames in flight render at the same time, the swap chain
+  // images are never attachments (see recordUpscale).
+  uint32_t framesInFlight = frameContext.getFramesInFlight();
+  colorImages.resize(framesInFlight);
+  colorImageMemorys.resize(framesInFlight);
+  colorImageViews.resize(framesInFlight);
 
   for (int i = 0; i < colorImages.size(); i++) {
     VkImageCreateInfo imageInfo{};
@@ -482,24 +610,166 @@ void LveSwapChain::createColorResources() {
     imageInfo.format = colorFormat;
     imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
     imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    imageInfo.usage =
-        VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    // resolved in the render pass, never stored.
+    imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                      VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
     imageInfo.samples = device.getSampleCount();
     imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
     imageInfo.flags = 0;
 
-    device.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                               colorImages[i], colorImageMemorys[i]);
+    bool lazilyAllocated = device.createTransientImage(
+        imageInfo, colorImages[i], colorImageMemorys[i]);
+    if (i == 0) {
+      std::cout << "transient attachments: "
+                << (lazilyAllocated ? "lazily allocated" : "device local")
+                << std::endl;
+    }
 
     colorImageViews[i] = device.createImageView(colorImages[i], colorFormat,
                                                 VK_IMAGE_ASPECT_COLOR_BIT, 1u);
   }
 }
 
+void LveSwapChain::createSceneResources() {
+  VkExtent2D swapChainExtent = getSwapChainExtent();
+
+  // scene and swap chain images share the format. without blit support the
+  // scene is copied, which cannot scale (full resolution only).
+  upscaleSupported = device.isFormatSupported(
+      swapChainImageFormat, VK_IMAGE_TILING_OPTIMAL,
+      VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT);
+  // blit needs the linear filter feature, nearest is always allowed.
+  upscaleFilter = device.isFormatSupported(
+                      swapChainImageFormat, VK_IMAGE_TILING_OPTIMAL,
+                      VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)
+                      ? VK_FILTER_LINEAR
+                      : VK_FILTER_NEAREST;
+  if (!upscaleSupported) {
+    std::cout << "no blit support for the swap chain format, dynamic "
+                 "resolution disabled"
+              << std::endl;
+  }
+
+  uint32_t framesInFlight = frameContext.getFramesInFlight();
+  sceneImages.resize(framesInFlight);
+  sceneImageMemorys.resize(framesInFlight);
+  sceneImageViews.resize(framesInFlight);
+
+  for (int i = 0; i < sceneImages.size(); i++) {
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent.width = swapChainExtent.width;
+    imageInfo.extent.height = swapChainExtent.height;
+    imageInfo.extent.depth = 1;
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = swapChainImageFormat;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage =
+        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.flags = 0;
+
+    device.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                               sceneImages[i], sceneImageMemorys[i]);
+
+    sceneImageViews[i] = device.createImageView(
+        sceneImages[i], swapChainImageFormat, VK_IMAGE_ASPECT_COLOR_BIT, 1u);
+  }
+}
+
+void LveSwapChain::recordUpscale(VkCommandBuffer commandBuffer,
+                                 int frameIndex, uint32_t imageIndex,
+                                 VkExtent2D renderExtent) {
+  assert(renderExtent.width <= swapChainExtent.width &&
+         renderExtent.height <= swapChainExtent.height &&
+         "Render extent larger than the swap chain.");
+
+  VkImageSubresourceRange subresourceRange{};
+  subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  subresourceRange.baseMipLevel = 0;
+  subresourceRange.levelCount = 1;
+  subresourceRange.baseArrayLayer = 0;
+  subresourceRange.layerCount = 1;
+
+  // scene: resolve writes -> blit read (already TRANSFER_SRC_OPTIMAL).
+  // swap chain image: previous contents are not needed.
+  std::array<VkImageMemoryBarrier, 2> barriers{};
+  for (auto &barrier : barriers) {
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.subresourceRange = subresourceRange;
+  }
+  barriers[0].image = sceneImages[frameIndex];
+  barriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+  barriers[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+  barriers[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  barriers[0].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+  barriers[1].image = swapChainImages[imageIndex];
+  barriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  barriers[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barriers[1].srcAccessMask = 0;
+  barriers[1].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  // NOTE: transfer is also the wait stage of the image acquire semaphore.
+  vkCmdPipelineBarrier(commandBuffer,
+                       VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+                           VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0,
+                       nullptr, static_cast<uint32_t>(barriers.size()),
+                       barriers.data());
+
+  VkImageSubresourceLayers subresource{};
+  subresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  subresource.mipLevel = 0;
+  subresource.baseArrayLayer = 0;
+  subresource.layerCount = 1;
+  if (upscaleSupported) {
+    VkImageBlit blit{};
+    blit.srcSubresource = subresource;
+    blit.srcOffsets[1] = {static_cast<int32_t>(renderExtent.width),
+                          static_cast<int32_t>(renderExtent.height), 1};
+    blit.dstSubresource = subresource;
+    blit.dstOffsets[1] = {static_cast<int32_t>(swapChainExtent.width),
+                          static_cast<int32_t>(swapChainExtent.height), 1};
+    vkCmdBlitImage(commandBuffer, sceneImages[frameIndex],
+                   VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                   swapChainImages[imageIndex],
+                   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit,
+                   upscaleFilter);
+  } else {
+    assert(renderExtent.width == swapChainExtent.width &&
+           renderExtent.height == swapChainExtent.height &&
+           "Copy fallback cannot scale.");
+    VkImageCopy copyRegion{};
+    copyRegion.srcSubresource = subresource;
+    copyRegion.dstSubresource = subresource;
+    copyRegion.extent = {swapChainExtent.width, swapChainExtent.height, 1};
+    vkCmdCopyImage(commandBuffer, sceneImages[frameIndex],
+                   VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                   swapChainImages[imageIndex],
+                   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyRegion);
+  }
+
+  // headless images are read back instead of presented.
+  VkImageMemoryBarrier presentBarrier = barriers[1];
+  presentBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  presentBarrier.newLayout = device.isHeadless()
+                                 ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+                                 : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+  presentBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  presentBarrier.dstAccessMask = 0;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0,
+                       nullptr, 1, &presentBarrier);
+}
+
 void LveSwapChain::prepareCompute() {
-  vkWaitForFences(device.device(), 1, &computeInFlightFences[currentFrame],
-                  VK_TRUE, std::numeric_limits<uint64_t>::max());
-  vkResetFences(device.device(), 1, &computeInFlightFences[currentFrame]);
+  LVE_PROFILE_SCOPE("wait_compute_slot");
+  device.computeTimeline().wait(computeFrameValues[currentFrame]);
 }
 
 void LveSwapChain::submitComputeCommandBuffers(
@@ -511,14 +781,129 @@ void LveSwapChain::submitComputeCommandBuffers(
   // NOTE: only one cmd buffer.
   submitInfo.pCommandBuffers = computeCommandBuffers;
 
-  VkSemaphore signalSemaphores[] = {computeFinishedSemaphores[currentFrame]};
-  submitInfo.signalSemaphoreCount = 1;
-  submitInfo.pSignalSemaphores = signalSemaphores;
+  auto &graphicsTimeline = device.graphicsTimeline();
+  auto &computeTimeline = device.computeTimeline();
+  // previous compute submit wrote the particles this one reads.
+  uint64_t previousComputeValue = computeTimeline.getLastSubmittedValue();
+  uint64_t signalValue = computeTimeline.nextSignalValue();
+
+  VkSemaphore waitSemaphores[] = {graphicsTimeline.getSemaphore(),
+                                  computeTimeline.getSemaphore()};
+  uint64_t waitValues[] = {graphicsFrameValues[currentFrame],
+                           previousComputeValue};
+  // graphics reads the vertex copy the compute frame writes at transfer.
+  VkPipelineStageFlags waitStages[] = {
+      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT};
+  submitInfo.waitSemaphoreCount = 2;
+  submitInfo.pWaitSemaphores = waitSemaphores;
+  submitInfo.pWaitDstStageMask = waitStages;
 
-  if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo,
-                    computeInFlightFences[currentFrame]) != VK_SUCCESS) {
+  VkSemaphore signalSemaphore = computeTimeline.getSemaphore();
+  submitInfo.signalSemaphoreCount = 1;
+  submitInfo.pSignalSemaphores = &signalSemaphore;
+
+  VkTimelineSemaphoreSubmitInfo timelineInfo{};
+  timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+  timelineInfo.waitSemaphoreValueCount = 2;
+  timelineInfo.pWaitSemaphoreValues = waitValues;
+  timelineInfo.signalSemaphoreValueCount = 1;
+  timelineInfo.pSignalSemaphoreValues = &signalValue;
+  submitInfo.pNext = &timelineInfo;
+
+  // NOTE: overlaps the graphics work of the previous frame when the compute
+  // queue is a dedicated family.
+  if (vkQueueSubmit(device.computeQueue(), 1, &submitInfo, VK_NULL_HANDLE) !=
+      VK_SUCCESS) {
     throw std::runtime_error("failed to submit compute command buffer!");
   }
+  computeFrameValues[currentFrame] = signalValue;
+}
+
+void LveSwapChain::saveImage(uint32_t imageIndex,
+                             const std::string &filepath) {
+  assert(device.isHeadless() &&
+         "Only offscreen images can be read back (transfer src usage).");
+  assert(imageIndex < swapChainImages.size() && "Image index out of range.");
+
+  // the frame that rendered the image may still be in flight.
+  vkQueueWaitIdle(device.graphicsQueue());
+
+  uint32_t imageWidth = swapChainExtent.width;
+  uint32_t imageHeight = swapChainExtent.height;
+  LveBuffer stagingBuffer{
+      device,
+      4,
+      imageWidth * imageHeight,
+      VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+  };
+  stagingBuffer.map();
+
+  VkCommandBuffer commandBuffer = device.beginSingleTimeCommands();
+
+  // upscale blit writes -> copy. layout is already TRANSFER_SRC_OPTIMAL
+  // (see recordUpscale).
+  VkImageMemoryBarrier imageBarrier{};
+  imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  imageBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+  imageBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+  imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  imageBarrier.image = swapChainImages[imageIndex];
+  imageBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  imageBarrier.subresourceRange.baseMipLevel = 0;
+  imageBarrier.subresourceRange.levelCount = 1;
+  imageBarrier.subresourceRange.baseArrayLayer = 0;
+  imageBarrier.subresourceRange.layerCount = 1;
+  imageBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  imageBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0,
+                       nullptr, 1, &imageBarrier);
+
+  VkBufferImageCopy region{};
+  region.bufferOffset = 0;
+  region.bufferRowLength = 0;
+  region.bufferImageHeight = 0;
+  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  region.imageSubresource.mipLevel = 0;
+  region.imageSubresource.baseArrayLayer = 0;
+  region.imageSubresource.layerCount = 1;
+  region.imageOffset = {0, 0, 0};
+  region.imageExtent = {imageWidth, imageHeight, 1};
+  vkCmdCopyImageToBuffer(commandBuffer, swapChainImages[imageIndex],
+                         VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                         stagingBuffer.getBuffer(), 1, &region);
+
+  VkMemoryBarrier hostBarrier{};
+  hostBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  hostBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &hostBarrier, 0,
+                       nullptr, 0, nullptr);
+
+  device.endSingleTimeCommands(commandBuffer);
+
+  std::ofstream file(filepath, std::ios::binary | std::ios::trunc);
+  if (!file.is_open()) {
+    throw std::runtime_error("failed to open capture file: " + filepath);
+  }
+  file << "P6\n" << imageWidth << " " << imageHeight << "\n255\n";
+
+  // BGRA -> RGB. sRGB encoded values are written as they are.
+  auto *pixels = static_cast<const uint8_t *>(stagingBuffer.getMappedMemory());
+  std::vector<char> row(imageWidth * 3);
+  for (uint32_t y = 0; y < imageHeight; y++) {
+    const uint8_t *src = pixels + y * imageWidth * 4;
+    for (uint32_t x = 0; x < imageWidth; x++) {
+      row[x * 3 + 0] = static_cast<char>(src[x * 4 + 2]);
+      row[x * 3 + 1] = static_cast<char>(src[x * 4 + 1]);
+      row[x * 3 + 2] = static_cast<char>(src[x * 4 + 0]);
+    }
+    file.write(row.data(), row.size());
+  }
 }
 
 }  // namespace lve
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "lve_device.hpp"
+#include "lve_frame_context.hpp"
 
 // vulkan headers
 #include <vulkan/vulkan.h>
@@ -12,23 +13,34 @@
 
 namespace lve {
 
+struct PresentSettings {
+  // preferred mode. FIFO is used when the surface does not support it.
+  VkPresentModeKHR presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+  // 0: minImageCount + 1. clamped to the surface capabilities.
+  uint32_t imageCount = 0;
+};
+
 class LveSwapChain {
  public:
-  static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
-
-  LveSwapChain(LveDevice &deviceRef, VkExtent2D windowExtent);
-  LveSwapChain(LveDevice &deviceRef, VkExtent2D windowExtent,
-               std::shared_ptr<LveSwapChain> previous);
+  // sync objects (and headless images) exist once per frame in flight.
+  LveSwapChain(LveDevice &deviceRef, const LveFrameContext &frameContext,
+               VkExtent2D windowExtent,
+               const PresentSettings &settings = PresentSettings{});
+  LveSwapChain(LveDevice &deviceRef, const LveFrameContext &frameContext,
+               VkExtent2D windowExtent, std::shared_ptr<LveSwapChain> previous,
+               const PresentSettings &settings = PresentSettings{});
 
   ~LveSwapChain();
 
   LveSwapChain(const LveSwapChain &) = delete;
   LveSwapChain &operator=(const LveSwapChain &) = delete;
 
-  VkFramebuffer getFrameBuffer(int index) {
-    return swapChainFramebuffers[index];
+  // attachments exist once per frame in flight, not per swap chain image.
+  VkFramebuffer getFrameBuffer(int frameIndex) {
+    return swapChainFramebuffers[frameIndex];
   }
   VkRenderPass getRenderPass() { return renderPass; }
+  // NOTE: no views in headless mode.
   VkImageView getImageView(int index) { return swapChainImageViews[index]; }
   size_t imageCount() { return swapChainImages.size(); }
   VkFormat getSwapChainImageFormat() { return swapChainImageFormat; }
@@ -42,27 +54,52 @@ class LveSwapChain {
   }
   VkFormat findDepthFormat();
 
+  // NOTE: the render pass resolves into a scene image of swap chain size.
+  // rendering into the top left renderExtent of it and blitting that to the
+  // swap chain image gives dynamic resolution without recreating anything.
+  // call after the render pass, renderExtent <= swap chain extent.
+  void recordUpscale(VkCommandBuffer commandBuffer, int frameIndex,
+                     uint32_t imageIndex, VkExtent2D renderExtent);
+  // false: the format has no blit support, renderExtent must be the full
+  // swap chain extent.
+  bool supportsUpscale() const { return upscaleSupported; }
+
   VkResult acquireNextImage(uint32_t *imageIndex);
+  // presentId : attached with VK_KHR_present_id when non zero.
   VkResult submitCommandBuffers(const VkCommandBuffer *buffers,
-                                uint32_t *imageIndex);
+                                uint32_t *imageIndex, uint64_t presentId = 0);
+  // true once presentId (or a later one) reached the display.
+  bool waitForPresent(uint64_t presentId, uint64_t timeout);
+  VkPresentModeKHR getPresentMode() const { return presentMode; }
 
   bool compareSwapFormats(const LveSwapChain &swapChain) const {
     return swapChain.swapChainImageFormat == swapChainImageFormat &&
            swapChain.swapChainDepthFormat == swapChainDepthFormat;
   }
+  // waits until the compute work of this frame slot has finished.
   void prepareCompute();
+  // NOTE: waits on the GPU for the graphics work of this frame slot, which
+  // still reads the particle buffer the compute pass writes, and for the
+  // previous compute submit.
   void submitComputeCommandBuffers(
       const VkCommandBuffer *computeCommandBuffers);
 
+  // headless only: copies a rendered image to the host and writes a PPM.
+  // waits for the graphics queue to be idle.
+  void saveImage(uint32_t imageIndex, const std::string &filepath);
+
  private:
   void init();
   void createSwapChain();
+  // headless replacement of the swap chain images (device.isHeadless()).
+  void createOffscreenImages();
   void createImageViews();
   void createDepthResources();
   void createRenderPass();
   void createFramebuffers();
   void createSyncObjects();
   void createColorResources();
+  void createSceneResources();
 
   // Helper functions
   VkSurfaceFormatKHR chooseSwapSurfaceFormat(
@@ -78,6 +115,7 @@ class LveSwapChain {
   std::vector<VkFramebuffer> swapChainFramebuffers;
   VkRenderPass renderPass;
 
+  // transient MSAA color and depth, scene images: per frame in flight
   std::vector<VkImage> depthImages;
   std::vector<VkDeviceMemory> depthImageMemorys;
   std::vector<VkImageView> depthImageViews;
@@ -86,22 +124,35 @@ class LveSwapChain {
   std::vector<VkDeviceMemory> colorImageMemorys;
   std::vector<VkImageView> colorImageViews;
 
+  // single sample, resolved scene. blit source of recordUpscale
+  std::vector<VkImage> sceneImages;
+  std::vector<VkDeviceMemory> sceneImageMemorys;
+  std::vector<VkImageView> sceneImageViews;
+  VkFilter upscaleFilter = VK_FILTER_LINEAR;
+  bool upscaleSupported = true;
+
   std::vector<VkImage> swapChainImages;
   std::vector<VkImageView> swapChainImageViews;
+  // only owned in headless mode, swap chain images belong to the swap chain.
+  std::vector<VkDeviceMemory> offscreenImageMemorys;
 
   LveDevice &device;
+  const LveFrameContext &frameContext;
   VkExtent2D windowExtent;
 
-  VkSwapchainKHR swapChain;
+  VkSwapchainKHR swapChain = VK_NULL_HANDLE;
+  PresentSettings settings;
+  VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
   std::shared_ptr<LveSwapChain> oldSwapChain;
 
+  // NOTE: acquire and present only accept binary semaphores.
   std::vector<VkSemaphore> imageAvailableSemaphores;
   std::vector<VkSemaphore> renderFinishedSemaphores;
-  std::vector<VkFence> inFlightFences;
+  // device timeline values signaled by the latest submits of each frame slot,
+  // waiting for them replaces the per frame fences.
+  std::vector<uint64_t> graphicsFrameValues;
+  std::vector<uint64_t> computeFrameValues;
   size_t currentFrame = 0;
-
-  std::vector<VkFence> computeInFlightFences;
-  std::vector<VkSemaphore> computeFinishedSemaphores;
 };
 
 }  // namespace lve
@@ -0,0 +1,83 @@
+#include "lve_texture_registry.hpp"
+
+// std
+#include <cassert>
+#include <stdexcept>
+
+namespace lve {
+
+LveTextureRegistry::LveTextureRegistry(LveDevice& device) : lveDevice{device} {
+  // NOTE: update after bind + unused while pending lets us write new slots
+  // while in-flight frames still use the same descriptor set.
+  descriptorPool =
+      LveDescriptorPool::Builder(lveDevice)
+          .setMaxSets(1)
+          .setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT)
+          .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, MAX_TEXTURES)
+          .build();
+
+  descriptorSetLayout =
+      LveDescriptorSetLayout::Builder(lveDevice)
+          .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                      VK_SHADER_STAGE_FRAGMENT_BIT, MAX_TEXTURES,
+                      VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+                          VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+                          VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT)
+          .setLayoutFlags(
+              VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT)
+          .build();
+
+  if (!descriptorPool->allocateDescriptor(
+          descriptorSetLayout->getDescriptorSetLayout(), descriptorSet)) {
+    throw std::runtime_error("failed to allocate bindless texture set!");
+  }
+}
+
+LveTextureRegistry::~LveTextureRegistry() {}
+
+uint32_t LveTextureRegistry::registerTexture(VkImageView imageView,
+                                             VkSampler sampler) {
+  uint32_t index;
+  if (!freeSlots.empty()) {
+    index = freeSlots.back();
+    freeSlots.pop_back();
+  } else {
+    if (nextUnusedSlot >= MAX_TEXTURES) {
+      throw std::runtime_error("bindless texture slots exhausted!");
+    }
+    index = nextUnusedSlot++;
+  }
+
+  VkDescriptorImageInfo imageInfo{};
+  imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  imageInfo.imageView = imageView;
+  imageInfo.sampler = sampler;
+  LveDescriptorWriter(*descriptorSetLayout, *descriptorPool)
+      .writeImage(0, &imageInfo, index)
+      .overwrite(descriptorSet);
+
+  registeredCount++;
+  return index;
+}
+
+void LveTextureRegistry::unregisterTexture(uint32_t index) {
+  assert(index < nextUnusedSlot && "Unregistering unknown texture slot");
+  // submitted frames and the one being recorded may still sample this slot.
+  uint64_t retireValue =
+      lveDevice.graphicsTimeline().getLastSubmittedValue() + 1;
+  retiredSlots.push_back({index, retireValue});
+  registeredCount--;
+}
+
+void LveTextureRegistry::nextFrame() {
+  for (auto it = retiredSlots.begin(); it != retiredSlots.end();) {
+    if (lveDevice.graphicsTimeline().isComplete(it->retireValue)) {
+      freeSlots.push_back(it->index);
+      it = retiredSlots.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+}  // namespace lve
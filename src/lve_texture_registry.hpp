@@ -0,0 +1,58 @@
+#pragma once
+
+#include "lve_descriptors.hpp"
+#include "lve_device.hpp"
+
+// std
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace lve {
+
+// One bindless array of combined image samplers (descriptor indexing).
+// Textures register a slot and shaders index the array with it, so the
+// descriptor set is bound once per frame instead of once per object.
+class LveTextureRegistry {
+ public:
+  static constexpr uint32_t MAX_TEXTURES = 1024;
+  static constexpr uint32_t INVALID_INDEX =
+      std::numeric_limits<uint32_t>::max();
+
+  LveTextureRegistry(LveDevice &device);
+  ~LveTextureRegistry();
+
+  LveTextureRegistry(const LveTextureRegistry &) = delete;
+  LveTextureRegistry &operator=(const LveTextureRegistry &) = delete;
+
+  // returns slot index used by shaders.
+  uint32_t registerTexture(VkImageView imageView, VkSampler sampler);
+  // slot is recycled once the graphics timeline passes every frame that may
+  // reference it.
+  void unregisterTexture(uint32_t index);
+  // call once per frame to recycle released slots.
+  void nextFrame();
+
+  VkDescriptorSetLayout getDescriptorSetLayout() const {
+    return descriptorSetLayout->getDescriptorSetLayout();
+  }
+  VkDescriptorSet getDescriptorSet() const { return descriptorSet; }
+  uint32_t getRegisteredCount() const { return registeredCount; }
+
+ private:
+  struct RetiredSlot {
+    uint32_t index;
+    uint64_t retireValue;
+  };
+
+  LveDevice &lveDevice;
+  std::unique_ptr<LveDescriptorPool> descriptorPool;
+  std::unique_ptr<LveDescriptorSetLayout> descriptorSetLayout;
+  VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+
+  std::vector<uint32_t> freeSlots;
+  std::vector<RetiredSlot> retiredSlots;
+  uint32_t nextUnusedSlot = 0;
+  uint32_t registeredCount = 0;
+};
+}  // namespace lve
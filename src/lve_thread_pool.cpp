@@ -0,0 +1,58 @@
+#include "lve_thread_pool.hpp"
+
+#include "lve_cpu_profiler.hpp"
+
+// std
+#include <algorithm>
+#include <string>
+
+namespace lve {
+
+namespace {
+thread_local uint32_t tlsThreadIndex = 0;
+}  // namespace
+
+LveThreadPool::LveThreadPool(uint32_t workerCount) {
+  if (workerCount == 0) {
+    uint32_t hardwareThreads = std::thread::hardware_concurrency();
+    workerCount = std::max(hardwareThreads, 2u) - 1;
+  }
+  workers.reserve(workerCount);
+  for (uint32_t i = 0; i < workerCount; i++) {
+    workers.emplace_back([this, i]() { workerLoop(i + 1); });
+  }
+}
+
+LveThreadPool::~LveThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock{queueMutex};
+    stopping = true;
+  }
+  condition.notify_all();
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
+
+uint32_t LveThreadPool::currentThreadIndex() { return tlsThreadIndex; }
+
+void LveThreadPool::workerLoop(uint32_t threadIndex) {
+  tlsThreadIndex = threadIndex;
+  LVE_PROFILE_THREAD("worker " + std::to_string(threadIndex));
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock{queueMutex};
+      condition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+      // drain remaining tasks before exit so no future is left broken.
+      if (stopping && tasks.empty()) {
+        return;
+      }
+      task = std::move(tasks.front());
+      tasks.pop();
+    }
+    task();
+  }
+}
+
+}  // namespace lve
@@ -0,0 +1,105 @@
+#pragma once
+
+// std
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace lve {
+
+// Fixed size worker pool. Every thread gets a stable index so per-thread
+// resources (e.g. command pools) can be looked up without locking.
+// index 0 is reserved for the thread that owns the pool (main thread),
+// workers use 1..getWorkerCount().
+class LveThreadPool {
+ public:
+  // parallelFor alignment of float arrays, chunk borders never share a cache
+  // line.
+  static constexpr size_t FLOATS_PER_CACHE_LINE = 16;
+
+  // workerCount 0 : hardware concurrency - 1 (main thread records too).
+  LveThreadPool(uint32_t workerCount = 0);
+  ~LveThreadPool();
+
+  LveThreadPool(const LveThreadPool &) = delete;
+  LveThreadPool &operator=(const LveThreadPool &) = delete;
+
+  template <typename F>
+  auto submit(F &&task) -> std::future<std::invoke_result_t<F>> {
+    using ReturnType = std::invoke_result_t<F>;
+    auto packagedTask = std::make_shared<std::packaged_task<ReturnType()>>(
+        std::forward<F>(task));
+    std::future<ReturnType> result = packagedTask->get_future();
+    {
+      std::lock_guard<std::mutex> lock{queueMutex};
+      tasks.emplace([packagedTask]() { (*packagedTask)(); });
+    }
+    condition.notify_one();
+    return result;
+  }
+
+  // splits [0, count) into at most getThreadCount() chunks of at least
+  // minChunk items, chunk sizes rounded up to a multiple of align.
+  // fn(chunk, first, chunkCount) runs chunk 0 on the calling thread while
+  // workers take the rest, returns after all of them. returns the number of
+  // chunks.
+  // NOTE: do not call from a worker, it would wait on its own queue.
+  template <typename F>
+  size_t parallelFor(size_t count, size_t minChunk, size_t align, F &&fn) {
+    if (count == 0) return 0;
+    minChunk = std::max<size_t>(minChunk, 1);
+    align = std::max<size_t>(align, 1);
+    size_t maxChunks = (count + minChunk - 1) / minChunk;
+    size_t chunkCount = std::min<size_t>(getThreadCount(), maxChunks);
+    size_t chunkSize = (count + chunkCount - 1) / chunkCount;
+    chunkSize = (chunkSize + align - 1) / align * align;
+    // rounding up may leave nothing for the last chunks.
+    chunkCount = (count + chunkSize - 1) / chunkSize;
+
+    std::vector<std::future<void>> futures;
+    futures.reserve(chunkCount - 1);
+    for (size_t chunk = 1; chunk < chunkCount; chunk++) {
+      size_t first = chunk * chunkSize;
+      size_t chunkItems = std::min(chunkSize, count - first);
+      futures.push_back(submit(
+          [&fn, chunk, first, chunkItems]() { fn(chunk, first, chunkItems); }));
+    }
+    // workers reference fn, wait for all of them before rethrowing.
+    try {
+      fn(size_t{0}, size_t{0}, std::min(chunkSize, count));
+    } catch (...) {
+      for (auto &future : futures) future.wait();
+      throw;
+    }
+    for (auto &future : futures) future.wait();
+    for (auto &future : futures) future.get();
+    return chunkCount;
+  }
+
+  uint32_t getWorkerCount() const {
+    return static_cast<uint32_t>(workers.size());
+  }
+  // workers + owner thread
+  uint32_t getThreadCount() const { return getWorkerCount() + 1; }
+
+  // index of the calling thread. 0 if not a worker of any pool.
+  static uint32_t currentThreadIndex();
+
+ private:
+  void workerLoop(uint32_t threadIndex);
+
+  std::vector<std::thread> workers;
+  std::queue<std::function<void()>> tasks;
+  std::mutex queueMutex;
+  std::condition_variable condition;
+  bool stopping = false;
+};
+}  // namespace lve
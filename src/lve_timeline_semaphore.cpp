@@ -0,0 +1,56 @@
+#include "lve_timeline_semaphore.hpp"
+
+// std
+#include <limits>
+#include <stdexcept>
+
+namespace lve {
+
+LveTimelineSemaphore::LveTimelineSemaphore(VkDevice device) : device{device} {
+  VkSemaphoreTypeCreateInfo typeInfo{};
+  typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+  typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+  typeInfo.initialValue = 0;
+
+  VkSemaphoreCreateInfo semaphoreInfo{};
+  semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+  semaphoreInfo.pNext = &typeInfo;
+
+  if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &semaphore) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to create timeline semaphore!");
+  }
+}
+
+LveTimelineSemaphore::~LveTimelineSemaphore() {
+  vkDestroySemaphore(device, semaphore, nullptr);
+}
+
+bool LveTimelineSemaphore::isComplete(uint64_t value) const {
+  if (value <= completedValue) return true;
+  return value <= getCompletedValue();
+}
+
+uint64_t LveTimelineSemaphore::getCompletedValue() const {
+  if (vkGetSemaphoreCounterValue(device, semaphore, &completedValue) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to get timeline semaphore value!");
+  }
+  return completedValue;
+}
+
+void LveTimelineSemaphore::wait(uint64_t value) const {
+  if (isComplete(value)) return;
+
+  VkSemaphoreWaitInfo waitInfo{};
+  waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+  waitInfo.semaphoreCount = 1;
+  waitInfo.pSemaphores = &semaphore;
+  waitInfo.pValues = &value;
+  if (vkWaitSemaphores(device, &waitInfo,
+                       std::numeric_limits<uint64_t>::max()) != VK_SUCCESS) {
+    throw std::runtime_error("failed to wait for timeline semaphore!");
+  }
+  completedValue = value;
+}
+}  // namespace lve
@@ -0,0 +1,38 @@
+#pragma once
+
+// libs
+#include <vulkan/vulkan.h>
+
+// std
+#include <cstdint>
+
+namespace lve {
+
+// Timeline semaphore (core 1.2) of one submission stream. every submit
+// signals the next value, so "has this work finished" is a single integer
+// compare instead of a fence per frame.
+class LveTimelineSemaphore {
+ public:
+  explicit LveTimelineSemaphore(VkDevice device);
+  ~LveTimelineSemaphore();
+
+  LveTimelineSemaphore(const LveTimelineSemaphore &) = delete;
+  LveTimelineSemaphore &operator=(const LveTimelineSemaphore &) = delete;
+
+  VkSemaphore getSemaphore() const { return semaphore; }
+  // value for the submit being prepared, increases by one per call.
+  uint64_t nextSignalValue() { return ++lastSubmittedValue; }
+  uint64_t getLastSubmittedValue() const { return lastSubmittedValue; }
+  // NOTE: queries the device only when the cached value is not enough.
+  bool isComplete(uint64_t value) const;
+  uint64_t getCompletedValue() const;
+  // blocks the host until value is reached. value 0 returns immediately.
+  void wait(uint64_t value) const;
+
+ private:
+  VkDevice device;
+  VkSemaphore semaphore = VK_NULL_HANDLE;
+  uint64_t lastSubmittedValue = 0;
+  mutable uint64_t completedValue = 0;
+};
+}  // namespace lve
@@ -4,12 +4,15 @@
 #include <stdexcept>
 
 namespace lve {
-LveWindow::LveWindow(int w, int h, std::string name)
-    : width{w}, height{h}, windowName{name} {
+LveWindow::LveWindow(int w, int h, std::string name, bool headless)
+    : width{w}, height{h}, headless{headless}, windowName{name} {
+  // NOTE: glfwInit fails on hosts without a display server.
+  if (headless) return;
   initWindow();
 }
 
 LveWindow::~LveWindow() {
+  if (headless) return;
   glfwDestroyWindow(window);
   glfwTerminate();
 }
@@ -26,6 +29,9 @@ void LveWindow::initWindow() {
 }
 void LveWindow::createWindowSurface(VkInstance instance,
                                     VkSurfaceKHR* surface) {
+  if (headless) {
+    throw std::runtime_error("headless window has no surface");
+  }
   if (glfwCreateWindowSurface(instance, window, nullptr, surface) !=
       VK_SUCCESS) {
     throw std::runtime_error("failed to create window surface");
@@ -9,13 +9,17 @@ namespace lve {
 
 class LveWindow {
  public:
-  LveWindow(int w, int h, std::string name);
+  // headless: no glfw window at all, extent stays fixed.
+  LveWindow(int w, int h, std::string name, bool headless = false);
   ~LveWindow();
 
   LveWindow(const LveWindow&) = delete;
   LveWindow& operator=(const LveWindow&) = delete;
 
-  bool shouldClose() { return glfwWindowShouldClose(window); }
+  bool shouldClose() {
+    return headless ? false : glfwWindowShouldClose(window);
+  }
+  bool isHeadless() const { return headless; }
 
   VkExtent2D getExtent() {
     return {static_cast<uint32_t>(width), static_cast<uint32_t>(height)};
@@ -34,9 +38,10 @@ class LveWindow {
   int width;
   int height;
   bool framebufferResized = false;
+  bool headless = false;
 
   std::string windowName;
-  GLFWwindow* window;
+  GLFWwindow* window = nullptr;
 };
 
 }  // namespace lve
\ No newline at end of file
@@ -1,4 +1,7 @@
 #include "first_app.hpp"
+#include "kc_bonus.hpp"
+#include "lve_cpu_profiler.hpp"
+#include "systems/cpu_particle_integrator.hpp"
 
 // std
 #include <cstdlib>
@@ -7,10 +10,35 @@
 
 int main(int argc, char *argv[]) {
   std::cout << argv[0] << std::endl;
+  LVE_PROFILE_THREAD("main");
 
-  lve::FirstApp app{};
+  lve::LveConfig config{};
   try {
+    config = lve::LveConfig::fromArgs(argc, argv);
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    lve::LveConfig::printUsage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  if (config.cpuParticleBenchmark) {
+    lve::LveThreadPool threadPool{};
+    bool isValid = tut::CpuParticleIntegrator::runBenchmark(
+        config.particleCapacity, 100, threadPool);
+    return isValid ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+  if (config.gravityBenchmarkBodies > 0) {
+    // NOTE: all pairs take seconds per step above 10k bodies, extrapolated.
+    lve::LveThreadPool threadPool{};
+    kc_bonus::GravityPhysicsSystem::runBenchmark(
+        config.gravityBenchmarkBodies, 10000, config.gravityTheta, threadPool);
+    return EXIT_SUCCESS;
+  }
+
+  try {
+    lve::FirstApp app{config};
     app.run();
+    if (app.hasFailedValidation()) return EXIT_FAILURE;
   } catch (const std::exception &e) {
     std::cerr << e.what() << std::endl;
     return EXIT_FAILURE;
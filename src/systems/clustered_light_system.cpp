@@ -0,0 +1,134 @@
+#include "clustered_light_system.hpp"
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <cassert>
+#include <cmath>
+#include <stdexcept>
+
+namespace lve {
+
+ClusteredLightSystem::ClusteredLightSystem(
+    LveDevice& device, const LveFrameContext& frameContext,
+    VkDescriptorSetLayout globalSetLayout,
+    LvePipelineCompiler& pipelineCompiler)
+    : lveDevice{device} {
+  createBuffers(frameContext.getFramesInFlight());
+  createPipelineLayout(globalSetLayout);
+  createPipeline(pipelineCompiler);
+}
+ClusteredLightSystem::~ClusteredLightSystem() {
+  // NOTE: pipeline first, async build may still use the layout.
+  lvePipeline.reset();
+  vkDestroyPipelineLayout(lveDevice.device(), pipelineLayout, nullptr);
+}
+
+void ClusteredLightSystem::createBuffers(uint32_t framesInFlight) {
+  lightBuffers.resize(framesInFlight);
+  for (int i = 0; i < lightBuffers.size(); i++) {
+    // written by cpu every frame. need to flush since non-coherent
+    lightBuffers[i] = std::make_unique<LveBuffer>(
+        lveDevice, sizeof(PointLight), MAX_LIGHTS,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+    lightBuffers[i]->map();
+  }
+}
+
+void ClusteredLightSystem::addClusterPass(LveRenderGraph& graph,
+                                          LveRenderGraph::ResourceId globalUbo,
+                                          LveRenderGraph::ResourceId lights) {
+  // only touched by gpu (compute write -> fragment read)
+  clusterGrid = graph.createTransientBuffer(
+      "cluster_grid", sizeof(uint32_t) * CLUSTER_COUNT,
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+  clusterIndex = graph.createTransientBuffer(
+      "cluster_index",
+      sizeof(uint32_t) * CLUSTER_COUNT * MAX_LIGHTS_PER_CLUSTER,
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+
+  // NOTE: dispatch must be outside of the render pass.
+  graph.addPass(
+      "cluster_lights",
+      [&](LveRenderGraph::PassBuilder& pass) {
+        pass.read(globalUbo, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                  VK_ACCESS_UNIFORM_READ_BIT)
+            .read(lights, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                  VK_ACCESS_SHADER_READ_BIT)
+            .write(clusterGrid, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                   VK_ACCESS_SHADER_WRITE_BIT)
+            .write(clusterIndex, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                   VK_ACCESS_SHADER_WRITE_BIT);
+      },
+      [this](FrameInfo& frameInfo) { computeClusters(frameInfo); });
+}
+
+void ClusteredLightSystem::createPipelineLayout(
+    VkDescriptorSetLayout globalSetLayout) {
+  // NOTE: shares the global set with the graphics pipelines,
+  // so the fragment shader reads the same cluster buffers.
+  std::vector<VkDescriptorSetLayout> descriptorSetLayouts{globalSetLayout};
+
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutInfo.setLayoutCount =
+      static_cast<uint32_t>(descriptorSetLayouts.size());
+  pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
+  if (vkCreatePipelineLayout(lveDevice.device(), &pipelineLayoutInfo, nullptr,
+                             &pipelineLayout) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create cluster pipeline layout!");
+  }
+}
+
+void ClusteredLightSystem::createPipeline(
+    LvePipelineCompiler& pipelineCompiler) {
+  assert(pipelineLayout != nullptr &&
+         "Cannot create pipeline before pipeline layout.");
+
+  auto pipelineConfig = std::make_shared<PipelineConfigInfo>();
+  pipelineConfig->pipelineLayout = pipelineLayout;
+  // id 0: local_size_x, id 1: MAX_LIGHTS_PER_CLUSTER
+  pipelineConfig->specialization.add(0, WORKGROUP_SIZE)
+      .add(1, MAX_LIGHTS_PER_CLUSTER);
+
+  lvePipeline = pipelineCompiler.createComputePipeline(
+      "./shaders/cluster_light.comp.spv", pipelineConfig);
+}
+
+void ClusteredLightSystem::updateUbo(GlobalUbo& ubo, const LveCamera& camera,
+                                     VkExtent2D extent) {
+  float near = camera.getNear();
+  float far = camera.getFar();
+  // exponential slices: slice = log(z) * scale - bias
+  float logDepthRange = std::log(far / near);
+  float sliceScale = static_cast<float>(CLUSTER_Z) / logDepthRange;
+  float sliceBias =
+      static_cast<float>(CLUSTER_Z) * std::log(near) / logDepthRange;
+
+  ubo.clusterCounts.x = CLUSTER_X;
+  ubo.clusterCounts.y = CLUSTER_Y;
+  ubo.clusterCounts.z = CLUSTER_Z;
+  ubo.clusterDepthParams = {near, far, sliceScale, sliceBias};
+  ubo.screenSize = {static_cast<float>(extent.width),
+                    static_cast<float>(extent.height),
+                    1.f / static_cast<float>(extent.width),
+                    1.f / static_cast<float>(extent.height)};
+}
+
+void ClusteredLightSystem::computeClusters(FrameInfo& frameInfo) {
+  lvePipeline->bind(frameInfo.commandBuffer);
+
+  vkCmdBindDescriptorSets(frameInfo.commandBuffer,
+                          VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1,
+                          &frameInfo.globalDescriptorSet, 0, nullptr);
+  // one invocation per cluster
+  vkCmdDispatch(frameInfo.commandBuffer,
+                (CLUSTER_COUNT + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+  // NOTE: the barrier to the fragment readers comes from the render graph.
+}
+
+}  // namespace lve
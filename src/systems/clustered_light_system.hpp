@@ -0,0 +1,74 @@
+#pragma once
+
+#include "lve_buffer.hpp"
+#include "lve_camera.hpp"
+#include "lve_device.hpp"
+#include "lve_frame_context.hpp"
+#include "lve_frame_info.hpp"
+#include "lve_pipeline.hpp"
+#include "lve_pipeline_compiler.hpp"
+#include "lve_render_graph.hpp"
+
+// std
+#include <memory>
+#include <vector>
+
+namespace lve {
+
+// Clustered forward lighting.
+// lights live in a storage buffer and a compute pass bins them into a view
+// space cluster grid (screen tiles x exponential depth slices), so each
+// fragment only iterates the lights of its own cluster.
+class ClusteredLightSystem {
+ public:
+  static constexpr uint32_t CLUSTER_X = 16;
+  static constexpr uint32_t CLUSTER_Y = 9;
+  static constexpr uint32_t CLUSTER_Z = 24;
+  static constexpr uint32_t CLUSTER_COUNT = CLUSTER_X * CLUSTER_Y * CLUSTER_Z;
+  static constexpr uint32_t MAX_LIGHTS = 4096;
+  // NOTE: passed to the shaders as specialization constants.
+  static constexpr uint32_t MAX_LIGHTS_PER_CLUSTER = 128;
+  static constexpr uint32_t WORKGROUP_SIZE = 128;
+
+  ClusteredLightSystem(LveDevice &device, const LveFrameContext &frameContext,
+                       VkDescriptorSetLayout globalSetLayout,
+                       LvePipelineCompiler &pipelineCompiler);
+  ~ClusteredLightSystem();
+
+  ClusteredLightSystem(const ClusteredLightSystem &) = delete;
+  ClusteredLightSystem &operator=(const ClusteredLightSystem &) = delete;
+
+  // fill cluster grid params of the global ubo.
+  void updateUbo(GlobalUbo &ubo, const LveCamera &camera, VkExtent2D extent);
+  // declares the light binning pass and its transient cluster buffers.
+  // readers of the cluster lists declare reads of getClusterGrid/Index().
+  void addClusterPass(LveRenderGraph &graph,
+                      LveRenderGraph::ResourceId globalUbo,
+                      LveRenderGraph::ResourceId lights);
+
+  LveBuffer &getLightBuffer(int frameIndex) { return *lightBuffers[frameIndex]; }
+  VkDescriptorBufferInfo lightBufferInfo(int frameIndex) {
+    return lightBuffers[frameIndex]->descriptorInfo();
+  }
+  LveRenderGraph::ResourceId getClusterGrid() const { return clusterGrid; }
+  LveRenderGraph::ResourceId getClusterIndex() const { return clusterIndex; }
+
+ private:
+  void computeClusters(FrameInfo &frameInfo);
+  void createBuffers(uint32_t framesInFlight);
+  void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
+  void createPipeline(LvePipelineCompiler &pipelineCompiler);
+
+  LveDevice &lveDevice;
+
+  std::unique_ptr<LvePipeline> lvePipeline;
+  VkPipelineLayout pipelineLayout;
+
+  // per frame in flight
+  std::vector<std::unique_ptr<LveBuffer>> lightBuffers;
+  // graph transients. light count per cluster
+  LveRenderGraph::ResourceId clusterGrid = 0;
+  // MAX_LIGHTS_PER_CLUSTER light indices per cluster
+  LveRenderGraph::ResourceId clusterIndex = 0;
+};
+}  // namespace lve
@@ -1,7 +1,7 @@
 #include "compute_particle_system.hpp"
 
 #include "lve_buffer.hpp"
-#include "lve_swap_chain.hpp"
+#include "lve_gpu_profiler.hpp"
 
 // libs
 #define GLM_FORCE_RADIANS
@@ -9,67 +9,166 @@
 #include <glm/glm.hpp>
 
 // std
-#include <iostream>
-#include <random>
+#include <algorithm>
+#include <array>
+#include <cassert>
 #include <stdexcept>
 #include <vector>
 
 namespace tut {
 
 std::vector<VkVertexInputBindingDescription>
-Particle::getBindingDescriptions() {
-  std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
+ParticleVertex::getBindingDescriptions() {
+  std::vector<VkVertexInputBindingDescription> bindingDescriptions(2);
   bindingDescriptions[0].binding = 0;
-  bindingDescriptions[0].stride = sizeof(Particle);
+  bindingDescriptions[0].stride = sizeof(glm::vec2);
   bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+  bindingDescriptions[1].binding = 1;
+  bindingDescriptions[1].stride = sizeof(uint32_t);
+  bindingDescriptions[1].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
   return bindingDescriptions;
 }
 
 std::vector<VkVertexInputAttributeDescription>
-Particle::getAttributeDescriptions() {
+ParticleVertex::getAttributeDescriptions() {
   std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
 
   attributeDescriptions.push_back({
-      0,                             // location
-      0,                             // binding
-      VK_FORMAT_R32G32_SFLOAT,       // format
-      offsetof(Particle, position),  // offset
+      0,                        // location
+      0,                        // binding
+      VK_FORMAT_R32G32_SFLOAT,  // format
+      0,                        // offset
   });
 
   attributeDescriptions.push_back({
-      1,                              // location
-      0,                              // binding
-      VK_FORMAT_R32G32B32A32_SFLOAT,  // format
-      offsetof(Particle, color),      // offset
+      1,                         // location
+      1,                         // binding
+      VK_FORMAT_R8G8B8A8_UNORM,  // format
+      0,                         // offset
   });
 
   return attributeDescriptions;
 }
 
-ComputeParticleSystem::ComputeParticleSystem(lve::LveDevice& device,
-                                             VkRenderPass renderPass,
-                                             lve::LveDescriptorPool& pool)
-    : lveDevice{device} {
+ComputeParticleSystem::ComputeParticleSystem(
+    lve::LveDevice& device, const lve::LveFrameContext& frameContext,
+    VkRenderPass renderPass, lve::LveDescriptorPool& pool,
+    lve::LvePipelineCompiler& pipelineCompiler, uint32_t capacity)
+    : lveDevice{device}, frameContext{frameContext}, capacity{capacity} {
+  // NOTE: the simulate dispatch covers the whole pool in the worst case.
+  uint64_t maxCapacity =
+      static_cast<uint64_t>(WORKGROUP_SIZE) *
+      lveDevice.properties.limits.maxComputeWorkGroupCount[0];
+  if (capacity == 0 || capacity > maxCapacity) {
+    throw std::runtime_error("particle capacity out of range!");
+  }
+
+  auto queueFamilies = lveDevice.findPhysicalQueueFamilies();
+  graphicsFamily = queueFamilies.graphicsAndComputeFamily.value();
+  computeFamily = queueFamilies.computeFamily.value();
+
   createUniformBuffers();
-  createShaderStorageBuffers();
+  createPoolBuffers();
+  createVertexBuffers();
 
   createGraphicsDescriptorSetLayout();
   createGraphicsDescriptorSets(pool);
   createGraphicsPipelineLayout();
-  createGraphicsPipeline(renderPass);
+  createGraphicsPipeline(renderPass, pipelineCompiler);
 
   createComputeDescriptorSetLayout();
   createComputeDescriptorSets(pool);
   createComputePipelineLayout();
-  createComputePipeline();
+  createComputePipelines(pipelineCompiler);
 }
 ComputeParticleSystem::~ComputeParticleSystem() {
+  // NOTE: pipelines first, async builds may still use the layouts.
+  lveGraphicsPipeline.reset();
+  lveKickoffPipeline.reset();
+  lveEmitPipeline.reset();
+  lveSimulatePipeline.reset();
   vkDestroyPipelineLayout(lveDevice.device(), graphicsPipelineLayout, nullptr);
   vkDestroyPipelineLayout(lveDevice.device(), computePipelineLayout, nullptr);
 }
 
+ComputeParticleSystem::EmitterId ComputeParticleSystem::addEmitter(
+    const ParticleEmitter& emitter) {
+  if (emitters.size() >= MAX_EMITTERS) {
+    throw std::runtime_error("too many particle emitters!");
+  }
+  emitters.push_back(EmitterState{emitter});
+  return static_cast<EmitterId>(emitters.size() - 1);
+}
+
+ParticleEmitter& ComputeParticleSystem::getEmitter(EmitterId id) {
+  assert(id < emitters.size() && "Invalid emitter id.");
+  return emitters[id].emitter;
+}
+
+void ComputeParticleSystem::burst(EmitterId id, uint32_t count) {
+  assert(id < emitters.size() && "Invalid emitter id.");
+  emitters[id].pendingBurst += count;
+}
+
+void ComputeParticleSystem::readbackPool(ParticleSoa& particles) {
+  lve::LveBuffer* sources[] = {positionBuffer.get(), velocityBuffer.get(),
+                               constantBuffer.get()};
+  std::vector<std::unique_ptr<lve::LveBuffer>> stagingBuffers;
+  VkCommandBuffer commandBuffer = lveDevice.beginSingleTimeComputeCommands();
+  VkMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0,
+                       nullptr, 0, nullptr);
+  for (auto source : sources) {
+    auto staging = std::make_unique<lve::LveBuffer>(
+        lveDevice, source->getInstanceSize(), capacity,
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    VkBufferCopy copyRegion{};
+    copyRegion.size = source->getBufferSize();
+    vkCmdCopyBuffer(commandBuffer, source->getBuffer(), staging->getBuffer(),
+                    1, &copyRegion);
+    stagingBuffers.push_back(std::move(staging));
+  }
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr,
+                       0, nullptr);
+  lveDevice.endSingleTimeComputeCommands(commandBuffer);
+
+  for (auto& staging : stagingBuffers) {
+    staging->map();
+  }
+  auto positions =
+      static_cast<const glm::vec2*>(stagingBuffers[0]->getMappedMemory());
+  auto velocities =
+      static_cast<const glm::vec2*>(stagingBuffers[1]->getMappedMemory());
+  auto constants = static_cast<const ParticleConstants*>(
+      stagingBuffers[2]->getMappedMemory());
+  particles.resize(capacity);
+  for (uint32_t i = 0; i < capacity; i++) {
+    particles.positionX[i] = positions[i].x;
+    particles.positionY[i] = positions[i].y;
+    particles.velocityX[i] = velocities[i].x;
+    particles.velocityY[i] = velocities[i].y;
+    // NOTE: never emitted slots hold garbage, clamp the emitter index.
+    uint32_t emitter = constants[i].emitter;
+    glm::vec2 acceleration{0.f};
+    if (emitter < emitters.size()) {
+      acceleration = emitters[emitter].emitter.acceleration;
+    }
+    particles.accelerationX[i] = acceleration.x;
+    particles.accelerationY[i] = acceleration.y;
+  }
+}
+
 void ComputeParticleSystem::createUniformBuffers() {
-  uniformBuffers.resize(lve::LveSwapChain::MAX_FRAMES_IN_FLIGHT);
+  uniformBuffers.resize(frameContext.getFramesInFlight());
   for (int i = 0; i < uniformBuffers.size(); i++) {
     // NOTE: need to flush since non-coherent
     uniformBuffers[i] = std::make_unique<lve::LveBuffer>(
@@ -79,59 +178,108 @@ void ComputeParticleSystem::createUniformBuffers() {
   }
 }
 
-void ComputeParticleSystem::createShaderStorageBuffers() {
-  // initial particle data
-  std::default_random_engine randomEngine;
-  randomEngine.seed(1111);
-  std::uniform_real_distribution<float> randomDist(0.f, 1.f);
-
-  std::vector<Particle> particles(PARTICLE_COUNT);
-  for (auto& particle : particles) {
-    float r = 0.10f + 0.05f * randomDist(randomEngine);
-    float theta = glm::two_pi<float>() * randomDist(randomEngine);
-    float x = r * cos(theta);
-    float y = r * sin(theta);
-    particle.position = glm::vec2(x, y);
-    particle.velocity = glm::normalize(glm::vec2(x, y)) * 0.50f;
-    // particle.color =
-    //     glm::vec4(randomDist(randomEngine), randomDist(randomEngine),
-    //               randomDist(randomEngine), 1.f);
-    float rgb[3] = {
-        (1.f + glm::cos(theta)) / 2.0f,
-        (1.f + glm::cos(theta + 2.0f / 3.0f * glm::pi<float>())) / 2.0f,
-        (1.f + glm::cos(theta + 4.0f / 3.0f * glm::pi<float>())) / 2.0f};
-
-    particle.color = glm::vec4(rgb[0], rgb[1], rgb[2], 1.0f);
-
-    particle.acceleration = glm::vec2(0.f, 0.2f);
+void ComputeParticleSystem::createPoolBuffers() {
+  // every slot starts dead, particles only exist after being emitted.
+  std::vector<uint32_t> deadIndices(capacity);
+  for (uint32_t i = 0; i < capacity; i++) {
+    deadIndices[i] = i;
   }
+  ParticleCounters counters{};
+  counters.emitDispatch = {0, 1, 1};
+  counters.simulateDispatch = {0, 1, 1};
+  counters.deadCount = capacity;
 
   // transfer using staging buffer
-  VkDeviceSize bufferSize = sizeof(Particle) * PARTICLE_COUNT;
-  uint32_t particleSize = sizeof(Particle);
-  lve::LveBuffer stagingBuffer{
+  lve::LveBuffer deadListStaging{
       lveDevice,
-      particleSize,
-      PARTICLE_COUNT,
+      sizeof(uint32_t),
+      capacity,
       VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
           VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
   };
-
-  stagingBuffer.map();
-  stagingBuffer.writeToBuffer((void*)particles.data());
+  deadListStaging.map();
+  deadListStaging.writeToBuffer((void*)deadIndices.data());
+  lve::LveBuffer counterStaging{
+      lveDevice,
+      sizeof(ParticleCounters),
+      1,
+      VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+  };
+  counterStaging.map();
+  counterStaging.writeToBuffer(&counters);
+
+  positionBuffer = std::make_unique<lve::LveBuffer>(
+      lveDevice, sizeof(glm::vec2), capacity,
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  velocityBuffer = std::make_unique<lve::LveBuffer>(
+      lveDevice, sizeof(glm::vec2), capacity,
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  constantBuffer = std::make_unique<lve::LveBuffer>(
+      lveDevice, sizeof(ParticleConstants), capacity,
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  deadListBuffer = std::make_unique<lve::LveBuffer>(
+      lveDevice, sizeof(uint32_t), capacity,
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  aliveListBuffer = std::make_unique<lve::LveBuffer>(
+      lveDevice, sizeof(uint32_t), capacity * 2,
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  counterBuffer = std::make_unique<lve::LveBuffer>(
+      lveDevice, sizeof(ParticleCounters), 1,
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+          VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
   // copy buffer
-  shaderStorageBuffers.resize(lve::LveSwapChain::MAX_FRAMES_IN_FLIGHT);
-  for (int i = 0; i < shaderStorageBuffers.size(); i++) {
-    shaderStorageBuffers[i] = std::make_unique<lve::LveBuffer>(
-        lveDevice, particleSize, PARTICLE_COUNT,
-        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
-            VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+  // NOTE: on the compute queue, the buffers are owned by the compute family.
+  VkCommandBuffer commandBuffer = lveDevice.beginSingleTimeComputeCommands();
+  VkBufferCopy copyRegion{};
+  copyRegion.size = deadListStaging.getBufferSize();
+  vkCmdCopyBuffer(commandBuffer, deadListStaging.getBuffer(),
+                  deadListBuffer->getBuffer(), 1, &copyRegion);
+  copyRegion.size = counterStaging.getBufferSize();
+  vkCmdCopyBuffer(commandBuffer, counterStaging.getBuffer(),
+                  counterBuffer->getBuffer(), 1, &copyRegion);
+  lveDevice.endSingleTimeComputeCommands(commandBuffer);
+}
+
+void ComputeParticleSystem::createVertexBuffers() {
+  uint32_t framesInFlight = frameContext.getFramesInFlight();
+  vertexPositionBuffers.resize(framesInFlight);
+  vertexColorBuffers.resize(framesInFlight);
+  drawBuffers.resize(framesInFlight);
+  readbackBuffers.resize(framesInFlight);
+  VkCommandBuffer commandBuffer = lveDevice.beginSingleTimeComputeCommands();
+  for (int i = 0; i < framesInFlight; i++) {
+    vertexPositionBuffers[i] = std::make_unique<lve::LveBuffer>(
+        lveDevice, sizeof(glm::vec2), capacity,
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    vertexColorBuffers[i] = std::make_unique<lve::LveBuffer>(
+        lveDevice, sizeof(uint32_t), capacity,
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    drawBuffers[i] = std::make_unique<lve::LveBuffer>(
+        lveDevice, sizeof(VkDrawIndirectCommand), 1,
+        VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-    lveDevice.copyBuffer(stagingBuffer.getBuffer(),
-                         shaderStorageBuffers[i]->getBuffer(), bufferSize);
+    // draws nothing until the first simulation of the frame.
+    vkCmdFillBuffer(commandBuffer, drawBuffers[i]->getBuffer(), 0,
+                    VK_WHOLE_SIZE, 0);
+    readbackBuffers[i] = std::make_unique<lve::LveBuffer>(
+        lveDevice, sizeof(uint32_t), 1, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    readbackBuffers[i]->map();
+    vkCmdFillBuffer(commandBuffer, readbackBuffers[i]->getBuffer(), 0,
+                    VK_WHOLE_SIZE, 0);
   }
+  lveDevice.endSingleTimeComputeCommands(commandBuffer);
 }
 
 void ComputeParticleSystem::createGraphicsDescriptorSetLayout() {
@@ -143,20 +291,21 @@ void ComputeParticleSystem::createGraphicsDescriptorSetLayout() {
 }
 
 void ComputeParticleSystem::createComputeDescriptorSetLayout() {
-  computeDescriptorSetLayout =
-      lve::LveDescriptorSetLayout::Builder(lveDevice)
-          .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-                      VK_SHADER_STAGE_COMPUTE_BIT)
-          .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
-                      VK_SHADER_STAGE_COMPUTE_BIT)
-          .addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
-                      VK_SHADER_STAGE_COMPUTE_BIT)
-          .build();
+  // ubo, positions, velocities, constants, dead list, alive lists, counters,
+  // vertex positions, vertex colors, draw args
+  auto builder = lve::LveDescriptorSetLayout::Builder(lveDevice);
+  builder.addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                     VK_SHADER_STAGE_COMPUTE_BIT);
+  for (uint32_t binding = 1; binding <= 9; binding++) {
+    builder.addBinding(binding, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                       VK_SHADER_STAGE_COMPUTE_BIT);
+  }
+  computeDescriptorSetLayout = builder.build();
 }
 
 void ComputeParticleSystem::createGraphicsDescriptorSets(
     lve::LveDescriptorPool& pool) {
-  graphicsDescriptorSets.resize(lve::LveSwapChain::MAX_FRAMES_IN_FLIGHT);
+  graphicsDescriptorSets.resize(frameContext.getFramesInFlight());
   for (int i = 0; i < graphicsDescriptorSets.size(); i++) {
     auto bufferInfo = uniformBuffers[i]->descriptorInfo();
     lve::LveDescriptorWriter(*graphicsDescriptorSetLayout, pool)
@@ -170,19 +319,31 @@ void ComputeParticleSystem::createComputeDescriptorSets(
   // allocate descriptor sets를 한번에 여러개 가능한데 일단 기본 구조대로
   // 하나씩.
   // https://github.com/Overv/VulkanTutorial/blob/main/code/31_compute_shader.cpp#L862
-  computeDescriptorSets.resize(lve::LveSwapChain::MAX_FRAMES_IN_FLIGHT);
+  auto positionInfo = positionBuffer->descriptorInfo();
+  auto velocityInfo = velocityBuffer->descriptorInfo();
+  auto constantInfo = constantBuffer->descriptorInfo();
+  auto deadListInfo = deadListBuffer->descriptorInfo();
+  auto aliveListInfo = aliveListBuffer->descriptorInfo();
+  auto counterInfo = counterBuffer->descriptorInfo();
+  computeDescriptorSets.resize(frameContext.getFramesInFlight());
   for (int i = 0; i < computeDescriptorSets.size(); i++) {
+    // NOTE: the pool is shared by all frames, the dispatches of consecutive
+    // compute frames are ordered by the barrier in computeParticles.
     auto uniformBufferInfo = uniformBuffers[i]->descriptorInfo();
-    int prevFrameIdx = (i - 1 + lve::LveSwapChain::MAX_FRAMES_IN_FLIGHT) %
-                       lve::LveSwapChain::MAX_FRAMES_IN_FLIGHT;
-    auto storageBufferInfoLastFrame =
-        shaderStorageBuffers[prevFrameIdx]->descriptorInfo();
-    auto storageBufferInfoCurrentFrame =
-        shaderStorageBuffers[i]->descriptorInfo();
+    auto vertexPositionInfo = vertexPositionBuffers[i]->descriptorInfo();
+    auto vertexColorInfo = vertexColorBuffers[i]->descriptorInfo();
+    auto drawInfo = drawBuffers[i]->descriptorInfo();
     lve::LveDescriptorWriter(*computeDescriptorSetLayout, pool)
         .writeBuffer(0, &uniformBufferInfo)
-        .writeBuffer(1, &storageBufferInfoLastFrame)
-        .writeBuffer(2, &storageBufferInfoCurrentFrame)
+        .writeBuffer(1, &positionInfo)
+        .writeBuffer(2, &velocityInfo)
+        .writeBuffer(3, &constantInfo)
+        .writeBuffer(4, &deadListInfo)
+        .writeBuffer(5, &aliveListInfo)
+        .writeBuffer(6, &counterInfo)
+        .writeBuffer(7, &vertexPositionInfo)
+        .writeBuffer(8, &vertexColorInfo)
+        .writeBuffer(9, &drawInfo)
         .build(computeDescriptorSets[i]);
   }
 }
@@ -219,84 +380,257 @@ void ComputeParticleSystem::createComputePipelineLayout() {
   }
 }
 
-void ComputeParticleSystem::createGraphicsPipeline(VkRenderPass renderPass) {
+void ComputeParticleSystem::createGraphicsPipeline(
+    VkRenderPass renderPass, lve::LvePipelineCompiler& pipelineCompiler) {
   assert(graphicsPipelineLayout != nullptr &&
          "Cannot create pipeline before pipeline layout.");
 
-  lve::PipelineConfigInfo pipelineConfig{};
-  lve::LvePipeline::defaultPipelineConfigInfo(pipelineConfig);
+  auto pipelineConfig = std::make_shared<lve::PipelineConfigInfo>();
+  lve::LvePipeline::defaultPipelineConfigInfo(*pipelineConfig);
   // NOTE: src alpha blender factor
-  lve::LvePipeline::enableAlphaBlending(pipelineConfig);
+  lve::LvePipeline::enableAlphaBlending(*pipelineConfig);
   // dst factor zero -> discard existing alpha
   // TODO: fix circle overlay alpha problem
 
-  pipelineConfig.colorBlendAttachment.srcAlphaBlendFactor =
+  pipelineConfig->colorBlendAttachment.srcAlphaBlendFactor =
       VK_BLEND_FACTOR_SRC_ALPHA;
-  pipelineConfig.colorBlendAttachment.dstAlphaBlendFactor =
+  pipelineConfig->colorBlendAttachment.dstAlphaBlendFactor =
       VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
   // NOTE: depthTest makes occlusion?
-  pipelineConfig.depthStencilInfo.depthTestEnable = VK_FALSE;
+  pipelineConfig->depthStencilInfo.depthTestEnable = VK_FALSE;
 
-  pipelineConfig.attributeDescriptions.clear();
-  pipelineConfig.bindingDescriptions.clear();
+  pipelineConfig->attributeDescriptions.clear();
+  pipelineConfig->bindingDescriptions.clear();
 
-  pipelineConfig.renderPass = renderPass;
-  pipelineConfig.pipelineLayout = graphicsPipelineLayout;
-  pipelineConfig.multisampleInfo.rasterizationSamples =
+  pipelineConfig->renderPass = renderPass;
+  pipelineConfig->pipelineLayout = graphicsPipelineLayout;
+  pipelineConfig->multisampleInfo.rasterizationSamples =
       lveDevice.getSampleCount();
   // particle binding, attribute
-  pipelineConfig.inputAssemblyInfo.topology = VK_PRIMITIVE_TOPOLOGY_POINT_LIST;
+  pipelineConfig->inputAssemblyInfo.topology = VK_PRIMITIVE_TOPOLOGY_POINT_LIST;
 
-  pipelineConfig.bindingDescriptions = Particle::getBindingDescriptions();
-  pipelineConfig.attributeDescriptions = Particle::getAttributeDescriptions();
+  pipelineConfig->bindingDescriptions =
+      ParticleVertex::getBindingDescriptions();
+  pipelineConfig->attributeDescriptions =
+      ParticleVertex::getAttributeDescriptions();
 
-  lveGraphicsPipeline = std::make_unique<lve::LvePipeline>(lveDevice);
-  lveGraphicsPipeline->createGraphicsPipeline(
+  lveGraphicsPipeline = pipelineCompiler.createGraphicsPipeline(
       "./shaders/compute_particle.vert.spv",
       "./shaders/compute_particle.frag.spv", pipelineConfig);
 }
 
-void ComputeParticleSystem::createComputePipeline() {
+void ComputeParticleSystem::createComputePipelines(
+    lve::LvePipelineCompiler& pipelineCompiler) {
   assert(computePipelineLayout != nullptr &&
          "Cannot create pipeline before pipeline layout.");
 
-  lve::PipelineConfigInfo pipelineConfig{};
-  pipelineConfig.pipelineLayout = computePipelineLayout;
+  auto pipelineConfig = std::make_shared<lve::PipelineConfigInfo>();
+  pipelineConfig->pipelineLayout = computePipelineLayout;
+  pipelineConfig->specialization.add(0, WORKGROUP_SIZE);
 
-  lveComputePipeline = std::make_unique<lve::LvePipeline>(lveDevice);
-  lveComputePipeline->createComputePipeline(
+  lveKickoffPipeline = pipelineCompiler.createComputePipeline(
+      "./shaders/compute_particle_kickoff.comp.spv", pipelineConfig);
+  lveEmitPipeline = pipelineCompiler.createComputePipeline(
+      "./shaders/compute_particle_emit.comp.spv", pipelineConfig);
+  lveSimulatePipeline = pipelineCompiler.createComputePipeline(
       "./shaders/compute_particle.comp.spv", pipelineConfig);
 }
-// TODO: compute command buffer and dispatch part
+
 void ComputeParticleSystem::updateUbo(lve::FrameInfo& frameInfo) {
   ParticleUbo ubo{};
-  ubo.deltaTime = frameInfo.frameTime;
+  ubo.deltaTime = frameInfo.tickTime;
+  ubo.tickCount = frameInfo.tickCount;
+  ubo.capacity = capacity;
+  ubo.currentList = computeFrameCount % 2;
+  ubo.seed = computeFrameCount;
+  computeFrameCount++;
+  lastTickTime = frameInfo.tickTime;
+  lastTickCount = frameInfo.tickCount;
+  simulationTime += frameInfo.frameTime;
+  ubo.time = simulationTime;
+  // the compute slot of the frame was waited on, its copy is complete.
+  liveCount = *static_cast<uint32_t*>(
+      readbackBuffers[frameInfo.frameIndex]->getMappedMemory());
+
+  // rates are accumulated, fractions are spawned on a later frame.
+  uint32_t spawnCount = 0;
+  for (auto& state : emitters) {
+    const ParticleEmitter& emitter = state.emitter;
+    uint32_t count = 0;
+    if (emitter.enabled) {
+      state.accumulator += emitter.rate * frameInfo.frameTime;
+      // NOTE: keep a stalled frame from spawning more than the pool.
+      state.accumulator = std::min(state.accumulator,
+                                   static_cast<float>(capacity));
+      count = static_cast<uint32_t>(state.accumulator);
+      state.accumulator -= static_cast<float>(count);
+      count += state.pendingBurst;
+    }
+    // NOTE: disabled emitters drop their bursts.
+    state.pendingBurst = 0;
+    count = std::min(count, capacity - spawnCount);
+
+    ParticleEmitterUbo& emitterUbo = ubo.emitters[ubo.emitterCount++];
+    emitterUbo.positionRadius = glm::vec4(emitter.position, emitter.minRadius,
+                                          emitter.maxRadius);
+    emitterUbo.motion = glm::vec4(emitter.speed, emitter.speedVariance,
+                                  emitter.direction, emitter.spread);
+    emitterUbo.lifeAcceleration =
+        glm::vec4(emitter.lifetime, emitter.lifetimeVariance,
+                  emitter.acceleration);
+    emitterUbo.color = emitter.color;
+    emitterUbo.spawnRange = glm::uvec4(spawnCount, count, 0, 0);
+    spawnCount += count;
+  }
+  ubo.spawnCount = spawnCount;
 
   uniformBuffers[frameInfo.frameIndex]->writeToBuffer(&ubo);
   uniformBuffers[frameInfo.frameIndex]->flush();
 }
 
 void ComputeParticleSystem::computeParticles(lve::FrameInfo& frameInfo) {
-  lveComputePipeline->bind(frameInfo.commandBuffer);
-
-  vkCmdBindDescriptorSets(frameInfo.commandBuffer,
-                          VK_PIPELINE_BIND_POINT_COMPUTE, computePipelineLayout,
-                          0, 1, &computeDescriptorSets[frameInfo.frameIndex], 0,
+  lve::LveGpuProfiler::Scope profileScope{frameInfo, "particles_compute"};
+  VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                          computePipelineLayout, 0, 1,
+                          &computeDescriptorSets[frameInfo.frameIndex], 0,
                           nullptr);
-  vkCmdDispatch(frameInfo.commandBuffer, PARTICLE_COUNT / 256, 1, 1);
+
+  // the pool is shared across frames, wait for the previous simulation
+  // (same queue, earlier submissions are in the first scope).
+  VkMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  barrier.dstAccessMask =
+      VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  vkCmdPipelineBarrier(commandBuffer,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT |
+                           VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0,
+                       nullptr, 0, nullptr);
+  lveKickoffPipeline->bind(commandBuffer);
+  vkCmdDispatch(commandBuffer, 1, 1, 1);
+
+  // dispatch sizes and counters of the kickoff.
+  barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT |
+                          VK_ACCESS_SHADER_READ_BIT |
+                          VK_ACCESS_SHADER_WRITE_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT |
+                           VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       0, 1, &barrier, 0, nullptr, 0, nullptr);
+  lveEmitPipeline->bind(commandBuffer);
+  vkCmdDispatchIndirect(commandBuffer, counterBuffer->getBuffer(),
+                        offsetof(ParticleCounters, emitDispatch));
+
+  // emitted particles are simulated in the same frame.
+  barrier.dstAccessMask =
+      VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0,
+                       nullptr, 0, nullptr);
+  {
+    lve::LveGpuProfiler::Scope simulateScope{frameInfo, "particles_simulate"};
+    lveSimulatePipeline->bind(commandBuffer);
+    vkCmdDispatchIndirect(commandBuffer, counterBuffer->getBuffer(),
+                          offsetof(ParticleCounters, simulateDispatch));
+  }
+
+  recordLiveCountReadback(commandBuffer, frameInfo.frameIndex);
+  recordOwnershipTransfer(commandBuffer, frameInfo.frameIndex, true);
+}
+
+void ComputeParticleSystem::recordLiveCountReadback(
+    VkCommandBuffer commandBuffer, int frameIndex) {
+  VkBufferMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.buffer = drawBuffers[frameIndex]->getBuffer();
+  barrier.offset = 0;
+  barrier.size = VK_WHOLE_SIZE;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 1,
+                       &barrier, 0, nullptr);
+
+  VkBufferCopy copyRegion{};
+  copyRegion.srcOffset = offsetof(VkDrawIndirectCommand, vertexCount);
+  copyRegion.size = sizeof(uint32_t);
+  vkCmdCopyBuffer(commandBuffer, drawBuffers[frameIndex]->getBuffer(),
+                  readbackBuffers[frameIndex]->getBuffer(), 1, &copyRegion);
+
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+  barrier.buffer = readbackBuffers[frameIndex]->getBuffer();
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &barrier,
+                       0, nullptr);
+}
+
+void ComputeParticleSystem::acquireParticles(lve::FrameInfo& frameInfo) {
+  recordOwnershipTransfer(frameInfo.commandBuffer, frameInfo.frameIndex,
+                          false);
+}
+
+void ComputeParticleSystem::recordOwnershipTransfer(
+    VkCommandBuffer commandBuffer, int frameIndex, bool release) {
+  // same family : the timeline semaphore wait already makes the writes
+  // visible.
+  if (graphicsFamily == computeFamily) return;
+
+  // release and acquire must match except for the access and stage masks.
+  std::array<VkBufferMemoryBarrier, 3> barriers{};
+  VkBuffer buffers[] = {vertexPositionBuffers[frameIndex]->getBuffer(),
+                        vertexColorBuffers[frameIndex]->getBuffer(),
+                        drawBuffers[frameIndex]->getBuffer()};
+  VkAccessFlags dstAccessMasks[] = {VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
+                                    VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
+                                    VK_ACCESS_INDIRECT_COMMAND_READ_BIT};
+  for (int i = 0; i < barriers.size(); i++) {
+    barriers[i].sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barriers[i].srcAccessMask = release ? VK_ACCESS_SHADER_WRITE_BIT : 0;
+    barriers[i].dstAccessMask = release ? 0 : dstAccessMasks[i];
+    barriers[i].srcQueueFamilyIndex = computeFamily;
+    barriers[i].dstQueueFamilyIndex = graphicsFamily;
+    barriers[i].buffer = buffers[i];
+    barriers[i].offset = 0;
+    barriers[i].size = VK_WHOLE_SIZE;
+  }
+
+  // NOTE: the draw arguments were also read by the live count readback.
+  // acquire: source stages are the compute timeline wait stages of the
+  // graphics submit, so the barrier chains with the semaphore wait.
+  VkPipelineStageFlags graphicsStages = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT |
+                                        VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+  VkPipelineStageFlags srcStage = release
+                                      ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT |
+                                            VK_PIPELINE_STAGE_TRANSFER_BIT
+                                      : graphicsStages;
+  VkPipelineStageFlags dstStage =
+      release ? VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT : graphicsStages;
+  vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr,
+                       static_cast<uint32_t>(barriers.size()), barriers.data(),
+                       0, nullptr);
 }
 
 void ComputeParticleSystem::renderParticles(lve::FrameInfo& frameInfo) {
+  lve::LveGpuProfiler::Scope profileScope{frameInfo, "particles_render"};
   lveGraphicsPipeline->bind(frameInfo.commandBuffer);
   VkBuffer buffers[] = {
-      shaderStorageBuffers[frameInfo.frameIndex]->getBuffer()};
-  VkDeviceSize offsets[] = {0};
+      vertexPositionBuffers[frameInfo.frameIndex]->getBuffer(),
+      vertexColorBuffers[frameInfo.frameIndex]->getBuffer()};
+  VkDeviceSize offsets[] = {0, 0};
   vkCmdBindDescriptorSets(
       frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
       graphicsPipelineLayout, 0, 1,
       &graphicsDescriptorSets[frameInfo.frameIndex], 0, nullptr);
-  vkCmdBindVertexBuffers(frameInfo.commandBuffer, 0, 1, buffers, offsets);
-  vkCmdDraw(frameInfo.commandBuffer, PARTICLE_COUNT, 1, 0, 0);
+  vkCmdBindVertexBuffers(frameInfo.commandBuffer, 0, 2, buffers, offsets);
+  // live count written by the simulation of this frame.
+  vkCmdDrawIndirect(frameInfo.commandBuffer,
+                    drawBuffers[frameInfo.frameIndex]->getBuffer(), 0, 1,
+                    sizeof(VkDrawIndirectCommand));
 }
 
-}  // namespace tut
\ No newline at end of file
+}  // namespace tut
@@ -3,70 +3,221 @@
 #include "lve_buffer.hpp"
 #include "lve_descriptors.hpp"
 #include "lve_device.hpp"
+#include "lve_frame_context.hpp"
 #include "lve_frame_info.hpp"
 #include "lve_pipeline.hpp"
+#include "lve_pipeline_compiler.hpp"
+#include "systems/cpu_particle_integrator.hpp"
+
+// libs
+#include <glm/gtc/constants.hpp>
 
 // std
 #include <memory>
 #include <vector>
 
 namespace tut {
-struct Particle {
-  glm::vec2 position;
-  glm::vec2 velocity;
-  glm::vec2 acceleration;
-  // NOTE: aligment
-  alignas(16) glm::vec4 color;
+// per particle data that never changes after emission. position and velocity
+// are kept in separate buffers, the simulation only rewrites those.
+struct ParticleConstants {
+  // unorm8x4
+  uint32_t color;
+  // in ParticleUbo::time
+  float deathTime;
+  // acceleration and nominal lifetime come from the emitter.
+  uint32_t emitter;
+};
+
+// compacted live particles written by the simulation, drawn as points.
+// binding 0: vec2 positions, binding 1: unorm8x4 colors.
+struct ParticleVertex {
   static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
   static std::vector<VkVertexInputAttributeDescription>
   getAttributeDescriptions();
 };
 
+// spawn settings, configured from the app and applied every compute frame.
+struct ParticleEmitter {
+  glm::vec2 position{0.f};
+  // particles spawn on a ring of [minRadius, maxRadius] around the position.
+  float minRadius = 0.f;
+  float maxRadius = 0.f;
+  // particles per second.
+  float rate = 0.f;
+  float speed = .5f;
+  float speedVariance = 0.f;
+  // emission cone in radians, the full circle by default.
+  float direction = 0.f;
+  float spread = glm::two_pi<float>();
+  // seconds
+  float lifetime = 4.f;
+  float lifetimeVariance = 0.f;
+  glm::vec2 acceleration{0.f, .2f};
+  // multiplied with the rainbow color of the emission angle. particles fade
+  // out over the lifetime.
+  glm::vec4 color{1.f};
+  bool enabled = true;
+};
+
+// emitter as seen by compute_particle_emit.comp (std140).
+struct ParticleEmitterUbo {
+  glm::vec4 positionRadius;    // xy: position, zw: min / max radius
+  glm::vec4 motion;            // xy: speed / variance, zw: direction / spread
+  glm::vec4 lifeAcceleration;  // xy: lifetime / variance, zw: acceleration
+  glm::vec4 color;
+  glm::uvec4 spawnRange;  // x: first spawn index, y: spawn count
+};
+
+constexpr uint32_t MAX_PARTICLE_EMITTERS = 16;
+
 struct ParticleUbo {
+  // one fixed timestep tick.
   float deltaTime = 1.0;
+  uint32_t capacity = 0;
+  // alive list read this frame, the other one receives the survivors.
+  uint32_t currentList = 0;
+  // spawns requested by all emitters, clamped to the dead count on the gpu.
+  uint32_t spawnCount = 0;
+  uint32_t emitterCount = 0;
+  uint32_t seed = 0;
+  // simulated seconds, death times are absolute.
+  // NOTE: float is fine for about a day (8ms precision).
+  float time = 0.f;
+  // simulate steps of deltaTime this frame, 0 only refills the vertices.
+  uint32_t tickCount = 0;
+  alignas(16) ParticleEmitterUbo emitters[MAX_PARTICLE_EMITTERS];
+};
+
+// pool counters and indirect dispatch arguments, see compute_particle.comp.
+struct ParticleCounters {
+  VkDispatchIndirectCommand emitDispatch;
+  VkDispatchIndirectCommand simulateDispatch;
+  // alive lists are ping-ponged every compute frame.
+  uint32_t aliveCount[2];
+  uint32_t deadCount;
+  uint32_t emitCount;
 };
 
 class ComputeParticleSystem {
  public:
-  static constexpr uint32_t PARTICLE_COUNT = 256u * 32;
-
-  ComputeParticleSystem(lve::LveDevice &device, VkRenderPass renderPass,
-                        lve::LveDescriptorPool &pool);
+  // local_size_x of the particle kernels (specialization constant 0)
+  static constexpr uint32_t WORKGROUP_SIZE = 256;
+  static constexpr uint32_t MAX_EMITTERS = MAX_PARTICLE_EMITTERS;
+  // memory traffic of the simulate kernel for one live particle.
+  // read: alive index, position, velocity, constants
+  // write: position, velocity, next alive index, vertex position and color
+  static constexpr uint32_t SIMULATE_BYTES_PER_PARTICLE =
+      sizeof(uint32_t) + 2 * sizeof(glm::vec2) + sizeof(ParticleConstants) +
+      2 * sizeof(glm::vec2) + sizeof(uint32_t) + sizeof(glm::vec2) +
+      sizeof(uint32_t);
+  using EmitterId = uint32_t;
+
+  ComputeParticleSystem(lve::LveDevice &device,
+                        const lve::LveFrameContext &frameContext,
+                        VkRenderPass renderPass,
+                        lve::LveDescriptorPool &pool,
+                        lve::LvePipelineCompiler &pipelineCompiler,
+                        uint32_t capacity);
   ~ComputeParticleSystem();
 
   ComputeParticleSystem(const ComputeParticleSystem &) = delete;
   ComputeParticleSystem &operator=(const ComputeParticleSystem &) = delete;
 
+  // at most MAX_EMITTERS.
+  EmitterId addEmitter(const ParticleEmitter &emitter);
+  ParticleEmitter &getEmitter(EmitterId id);
+  // spawns count particles on the next compute frame, on top of the rate.
+  void burst(EmitterId id, uint32_t count);
+  uint32_t getCapacity() const { return capacity; }
+  // drawn particles of the last completed compute frame.
+  uint32_t getLiveCount() const { return liveCount; }
+  // steps of the last updateUbo, tickCount of tickTime each.
+  float getLastTickTime() const { return lastTickTime; }
+  uint32_t getLastTickCount() const { return lastTickCount; }
+  // copies every pool slot to the host, dead ones included. accelerations
+  // come from the current emitter settings.
+  // NOTE: blocks on the compute queue, no compute frame may be in flight.
+  void readbackPool(ParticleSoa &particles);
+
   // TODO: need only compute command buffer of the frame idx.
-  // recording dispatch cmd
+  // recording emit and simulate dispatches, sized by the live count on the
+  // gpu. live particles are compacted into the vertex buffer of the frame,
+  // which is released to the graphics family with its draw arguments.
   void computeParticles(lve::FrameInfo &frameInfo);
+  // graphics side of the ownership transfer. record before the render pass.
+  void acquireParticles(lve::FrameInfo &frameInfo);
   // render particles
   void renderParticles(lve::FrameInfo &frameInfo);
+  // also turns emitter rates into spawn counts of this compute frame.
   void updateUbo(lve::FrameInfo &frameInfo);
 
  private:
+  struct EmitterState {
+    ParticleEmitter emitter;
+    // fraction of a particle carried over to the next frame.
+    float accumulator = 0.f;
+    uint32_t pendingBurst = 0;
+  };
+
   void createGraphicsPipelineLayout();
-  void createGraphicsPipeline(VkRenderPass renderPass);
+  void createGraphicsPipeline(VkRenderPass renderPass,
+                              lve::LvePipelineCompiler &pipelineCompiler);
 
   void createComputePipelineLayout();
-  void createComputePipeline();
+  void createComputePipelines(lve::LvePipelineCompiler &pipelineCompiler);
 
   void createUniformBuffers();
-  void createShaderStorageBuffers();
+  void createPoolBuffers();
+  void createVertexBuffers();
+  // live count of the frame, read back once its compute slot is reused.
+  void recordLiveCountReadback(VkCommandBuffer commandBuffer, int frameIndex);
+  // queue family ownership transfer of the frame's vertex and draw buffers.
+  void recordOwnershipTransfer(VkCommandBuffer commandBuffer, int frameIndex,
+                               bool release);
   void createGraphicsDescriptorSetLayout();
   void createComputeDescriptorSetLayout();
   void createGraphicsDescriptorSets(lve::LveDescriptorPool &pool);
   void createComputeDescriptorSets(lve::LveDescriptorPool &pool);
 
   lve::LveDevice &lveDevice;
+  const lve::LveFrameContext &frameContext;
+  uint32_t capacity;
+
+  std::vector<EmitterState> emitters;
+  // number of recorded compute frames, selects the current alive list.
+  uint32_t computeFrameCount = 0;
+  float simulationTime = 0.f;
+  float lastTickTime = 0.f;
+  uint32_t lastTickCount = 0;
+  uint32_t liveCount = 0;
 
   std::unique_ptr<lve::LvePipeline> lveGraphicsPipeline;
   VkPipelineLayout graphicsPipelineLayout;
-  std::unique_ptr<lve::LvePipeline> lveComputePipeline;
+  // kickoff -> emit -> simulate, sharing one layout.
+  std::unique_ptr<lve::LvePipeline> lveKickoffPipeline;
+  std::unique_ptr<lve::LvePipeline> lveEmitPipeline;
+  std::unique_ptr<lve::LvePipeline> lveSimulatePipeline;
   VkPipelineLayout computePipelineLayout;
 
   std::vector<std::unique_ptr<lve::LveBuffer>> uniformBuffers;
-  std::vector<std::unique_ptr<lve::LveBuffer>> shaderStorageBuffers;
+  // particle pool as structure of arrays, only used by the compute family.
+  std::unique_ptr<lve::LveBuffer> positionBuffer;
+  std::unique_ptr<lve::LveBuffer> velocityBuffer;
+  std::unique_ptr<lve::LveBuffer> constantBuffer;
+  std::unique_ptr<lve::LveBuffer> deadListBuffer;
+  // two alive lists of capacity each.
+  std::unique_ptr<lve::LveBuffer> aliveListBuffer;
+  // ParticleCounters, also the source of the indirect dispatches.
+  std::unique_ptr<lve::LveBuffer> counterBuffer;
+  // live particles of the frame drawn by the graphics family.
+  std::vector<std::unique_ptr<lve::LveBuffer>> vertexPositionBuffers;
+  std::vector<std::unique_ptr<lve::LveBuffer>> vertexColorBuffers;
+  // VkDrawIndirectCommand, vertexCount is the live count of the frame.
+  std::vector<std::unique_ptr<lve::LveBuffer>> drawBuffers;
+  // host visible copy of the vertexCount.
+  std::vector<std::unique_ptr<lve::LveBuffer>> readbackBuffers;
+  uint32_t graphicsFamily;
+  uint32_t computeFamily;
 
   std::unique_ptr<lve::LveDescriptorSetLayout> graphicsDescriptorSetLayout;
   std::vector<VkDescriptorSet> graphicsDescriptorSets;
@@ -74,4 +225,4 @@ class ComputeParticleSystem {
   std::unique_ptr<lve::LveDescriptorSetLayout> computeDescriptorSetLayout;
   std::vector<VkDescriptorSet> computeDescriptorSets;
 };
-}  // namespace tut
\ No newline at end of file
+}  // namespace tut
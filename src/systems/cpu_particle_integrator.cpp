@@ -0,0 +1,325 @@
+#include "cpu_particle_integrator.hpp"
+
+#include "lve_cpu_profiler.hpp"
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <random>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+// AVX lanes are built per function and picked at runtime, the rest of the
+// build stays on the baseline instruction set.
+#define TUT_PARTICLE_AVX
+#define TUT_TARGET_AVX __attribute__((target("avx")))
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TUT_PARTICLE_SSE2
+#endif
+
+namespace tut {
+
+namespace {
+
+// whole lanes of [first, end), returns the first lane left to the scalar path.
+using IntegrateLanes = size_t (*)(ParticleSoa &particles, float dt,
+                                  size_t first, size_t end);
+
+#if defined(TUT_PARTICLE_AVX)
+// NOTE: the target functions inline only into each other, no lambdas here.
+TUT_TARGET_AVX inline __m256 flipAvx(__m256 position, __m256 velocity) {
+  const __m256 signMask = _mm256_set1_ps(-0.f);
+  __m256 absVelocity = _mm256_andnot_ps(signMask, velocity);
+  __m256 low = _mm256_cmp_ps(position, _mm256_set1_ps(-1.f), _CMP_LE_OQ);
+  __m256 high = _mm256_cmp_ps(position, _mm256_set1_ps(1.f), _CMP_GE_OQ);
+  velocity = _mm256_blendv_ps(velocity, absVelocity, low);
+  return _mm256_blendv_ps(velocity, _mm256_or_ps(absVelocity, signMask), high);
+}
+
+TUT_TARGET_AVX size_t integrateAvx(ParticleSoa &particles, float dt,
+                                   size_t first, size_t end) {
+  float *positionX = particles.positionX.data();
+  float *positionY = particles.positionY.data();
+  float *velocityX = particles.velocityX.data();
+  float *velocityY = particles.velocityY.data();
+  const float *accelerationX = particles.accelerationX.data();
+  const float *accelerationY = particles.accelerationY.data();
+  const __m256 dtLanes = _mm256_set1_ps(dt);
+  // NOTE: mul then add, no fma, so the lanes round like the scalar path.
+  size_t i = first;
+  for (; i + 8 <= end; i += 8) {
+    __m256 vx = _mm256_loadu_ps(velocityX + i);
+    __m256 vy = _mm256_loadu_ps(velocityY + i);
+    __m256 x = _mm256_add_ps(_mm256_loadu_ps(positionX + i),
+                             _mm256_mul_ps(vx, dtLanes));
+    __m256 y = _mm256_add_ps(_mm256_loadu_ps(positionY + i),
+                             _mm256_mul_ps(vy, dtLanes));
+    vx = _mm256_add_ps(
+        vx, _mm256_mul_ps(_mm256_loadu_ps(accelerationX + i), dtLanes));
+    vy = _mm256_add_ps(
+        vy, _mm256_mul_ps(_mm256_loadu_ps(accelerationY + i), dtLanes));
+    _mm256_storeu_ps(positionX + i, x);
+    _mm256_storeu_ps(positionY + i, y);
+    _mm256_storeu_ps(velocityX + i, flipAvx(x, vx));
+    _mm256_storeu_ps(velocityY + i, flipAvx(y, vy));
+  }
+  return i;
+}
+#endif
+
+#if defined(TUT_PARTICLE_SSE2)
+// no blendv before SSE4.1, select with and / andnot / or.
+inline __m128 selectSse2(__m128 mask, __m128 a, __m128 b) {
+  return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+inline __m128 flipSse2(__m128 position, __m128 velocity) {
+  const __m128 signMask = _mm_set1_ps(-0.f);
+  __m128 absVelocity = _mm_andnot_ps(signMask, velocity);
+  velocity = selectSse2(_mm_cmple_ps(position, _mm_set1_ps(-1.f)), absVelocity,
+                        velocity);
+  return selectSse2(_mm_cmpge_ps(position, _mm_set1_ps(1.f)),
+                    _mm_or_ps(absVelocity, signMask), velocity);
+}
+
+size_t integrateSse2(ParticleSoa &particles, float dt, size_t first,
+                     size_t end) {
+  float *positionX = particles.positionX.data();
+  float *positionY = particles.positionY.data();
+  float *velocityX = particles.velocityX.data();
+  float *velocityY = particles.velocityY.data();
+  const float *accelerationX = particles.accelerationX.data();
+  const float *accelerationY = particles.accelerationY.data();
+  const __m128 dtLanes = _mm_set1_ps(dt);
+  size_t i = first;
+  for (; i + 4 <= end; i += 4) {
+    __m128 vx = _mm_loadu_ps(velocityX + i);
+    __m128 vy = _mm_loadu_ps(velocityY + i);
+    __m128 x = _mm_add_ps(_mm_loadu_ps(positionX + i), _mm_mul_ps(vx, dtLanes));
+    __m128 y = _mm_add_ps(_mm_loadu_ps(positionY + i), _mm_mul_ps(vy, dtLanes));
+    vx = _mm_add_ps(vx, _mm_mul_ps(_mm_loadu_ps(accelerationX + i), dtLanes));
+    vy = _mm_add_ps(vy, _mm_mul_ps(_mm_loadu_ps(accelerationY + i), dtLanes));
+    _mm_storeu_ps(positionX + i, x);
+    _mm_storeu_ps(positionY + i, y);
+    _mm_storeu_ps(velocityX + i, flipSse2(x, vx));
+    _mm_storeu_ps(velocityY + i, flipSse2(y, vy));
+  }
+  return i;
+}
+#endif
+
+struct SimdPath {
+  const char *name;
+  // nullptr : scalar only.
+  IntegrateLanes integrate;
+};
+
+SimdPath selectSimdPath() {
+#if defined(TUT_PARTICLE_AVX)
+  if (__builtin_cpu_supports("avx")) return {"avx", integrateAvx};
+#endif
+#if defined(TUT_PARTICLE_SSE2)
+  return {"sse2", integrateSse2};
+#else
+  return {"scalar", nullptr};
+#endif
+}
+
+// cpu checked once, on the first integration.
+const SimdPath &getSimdPath() {
+  static const SimdPath simdPath = selectSimdPath();
+  return simdPath;
+}
+
+}  // namespace
+
+void ParticleSoa::resize(size_t count) {
+  positionX.resize(count);
+  positionY.resize(count);
+  velocityX.resize(count);
+  velocityY.resize(count);
+  accelerationX.resize(count);
+  accelerationY.resize(count);
+}
+
+CpuParticleIntegrator::CpuParticleIntegrator(lve::LveThreadPool *threadPool)
+    : threadPool{threadPool} {}
+
+void CpuParticleIntegrator::integrate(ParticleSoa &particles, float dt) {
+  LVE_PROFILE_FUNCTION();
+  size_t particleCount = particles.size();
+  if (particleCount == 0) return;
+
+  if (threadPool == nullptr) {
+    integrateSimd(particles, dt, 0, particleCount);
+    return;
+  }
+  threadPool->parallelFor(
+      particleCount, MIN_PARTICLES_PER_CHUNK,
+      lve::LveThreadPool::FLOATS_PER_CACHE_LINE,
+      [&particles, dt](size_t, size_t first, size_t count) {
+        LVE_PROFILE_SCOPE("integrate_chunk");
+        integrateSimd(particles, dt, first, count);
+      });
+}
+
+void CpuParticleIntegrator::integrateScalar(ParticleSoa &particles, float dt,
+                                            size_t first, size_t count) {
+  float *positionX = particles.positionX.data();
+  float *positionY = particles.positionY.data();
+  float *velocityX = particles.velocityX.data();
+  float *velocityY = particles.velocityY.data();
+  const float *accelerationX = particles.accelerationX.data();
+  const float *accelerationY = particles.accelerationY.data();
+
+  for (size_t i = first; i < first + count; i++) {
+    // same order as the shader: position with the old velocity.
+    float x = positionX[i] + velocityX[i] * dt;
+    float y = positionY[i] + velocityY[i] * dt;
+    float vx = velocityX[i] + accelerationX[i] * dt;
+    float vy = velocityY[i] + accelerationY[i] * dt;
+
+    // window border flip
+    if (x <= -1.f) {
+      vx = std::fabs(vx);
+    } else if (x >= 1.f) {
+      vx = -std::fabs(vx);
+    }
+    if (y <= -1.f) {
+      vy = std::fabs(vy);
+    } else if (y >= 1.f) {
+      vy = -std::fabs(vy);
+    }
+
+    positionX[i] = x;
+    positionY[i] = y;
+    velocityX[i] = vx;
+    velocityY[i] = vy;
+  }
+}
+
+void CpuParticleIntegrator::integrateSimd(ParticleSoa &particles, float dt,
+                                          size_t first, size_t count) {
+  const SimdPath &simdPath = getSimdPath();
+  size_t end = first + count;
+  size_t i = simdPath.integrate != nullptr
+                 ? simdPath.integrate(particles, dt, first, end)
+                 : first;
+  // remaining lanes
+  integrateScalar(particles, dt, i, end - i);
+}
+
+const char *CpuParticleIntegrator::getSimdName() {
+  return getSimdPath().name;
+}
+
+uint32_t CpuParticleIntegrator::ulpDistance(float a, float b) {
+  if (a == b) return 0;  // also +0 and -0
+  if (std::isnan(a) || std::isnan(b)) return UINT32_MAX;
+  // floats ordered as sign magnitude integers -> biased to one line.
+  auto toOrdered = [](float value) {
+    int32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits < 0 ? static_cast<int64_t>(INT32_MIN) - bits
+                    : static_cast<int64_t>(bits);
+  };
+  int64_t distance = std::abs(toOrdered(a) - toOrdered(b));
+  return static_cast<uint32_t>(std::min<int64_t>(distance, UINT32_MAX));
+}
+
+CpuParticleIntegrator::Comparison CpuParticleIntegrator::compare(
+    const ParticleSoa &expected, const ParticleSoa &actual, uint32_t maxUlp,
+    float absTolerance) {
+  Comparison comparison{};
+  size_t count = std::min(expected.size(), actual.size());
+  comparison.count = count;
+  auto compareLanes = [&](const std::vector<float> &expectedLanes,
+                          const std::vector<float> &actualLanes) {
+    for (size_t i = 0; i < count; i++) {
+      uint32_t ulp = ulpDistance(expectedLanes[i], actualLanes[i]);
+      float absError = std::fabs(expectedLanes[i] - actualLanes[i]);
+      comparison.maxUlp = std::max(comparison.maxUlp, ulp);
+      comparison.maxAbsError = std::max(comparison.maxAbsError, absError);
+      if (ulp > maxUlp && !(absError <= absTolerance)) {
+        comparison.mismatchCount++;
+      }
+    }
+  };
+  compareLanes(expected.positionX, actual.positionX);
+  compareLanes(expected.positionY, actual.positionY);
+  compareLanes(expected.velocityX, actual.velocityX);
+  compareLanes(expected.velocityY, actual.velocityY);
+  return comparison;
+}
+
+bool CpuParticleIntegrator::runBenchmark(uint32_t particleCount,
+                                         uint32_t steps,
+                                         lve::LveThreadPool &threadPool) {
+  // same distribution as the particle benchmark of the gpu.
+  std::default_random_engine randomEngine;
+  randomEngine.seed(1111);
+  std::uniform_real_distribution<float> randomDist(-1.f, 1.f);
+  ParticleSoa initial{};
+  initial.resize(particleCount);
+  for (uint32_t i = 0; i < particleCount; i++) {
+    initial.positionX[i] = randomDist(randomEngine);
+    initial.positionY[i] = randomDist(randomEngine);
+    initial.velocityX[i] = randomDist(randomEngine) * .5f;
+    initial.velocityY[i] = randomDist(randomEngine) * .5f;
+    initial.accelerationX[i] = 0.f;
+    initial.accelerationY[i] = .2f;
+  }
+  const float dt = 1.f / 60.f;
+
+  CpuParticleIntegrator singleThread{};
+  CpuParticleIntegrator multiThread{&threadPool};
+  auto measure = [&](const char *name, ParticleSoa &particles, auto &&step) {
+    auto startTime = std::chrono::steady_clock::now();
+    for (uint32_t s = 0; s < steps; s++) {
+      step(particles);
+    }
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - startTime)
+                         .count();
+    double particlesPerSecond =
+        static_cast<double>(particleCount) * steps / seconds;
+    std::cout << name << ": " << seconds * 1e3 / steps << " ms/step, "
+              << particlesPerSecond * 1e-6 << " M particles/s, "
+              << particlesPerSecond * BYTES_PER_PARTICLE * 1e-9 << " GB/s"
+              << std::endl;
+  };
+
+  std::cout << "cpu particle benchmark: " << particleCount << " particles, "
+            << steps << " steps, simd " << getSimdName() << ", "
+            << threadPool.getThreadCount() << " threads" << std::endl;
+  ParticleSoa scalar = initial;
+  measure("scalar", scalar, [&](ParticleSoa &particles) {
+    integrateScalar(particles, dt, 0, particles.size());
+  });
+  ParticleSoa simd = initial;
+  measure("simd", simd, [&](ParticleSoa &particles) {
+    singleThread.integrate(particles, dt);
+  });
+  ParticleSoa threaded = initial;
+  measure("simd threaded", threaded, [&](ParticleSoa &particles) {
+    multiThread.integrate(particles, dt);
+  });
+
+  // NOTE: same operations in the same order, any difference is a bug.
+  bool isValid = true;
+  for (auto result : {&simd, &threaded}) {
+    Comparison comparison = compare(scalar, *result, 0, 0.f);
+    std::cout << "validate against scalar: " << comparison.mismatchCount
+              << " mismatches, max ulp " << comparison.maxUlp << std::endl;
+    isValid = isValid && comparison.mismatchCount == 0;
+  }
+  return isValid;
+}
+
+}  // namespace tut
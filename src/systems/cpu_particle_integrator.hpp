@@ -0,0 +1,80 @@
+#pragma once
+
+#include "lve_thread_pool.hpp"
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace tut {
+
+// particle state as structure of arrays, one float per lane.
+struct ParticleSoa {
+  std::vector<float> positionX;
+  std::vector<float> positionY;
+  std::vector<float> velocityX;
+  std::vector<float> velocityY;
+  // constant over the integration.
+  std::vector<float> accelerationX;
+  std::vector<float> accelerationY;
+
+  size_t size() const { return positionX.size(); }
+  void resize(size_t count);
+};
+
+// CPU reference of the integration in compute_particle.comp: euler step of
+// position and velocity, then the window border reflection. lifetime and the
+// alive / dead lists are not part of it.
+// the simd path uses AVX when the cpu has it, SSE2 otherwise.
+// both do the same operations in the same order as the scalar path, so the
+// results are bit identical.
+class CpuParticleIntegrator {
+ public:
+  // per thread chunk, also keeps chunks on separate cache lines.
+  static constexpr size_t MIN_PARTICLES_PER_CHUNK = 16384;
+  // read: position, velocity, acceleration, write: position, velocity
+  static constexpr size_t BYTES_PER_PARTICLE = 10 * sizeof(float);
+
+  struct Comparison {
+    size_t count = 0;
+    // lanes outside the tolerance, position and velocity counted separately.
+    size_t mismatchCount = 0;
+    uint32_t maxUlp = 0;
+    float maxAbsError = 0.f;
+  };
+
+  // threadPool nullptr : runs on the calling thread only.
+  explicit CpuParticleIntegrator(lve::LveThreadPool *threadPool = nullptr);
+
+  CpuParticleIntegrator(const CpuParticleIntegrator &) = delete;
+  CpuParticleIntegrator &operator=(const CpuParticleIntegrator &) = delete;
+
+  // simd, split across the thread pool.
+  void integrate(ParticleSoa &particles, float dt);
+
+  static void integrateScalar(ParticleSoa &particles, float dt, size_t first,
+                              size_t count);
+  static void integrateSimd(ParticleSoa &particles, float dt, size_t first,
+                            size_t count);
+  // "avx", "sse2" or "scalar"
+  static const char *getSimdName();
+
+  // a lane matches when it is within maxUlp or absTolerance of expected.
+  // NOTE: the absolute tolerance covers values near zero, where ulps are tiny.
+  static Comparison compare(const ParticleSoa &expected,
+                            const ParticleSoa &actual, uint32_t maxUlp,
+                            float absTolerance);
+  static uint32_t ulpDistance(float a, float b);
+
+  // scalar, simd and threaded simd throughput on particleCount random
+  // particles, checks the simd results against the scalar ones.
+  // returns false on a mismatch.
+  static bool runBenchmark(uint32_t particleCount, uint32_t steps,
+                           lve::LveThreadPool &threadPool);
+
+ private:
+  lve::LveThreadPool *threadPool;
+};
+
+}  // namespace tut
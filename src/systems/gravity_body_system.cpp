@@ -0,0 +1,553 @@
+#include "gravity_body_system.hpp"
+
+#include "lve_gpu_profiler.hpp"
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+namespace kc_bonus {
+
+GravityBodySystem::GravityBodySystem(
+    lve::LveDevice& device, const lve::LveFrameContext& frameContext,
+    VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout,
+    lve::LveDescriptorPool& pool, lve::LvePipelineCompiler& pipelineCompiler,
+    lve::LveThreadPool& threadPool, const GravityBodies& bodies,
+    const Settings& settings)
+    : lveDevice{device},
+      frameContext{frameContext},
+      threadPool{threadPool},
+      settings{settings},
+      bodyCount{static_cast<uint32_t>(bodies.size())},
+      initialBodies{bodies} {
+  // NOTE: one invocation per body, the dispatch covers all of them.
+  uint64_t maxBodyCount =
+      static_cast<uint64_t>(WORKGROUP_SIZE) *
+      lveDevice.properties.limits.maxComputeWorkGroupCount[0];
+  if (bodyCount == 0 || bodyCount > maxBodyCount) {
+    throw std::runtime_error("gravity body count out of range!");
+  }
+  if (settings.substeps == 0) {
+    throw std::runtime_error("gravity needs at least one substep!");
+  }
+
+  auto queueFamilies = lveDevice.findPhysicalQueueFamilies();
+  graphicsFamily = queueFamilies.graphicsAndComputeFamily.value();
+  computeFamily = queueFamilies.computeFamily.value();
+
+  if (settings.backend == Backend::CPU) {
+    physicsSystem = createPhysicsSystem();
+    previousPositions.resize(bodyCount);
+    for (uint32_t i = 0; i < bodyCount; i++) {
+      previousPositions[i] = {initialBodies.positionX[i],
+                              initialBodies.positionY[i],
+                              initialBodies.positionZ[i]};
+    }
+  }
+
+  createVertexBuffers();
+  createGraphicsPipelineLayout(globalSetLayout);
+  createGraphicsPipeline(renderPass, pipelineCompiler);
+
+  if (settings.backend == Backend::GPU) {
+    createUniformBuffers();
+    createBodyBuffers();
+    uploadBodies(initialBodies);
+
+    createComputeDescriptorSetLayout();
+    createComputeDescriptorSets(pool);
+    createComputePipelineLayout();
+    createComputePipeline(pipelineCompiler);
+  }
+}
+GravityBodySystem::~GravityBodySystem() {
+  // NOTE: pipelines first, async builds may still use the layouts.
+  lveGraphicsPipeline.reset();
+  lveComputePipeline.reset();
+  vkDestroyPipelineLayout(lveDevice.device(), graphicsPipelineLayout, nullptr);
+  if (settings.backend == Backend::GPU) {
+    vkDestroyPipelineLayout(lveDevice.device(), computePipelineLayout,
+                            nullptr);
+  }
+}
+
+std::unique_ptr<GravityPhysicsSystem>
+GravityBodySystem::createPhysicsSystem() {
+  auto system = std::make_unique<GravityPhysicsSystem>(
+      settings.strength, GravityPhysicsSystem::Solver::BRUTE_FORCE, .5f,
+      &threadPool);
+  system->getBodies() = initialBodies;
+  return system;
+}
+
+void GravityBodySystem::createUniformBuffers() {
+  uniformBuffers.resize(frameContext.getFramesInFlight());
+  for (auto& buffer : uniformBuffers) {
+    // NOTE: need to flush since non-coherent
+    buffer = std::make_unique<lve::LveBuffer>(
+        lveDevice, sizeof(GravityUbo), 1, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+    buffer->map();
+  }
+}
+
+void GravityBodySystem::createBodyBuffers() {
+  VkBufferUsageFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                             VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+                             VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+  for (auto& buffer : bodyBuffers) {
+    buffer = std::make_unique<lve::LveBuffer>(
+        lveDevice, sizeof(glm::vec4), bodyCount, usage,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  }
+  velocityBuffer = std::make_unique<lve::LveBuffer>(
+      lveDevice, sizeof(glm::vec4), bodyCount, usage,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+}
+
+void GravityBodySystem::createVertexBuffers() {
+  vertexBuffers.resize(frameContext.getFramesInFlight());
+  for (auto& buffer : vertexBuffers) {
+    if (settings.backend == Backend::GPU) {
+      // written by the compute shader or copied from the bodies, never seen
+      // by the host.
+      buffer = std::make_unique<lve::LveBuffer>(
+          lveDevice, sizeof(glm::vec4), bodyCount,
+          VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+              VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+              VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    } else {
+      // written by cpu every frame. need to flush since non-coherent
+      buffer = std::make_unique<lve::LveBuffer>(
+          lveDevice, sizeof(glm::vec4), bodyCount,
+          VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+      buffer->map();
+    }
+  }
+  if (settings.backend == Backend::GPU) return;
+
+  // the first frames draw the initial bodies.
+  std::vector<glm::vec4> positions(bodyCount);
+  for (uint32_t i = 0; i < bodyCount; i++) {
+    positions[i] = {initialBodies.positionX[i], initialBodies.positionY[i],
+                    initialBodies.positionZ[i], 1.f};
+  }
+  for (auto& buffer : vertexBuffers) {
+    buffer->writeToBuffer(positions.data());
+    buffer->flush();
+  }
+}
+
+void GravityBodySystem::uploadBodies(const GravityBodies& bodies) {
+  std::vector<glm::vec4> positionMasses(bodyCount);
+  std::vector<glm::vec4> velocities(bodyCount);
+  for (uint32_t i = 0; i < bodyCount; i++) {
+    positionMasses[i] = {bodies.positionX[i], bodies.positionY[i],
+                         bodies.positionZ[i], bodies.mass[i]};
+    velocities[i] = {bodies.velocityX[i], bodies.velocityY[i],
+                     bodies.velocityZ[i], 0.f};
+  }
+
+  // transfer using staging buffer
+  lve::LveBuffer positionStaging{
+      lveDevice,
+      sizeof(glm::vec4),
+      bodyCount,
+      VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+  };
+  positionStaging.map();
+  positionStaging.writeToBuffer(positionMasses.data());
+  lve::LveBuffer velocityStaging{
+      lveDevice,
+      sizeof(glm::vec4),
+      bodyCount,
+      VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+  };
+  velocityStaging.map();
+  velocityStaging.writeToBuffer(velocities.data());
+
+  // NOTE: on the compute queue, the buffers are owned by the compute family.
+  VkCommandBuffer commandBuffer = lveDevice.beginSingleTimeComputeCommands();
+  VkBufferCopy copyRegion{};
+  copyRegion.size = positionStaging.getBufferSize();
+  vkCmdCopyBuffer(commandBuffer, positionStaging.getBuffer(),
+                  bodyBuffers[0]->getBuffer(), 1, &copyRegion);
+  copyRegion.size = velocityStaging.getBufferSize();
+  vkCmdCopyBuffer(commandBuffer, velocityStaging.getBuffer(),
+                  velocityBuffer->getBuffer(), 1, &copyRegion);
+  lveDevice.endSingleTimeComputeCommands(commandBuffer);
+  currentBuffer = 0;
+}
+
+void GravityBodySystem::readbackBodies(GravityBodies& bodies) {
+  lve::LveBuffer* sources[] = {bodyBuffers[currentBuffer].get(),
+                               velocityBuffer.get()};
+  std::vector<std::unique_ptr<lve::LveBuffer>> stagingBuffers;
+  VkCommandBuffer commandBuffer = lveDevice.beginSingleTimeComputeCommands();
+  VkMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0,
+                       nullptr, 0, nullptr);
+  for (auto source : sources) {
+    auto staging = std::make_unique<lve::LveBuffer>(
+        lveDevice, sizeof(glm::vec4), bodyCount,
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    VkBufferCopy copyRegion{};
+    copyRegion.size = source->getBufferSize();
+    vkCmdCopyBuffer(commandBuffer, source->getBuffer(), staging->getBuffer(),
+                    1, &copyRegion);
+    stagingBuffers.push_back(std::move(staging));
+  }
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr,
+                       0, nullptr);
+  lveDevice.endSingleTimeComputeCommands(commandBuffer);
+
+  for (auto& staging : stagingBuffers) {
+    staging->map();
+  }
+  auto positionMasses =
+      static_cast<const glm::vec4*>(stagingBuffers[0]->getMappedMemory());
+  auto velocities =
+      static_cast<const glm::vec4*>(stagingBuffers[1]->getMappedMemory());
+  bodies.resize(bodyCount);
+  for (uint32_t i = 0; i < bodyCount; i++) {
+    bodies.positionX[i] = positionMasses[i].x;
+    bodies.positionY[i] = positionMasses[i].y;
+    bodies.positionZ[i] = positionMasses[i].z;
+    bodies.mass[i] = positionMasses[i].w;
+    bodies.velocityX[i] = velocities[i].x;
+    bodies.velocityY[i] = velocities[i].y;
+    bodies.velocityZ[i] = velocities[i].z;
+  }
+}
+
+void GravityBodySystem::createComputeDescriptorSetLayout() {
+  // ubo, source bodies, target bodies, velocities, vertex positions
+  auto builder = lve::LveDescriptorSetLayout::Builder(lveDevice);
+  builder.addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                     VK_SHADER_STAGE_COMPUTE_BIT);
+  for (uint32_t binding = 1; binding <= 4; binding++) {
+    builder.addBinding(binding, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                       VK_SHADER_STAGE_COMPUTE_BIT);
+  }
+  computeDescriptorSetLayout = builder.build();
+}
+
+void GravityBodySystem::createComputeDescriptorSets(
+    lve::LveDescriptorPool& pool) {
+  auto velocityInfo = velocityBuffer->descriptorInfo();
+  computeDescriptorSets.resize(frameContext.getFramesInFlight() * 2);
+  for (int i = 0; i < computeDescriptorSets.size(); i++) {
+    int frameIndex = i / 2;
+    int source = i % 2;
+    auto uniformBufferInfo = uniformBuffers[frameIndex]->descriptorInfo();
+    auto sourceInfo = bodyBuffers[source]->descriptorInfo();
+    auto targetInfo = bodyBuffers[1 - source]->descriptorInfo();
+    auto vertexInfo = vertexBuffers[frameIndex]->descriptorInfo();
+    lve::LveDescriptorWriter(*computeDescriptorSetLayout, pool)
+        .writeBuffer(0, &uniformBufferInfo)
+        .writeBuffer(1, &sourceInfo)
+        .writeBuffer(2, &targetInfo)
+        .writeBuffer(3, &velocityInfo)
+        .writeBuffer(4, &vertexInfo)
+        .build(computeDescriptorSets[i]);
+  }
+}
+
+void GravityBodySystem::createGraphicsPipelineLayout(
+    VkDescriptorSetLayout globalSetLayout) {
+  // camera from the global ubo, bodies from the vertex buffer.
+  std::vector<VkDescriptorSetLayout> descriptorSetLayouts{globalSetLayout};
+
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutInfo.setLayoutCount =
+      static_cast<uint32_t>(descriptorSetLayouts.size());
+  pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
+  if (vkCreatePipelineLayout(lveDevice.device(), &pipelineLayoutInfo, nullptr,
+                             &graphicsPipelineLayout) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create graphics pipeline layout!");
+  }
+}
+
+void GravityBodySystem::createComputePipelineLayout() {
+  std::vector<VkDescriptorSetLayout> descriptorSetLayouts{
+      computeDescriptorSetLayout->getDescriptorSetLayout()};
+
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutInfo.setLayoutCount =
+      static_cast<uint32_t>(descriptorSetLayouts.size());
+  pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
+  if (vkCreatePipelineLayout(lveDevice.device(), &pipelineLayoutInfo, nullptr,
+                             &computePipelineLayout) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create compute pipeline layout!");
+  }
+}
+
+void GravityBodySystem::createGraphicsPipeline(
+    VkRenderPass renderPass, lve::LvePipelineCompiler& pipelineCompiler) {
+  assert(graphicsPipelineLayout != nullptr &&
+         "Cannot create pipeline before pipeline layout.");
+
+  auto pipelineConfig = std::make_shared<lve::PipelineConfigInfo>();
+  lve::LvePipeline::defaultPipelineConfigInfo(*pipelineConfig);
+  lve::LvePipeline::enableAlphaBlending(*pipelineConfig);
+  // NOTE: round points are blended, depth writes would cut their corners.
+  pipelineConfig->depthStencilInfo.depthWriteEnable = VK_FALSE;
+
+  pipelineConfig->bindingDescriptions = {
+      {0, sizeof(glm::vec4), VK_VERTEX_INPUT_RATE_VERTEX},
+  };
+  pipelineConfig->attributeDescriptions = {
+      {0, 0, VK_FORMAT_R32G32B32A32_SFLOAT, 0},
+  };
+  pipelineConfig->inputAssemblyInfo.topology = VK_PRIMITIVE_TOPOLOGY_POINT_LIST;
+  pipelineConfig->renderPass = renderPass;
+  pipelineConfig->pipelineLayout = graphicsPipelineLayout;
+  pipelineConfig->multisampleInfo.rasterizationSamples =
+      lveDevice.getSampleCount();
+
+  // same round point fragment shader as the particles.
+  lveGraphicsPipeline = pipelineCompiler.createGraphicsPipeline(
+      "./shaders/gravity_body.vert.spv",
+      "./shaders/compute_particle.frag.spv", pipelineConfig);
+}
+
+void GravityBodySystem::createComputePipeline(
+    lve::LvePipelineCompiler& pipelineCompiler) {
+  assert(computePipelineLayout != nullptr &&
+         "Cannot create pipeline before pipeline layout.");
+
+  auto pipelineConfig = std::make_shared<lve::PipelineConfigInfo>();
+  pipelineConfig->pipelineLayout = computePipelineLayout;
+  pipelineConfig->specialization.add(0, WORKGROUP_SIZE);
+
+  lveComputePipeline = pipelineCompiler.createComputePipeline(
+      "./shaders/compute_gravity.comp.spv", pipelineConfig);
+}
+
+void GravityBodySystem::update(lve::FrameInfo& frameInfo) {
+  if (settings.backend != Backend::CPU) return;
+
+  const GravityBodies& bodies = physicsSystem->getBodies();
+  for (uint32_t tick = 0; tick < frameInfo.tickCount; tick++) {
+    if (tick + 1 == frameInfo.tickCount) {
+      for (uint32_t i = 0; i < bodyCount; i++) {
+        previousPositions[i] = {bodies.positionX[i], bodies.positionY[i],
+                                bodies.positionZ[i]};
+      }
+    }
+    physicsSystem->simulate(frameInfo.tickTime, settings.substeps);
+  }
+  auto* positions = static_cast<glm::vec4*>(
+      vertexBuffers[frameInfo.frameIndex]->getMappedMemory());
+  for (uint32_t i = 0; i < bodyCount; i++) {
+    glm::vec3 position{bodies.positionX[i], bodies.positionY[i],
+                       bodies.positionZ[i]};
+    positions[i] = glm::vec4(
+        glm::mix(previousPositions[i], position, frameInfo.interpolation),
+        1.f);
+  }
+  vertexBuffers[frameInfo.frameIndex]->flush();
+}
+
+void GravityBodySystem::computeBodies(lve::FrameInfo& frameInfo) {
+  if (settings.backend != Backend::GPU) return;
+
+  lve::LveGpuProfiler::Scope profileScope{frameInfo, "gravity_compute"};
+  if (frameInfo.tickCount == 0) {
+    recordVertexCopy(frameInfo.commandBuffer, frameInfo.frameIndex);
+  } else {
+    GravityUbo ubo{};
+    // same substeps as GravityPhysicsSystem::simulate.
+    ubo.deltaTime = frameInfo.tickTime / settings.substeps;
+    ubo.strength = settings.strength;
+    ubo.bodyCount = bodyCount;
+    uniformBuffers[frameInfo.frameIndex]->writeToBuffer(&ubo);
+    uniformBuffers[frameInfo.frameIndex]->flush();
+
+    lveComputePipeline->bind(frameInfo.commandBuffer);
+    for (uint32_t i = 0; i < frameInfo.tickCount * settings.substeps; i++) {
+      recordSubstep(frameInfo.commandBuffer, frameInfo.frameIndex);
+    }
+  }
+  recordOwnershipTransfer(frameInfo.commandBuffer, frameInfo.frameIndex, true);
+}
+
+void GravityBodySystem::recordSubstep(VkCommandBuffer commandBuffer,
+                                      int frameIndex) {
+  // the bodies are shared across substeps and frames, wait for the previous
+  // substep or upload (same queue, earlier submissions are in the first
+  // scope). also keeps it from overwriting what that one still reads.
+  VkMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask =
+      VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask =
+      VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  vkCmdPipelineBarrier(commandBuffer,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT |
+                           VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0,
+                       nullptr, 0, nullptr);
+
+  vkCmdBindDescriptorSets(
+      commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipelineLayout, 0,
+      1, &computeDescriptorSets[frameIndex * 2 + currentBuffer], 0, nullptr);
+  vkCmdDispatch(commandBuffer,
+                (bodyCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+  currentBuffer = 1 - currentBuffer;
+}
+
+void GravityBodySystem::recordVertexCopy(VkCommandBuffer commandBuffer,
+                                         int frameIndex) {
+  // NOTE: the bodies are unchanged, but the vertex buffer of this frame slot
+  // holds the positions of framesInFlight frames ago.
+  VkMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask =
+      VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+  vkCmdPipelineBarrier(commandBuffer,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT |
+                           VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0,
+                       nullptr, 0, nullptr);
+
+  // same layout, the vertex shader ignores the mass in w.
+  VkBufferCopy copyRegion{};
+  copyRegion.size = vertexBuffers[frameIndex]->getBufferSize();
+  vkCmdCopyBuffer(commandBuffer, bodyBuffers[currentBuffer]->getBuffer(),
+                  vertexBuffers[frameIndex]->getBuffer(), 1, &copyRegion);
+}
+
+void GravityBodySystem::acquireBodies(lve::FrameInfo& frameInfo) {
+  if (settings.backend != Backend::GPU) return;
+  recordOwnershipTransfer(frameInfo.commandBuffer, frameInfo.frameIndex,
+                          false);
+}
+
+void GravityBodySystem::recordOwnershipTransfer(VkCommandBuffer commandBuffer,
+                                                int frameIndex,
+                                                bool release) {
+  // same family : the timeline semaphore wait already makes the writes
+  // visible.
+  if (graphicsFamily == computeFamily) return;
+
+  // release and acquire must match except for the access and stage masks.
+  // acquire starts at the compute timeline wait stage of the graphics submit.
+  VkBufferMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  barrier.srcAccessMask =
+      release ? VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT : 0;
+  barrier.dstAccessMask = release ? 0 : VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+  barrier.srcQueueFamilyIndex = computeFamily;
+  barrier.dstQueueFamilyIndex = graphicsFamily;
+  barrier.buffer = vertexBuffers[frameIndex]->getBuffer();
+  barrier.offset = 0;
+  barrier.size = VK_WHOLE_SIZE;
+
+  VkPipelineStageFlags srcStage =
+      release ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT |
+                    VK_PIPELINE_STAGE_TRANSFER_BIT
+              : VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+  VkPipelineStageFlags dstStage = release
+                                      ? VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT
+                                      : VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+  vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 1,
+                       &barrier, 0, nullptr);
+}
+
+void GravityBodySystem::renderBodies(lve::FrameInfo& frameInfo) {
+  lve::LveGpuProfiler::Scope profileScope{frameInfo, "gravity_render"};
+  lveGraphicsPipeline->bind(frameInfo.commandBuffer);
+  vkCmdBindDescriptorSets(frameInfo.commandBuffer,
+                          VK_PIPELINE_BIND_POINT_GRAPHICS,
+                          graphicsPipelineLayout, 0, 1,
+                          &frameInfo.globalDescriptorSet, 0, nullptr);
+  VkBuffer buffers[] = {vertexBuffers[frameInfo.frameIndex]->getBuffer()};
+  VkDeviceSize offsets[] = {0};
+  vkCmdBindVertexBuffers(frameInfo.commandBuffer, 0, 1, buffers, offsets);
+  vkCmdDraw(frameInfo.commandBuffer, bodyCount, 1, 0, 0);
+}
+
+GravityBodySystem::Comparison GravityBodySystem::validate(
+    uint32_t steps, float dt, float relativeTolerance) {
+  assert(settings.backend == Backend::GPU &&
+         "Validation needs the gpu backend.");
+  uploadBodies(initialBodies);
+  GravityUbo ubo{};
+  ubo.deltaTime = dt / settings.substeps;
+  ubo.strength = settings.strength;
+  ubo.bodyCount = bodyCount;
+  uniformBuffers[0]->writeToBuffer(&ubo);
+  uniformBuffers[0]->flush();
+
+  VkCommandBuffer commandBuffer = lveDevice.beginSingleTimeComputeCommands();
+  lveComputePipeline->bind(commandBuffer);
+  for (uint32_t i = 0; i < steps * settings.substeps; i++) {
+    recordSubstep(commandBuffer, 0);
+  }
+  lveDevice.endSingleTimeComputeCommands(commandBuffer);
+  GravityBodies gpuBodies{};
+  readbackBodies(gpuBodies);
+
+  auto cpuSystem = createPhysicsSystem();
+  for (uint32_t i = 0; i < steps; i++) {
+    cpuSystem->simulate(dt, settings.substeps);
+  }
+  const GravityBodies& cpuBodies = cpuSystem->getBodies();
+
+  Comparison comparison{};
+  comparison.count = bodyCount;
+  double errorSquaredSum = 0.0;
+  for (uint32_t i = 0; i < bodyCount; i++) {
+    glm::vec3 expected{cpuBodies.positionX[i], cpuBodies.positionY[i],
+                       cpuBodies.positionZ[i]};
+    glm::vec3 actual{gpuBodies.positionX[i], gpuBodies.positionY[i],
+                     gpuBodies.positionZ[i]};
+    glm::vec3 start{initialBodies.positionX[i], initialBodies.positionY[i],
+                    initialBodies.positionZ[i]};
+    float error = glm::length(actual - expected);
+    // NOTE: floored, bodies at rest only see float rounding.
+    float distance =
+        std::max(glm::length(expected - start), MIN_VALIDATION_DISTANCE);
+    float relativeError = error / distance;
+    comparison.maxPositionError = std::max(comparison.maxPositionError, error);
+    comparison.maxRelativeError =
+        std::max(comparison.maxRelativeError, relativeError);
+    errorSquaredSum += static_cast<double>(error) * error;
+    if (!(relativeError <= relativeTolerance)) comparison.mismatchCount++;
+  }
+  comparison.rmsPositionError =
+      static_cast<float>(std::sqrt(errorSquaredSum / bodyCount));
+
+  // the simulation starts over from the initial bodies.
+  uploadBodies(initialBodies);
+  return comparison;
+}
+
+}  // namespace kc_bonus
@@ -0,0 +1,152 @@
+#pragma once
+
+#include "kc_bonus.hpp"
+#include "lve_buffer.hpp"
+#include "lve_descriptors.hpp"
+#include "lve_device.hpp"
+#include "lve_frame_context.hpp"
+#include "lve_frame_info.hpp"
+#include "lve_pipeline.hpp"
+#include "lve_pipeline_compiler.hpp"
+#include "lve_thread_pool.hpp"
+
+// std
+#include <memory>
+#include <vector>
+
+namespace kc_bonus {
+
+// step parameters of compute_gravity.comp (std140).
+struct GravityUbo {
+  // of one substep
+  float deltaTime = 0.f;
+  float strength = 0.f;
+  uint32_t bodyCount = 0;
+  float minDistanceSquared = GravityKernel::MIN_DISTANCE_SQUARED;
+};
+
+// n-body cluster drawn as points, simulated on the CPU by
+// GravityPhysicsSystem or on the GPU by compute_gravity.comp.
+// both step once per fixed tick of the frame (FrameInfo::tickCount).
+// GPU: bodies never leave the device. every substep also writes the vertex
+// buffer of the frame, which is released to the graphics family like the
+// particles. it draws the latest tick, uninterpolated. CPU: positions are
+// blended between the last two ticks into a host visible vertex buffer.
+class GravityBodySystem {
+ public:
+  enum class Backend { CPU, GPU };
+  // local_size_x of compute_gravity.comp (specialization constant 0), also
+  // the bodies per shared memory tile.
+  static constexpr uint32_t WORKGROUP_SIZE = 256;
+  // validate: bodies moving less than this are compared to it.
+  static constexpr float MIN_VALIDATION_DISTANCE = 1e-3f;
+
+  struct Settings {
+    Backend backend = Backend::GPU;
+    float strength = .81f;
+    unsigned int substeps = 4;
+  };
+
+  struct Comparison {
+    uint32_t count = 0;
+    // bodies off by more than the tolerance in position.
+    uint32_t mismatchCount = 0;
+    float maxPositionError = 0.f;
+    float rmsPositionError = 0.f;
+    // position error over the distance the body moved.
+    float maxRelativeError = 0.f;
+  };
+
+  GravityBodySystem(lve::LveDevice &device,
+                    const lve::LveFrameContext &frameContext,
+                    VkRenderPass renderPass,
+                    VkDescriptorSetLayout globalSetLayout,
+                    lve::LveDescriptorPool &pool,
+                    lve::LvePipelineCompiler &pipelineCompiler,
+                    lve::LveThreadPool &threadPool,
+                    const GravityBodies &bodies, const Settings &settings);
+  ~GravityBodySystem();
+
+  GravityBodySystem(const GravityBodySystem &) = delete;
+  GravityBodySystem &operator=(const GravityBodySystem &) = delete;
+
+  Backend getBackend() const { return settings.backend; }
+  uint32_t getBodyCount() const { return bodyCount; }
+
+  // CPU backend: steps the bodies and fills the vertex buffer of the frame.
+  // graphics frame, before recording.
+  void update(lve::FrameInfo &frameInfo);
+  // GPU backend: records the substeps of the frame's ticks on the compute
+  // queue.
+  void computeBodies(lve::FrameInfo &frameInfo);
+  // graphics side of the ownership transfer. record before the render pass.
+  void acquireBodies(lve::FrameInfo &frameInfo);
+  void renderBodies(lve::FrameInfo &frameInfo);
+
+  // GPU backend: runs steps updates of dt on both backends from the initial
+  // bodies and compares the positions read back from the device.
+  // relativeTolerance : of the distance each body moved, close pairs move
+  // (and diverge) the most.
+  // NOTE: blocks on the compute queue and restarts the gpu simulation, call
+  // before the first compute frame.
+  Comparison validate(uint32_t steps, float dt, float relativeTolerance);
+
+ private:
+  // CPU solver starting from the initial bodies.
+  std::unique_ptr<GravityPhysicsSystem> createPhysicsSystem();
+  void createUniformBuffers();
+  void createBodyBuffers();
+  void createVertexBuffers();
+  void uploadBodies(const GravityBodies &bodies);
+  void readbackBodies(GravityBodies &bodies);
+  // one substep from bodyBuffers[currentBuffer] into the other one.
+  void recordSubstep(VkCommandBuffer commandBuffer, int frameIndex);
+  // frames without a tick copy the current bodies to their vertex buffer.
+  void recordVertexCopy(VkCommandBuffer commandBuffer, int frameIndex);
+  // queue family ownership transfer of the frame's vertex buffer.
+  void recordOwnershipTransfer(VkCommandBuffer commandBuffer, int frameIndex,
+                               bool release);
+  void createComputeDescriptorSetLayout();
+  void createComputeDescriptorSets(lve::LveDescriptorPool &pool);
+  void createGraphicsPipelineLayout(VkDescriptorSetLayout globalSetLayout);
+  void createGraphicsPipeline(VkRenderPass renderPass,
+                              lve::LvePipelineCompiler &pipelineCompiler);
+  void createComputePipelineLayout();
+  void createComputePipeline(lve::LvePipelineCompiler &pipelineCompiler);
+
+  lve::LveDevice &lveDevice;
+  const lve::LveFrameContext &frameContext;
+  lve::LveThreadPool &threadPool;
+  Settings settings;
+  uint32_t bodyCount;
+  // start of the simulation, also the reference of validate.
+  GravityBodies initialBodies;
+  // CPU backend only, owns the body store.
+  std::unique_ptr<GravityPhysicsSystem> physicsSystem;
+  // CPU backend, positions before the last tick.
+  std::vector<glm::vec3> previousPositions;
+
+  std::unique_ptr<lve::LvePipeline> lveGraphicsPipeline;
+  VkPipelineLayout graphicsPipelineLayout;
+  std::unique_ptr<lve::LvePipeline> lveComputePipeline;
+  VkPipelineLayout computePipelineLayout;
+
+  std::vector<std::unique_ptr<lve::LveBuffer>> uniformBuffers;
+  // vec4 per body, xyz: position, w: mass. ping-ponged every substep, since
+  // every invocation reads all positions.
+  std::unique_ptr<lve::LveBuffer> bodyBuffers[2];
+  // vec4 per body, only written by the body's own invocation.
+  std::unique_ptr<lve::LveBuffer> velocityBuffer;
+  // vec4 positions drawn by the graphics family, per frame in flight.
+  std::vector<std::unique_ptr<lve::LveBuffer>> vertexBuffers;
+  // body buffer read by the next substep.
+  uint32_t currentBuffer = 0;
+  uint32_t graphicsFamily;
+  uint32_t computeFamily;
+
+  std::unique_ptr<lve::LveDescriptorSetLayout> computeDescriptorSetLayout;
+  // two per frame, one per ping-pong direction.
+  std::vector<VkDescriptorSet> computeDescriptorSets;
+};
+
+}  // namespace kc_bonus
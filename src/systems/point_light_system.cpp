@@ -1,5 +1,8 @@
 #include "point_light_system.hpp"
 
+#include "clustered_light_system.hpp"
+#include "lve_gpu_profiler.hpp"
+
 // libs
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -7,38 +10,51 @@
 #include <glm/gtc/constants.hpp>
 
 // std
+#include <algorithm>
 #include <array>
+#include <cstddef>
 #include <iostream>
-#include <map>
 #include <memory>
 #include <stdexcept>
 
 namespace lve {
 
-struct PointLightPushConstants {
-  glm::vec4 position{};
-  glm::vec4 color{};
-  float radius;
-};
+// intensity / distance^2 below this is treated as no contribution.
+// decides the radius used for cluster culling.
+constexpr float LIGHT_CUTOFF = 0.005f;
 
-PointLightSystem::PointLightSystem(LveDevice& device, VkRenderPass renderPass,
-                                   VkDescriptorSetLayout globalSetLayout)
+PointLightSystem::PointLightSystem(LveDevice& device,
+                                   const LveFrameContext& frameContext,
+                                   VkRenderPass renderPass,
+                                   VkDescriptorSetLayout globalSetLayout,
+                                   LvePipelineCompiler& pipelineCompiler)
     : lveDevice{device} {
   createPipelineLayout(globalSetLayout);
-  createPipeline(renderPass);
+  createPipeline(renderPass, pipelineCompiler);
+  createBillboardBuffers(frameContext.getFramesInFlight());
 }
 PointLightSystem::~PointLightSystem() {
+  // NOTE: pipeline first, async build may still use the layout.
+  lvePipeline.reset();
   vkDestroyPipelineLayout(lveDevice.device(), pipelineLayout, nullptr);
 }
 
+void PointLightSystem::createBillboardBuffers(uint32_t framesInFlight) {
+  billboardBuffers.resize(framesInFlight);
+  billboardCounts.assign(framesInFlight, 0);
+  for (auto& buffer : billboardBuffers) {
+    // written by cpu every frame. need to flush since non-coherent
+    buffer = std::make_unique<LveBuffer>(
+        lveDevice, sizeof(LightBillboard), ClusteredLightSystem::MAX_LIGHTS,
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+    buffer->map();
+  }
+  billboards.reserve(ClusteredLightSystem::MAX_LIGHTS);
+  sortEntries.reserve(ClusteredLightSystem::MAX_LIGHTS);
+}
+
 void PointLightSystem::createPipelineLayout(
     VkDescriptorSetLayout globalSetLayout) {
-  VkPushConstantRange pushConstantRange{};
-  pushConstantRange.stageFlags =
-      VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-  pushConstantRange.offset = 0;
-  pushConstantRange.size = sizeof(PointLightPushConstants);
-
   // only one for now.
   std::vector<VkDescriptorSetLayout> descriptorSetLayouts{globalSetLayout};
 
@@ -47,93 +63,66 @@ void PointLightSystem::createPipelineLayout(
   pipelineLayoutInfo.setLayoutCount =
       static_cast<uint32_t>(descriptorSetLayouts.size());
   pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-  pipelineLayoutInfo.pushConstantRangeCount = 1;
-  pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+  // light data comes from the instance buffer.
+  pipelineLayoutInfo.pushConstantRangeCount = 0;
+  pipelineLayoutInfo.pPushConstantRanges = nullptr;
   if (vkCreatePipelineLayout(lveDevice.device(), &pipelineLayoutInfo, nullptr,
                              &pipelineLayout) != VK_SUCCESS) {
     throw std::runtime_error("failed to create pipeline layout!");
   }
 }
-void PointLightSystem::createPipeline(VkRenderPass renderPass) {
+void PointLightSystem::createPipeline(VkRenderPass renderPass,
+                                      LvePipelineCompiler& pipelineCompiler) {
   assert(pipelineLayout != nullptr &&
          "Cannot create pipeline before pipeline layout.");
 
-  PipelineConfigInfo pipelineConfig{};
-  LvePipeline::defaultPipelineConfigInfo(pipelineConfig);
-  LvePipeline::enableAlphaBlending(pipelineConfig);
-
-  pipelineConfig.attributeDescriptions.clear();
-  pipelineConfig.bindingDescriptions.clear();
-  pipelineConfig.renderPass = renderPass;
-  pipelineConfig.pipelineLayout = pipelineLayout;
-  pipelineConfig.multisampleInfo.rasterizationSamples =
+  auto pipelineConfig = std::make_shared<PipelineConfigInfo>();
+  LvePipeline::defaultPipelineConfigInfo(*pipelineConfig);
+  LvePipeline::enableAlphaBlending(*pipelineConfig);
+
+  // quad corners from gl_VertexIndex, one instance per light.
+  pipelineConfig->bindingDescriptions = {
+      {0, sizeof(LightBillboard), VK_VERTEX_INPUT_RATE_INSTANCE},
+  };
+  pipelineConfig->attributeDescriptions = {
+      {0, 0, VK_FORMAT_R32G32B32A32_SFLOAT,
+       offsetof(LightBillboard, position)},
+      {1, 0, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(LightBillboard, color)},
+  };
+  pipelineConfig->renderPass = renderPass;
+  pipelineConfig->pipelineLayout = pipelineLayout;
+  pipelineConfig->multisampleInfo.rasterizationSamples =
       lveDevice.getSampleCount();
 
-  lvePipeline = std::make_unique<LvePipeline>(lveDevice);
-  lvePipeline->createGraphicsPipeline("./shaders/point_light.vert.spv",
-                                      "./shaders/point_light.frag.spv",
-                                      pipelineConfig);
+  lvePipeline = pipelineCompiler.createGraphicsPipeline(
+      "./shaders/point_light.vert.spv", "./shaders/point_light.frag.spv",
+      pipelineConfig);
 }
 
 void PointLightSystem::render(FrameInfo& frameInfo) {
-  // update
-  // int i = 0;
-  // for (auto& obj : gameObjects) {
-  //  i++;
-  //  float v = 0.0001f;
-  //  obj.transform.rotation.y =
-  //      glm::mod<float>(obj.transform.rotation.y + v * i,
-  //      glm::two_pi<float>());
-  //  obj.transform.rotation.x = glm::mod<float>(
-  //      obj.transform.rotation.x + v * 0.5 * i, glm::two_pi<float>());
-  //}
-
-  // sort lights
-  std::map<float, LveGameObject::id_t> sorted;
-  for (auto& kv : frameInfo.gameObjects) {
-    auto& obj = kv.second;
-    if (obj.pointLight == nullptr) continue;
-
-    // calculate distance
-    auto offset = frameInfo.camera.getPosition() - obj.transform.translation;
-    float disSquared = glm::dot(offset, offset);
-    sorted[disSquared] = obj.getId();
-  }
+  uint32_t billboardCount = billboardCounts[frameInfo.frameIndex];
+  if (billboardCount == 0) return;
 
-  // render
+  LveGpuProfiler::Scope profileScope{frameInfo, "point_lights"};
   lvePipeline->bind(frameInfo.commandBuffer);
 
   vkCmdBindDescriptorSets(frameInfo.commandBuffer,
                           VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1,
                           &frameInfo.globalDescriptorSet, 0, nullptr);
-  // iterate through sroted lights in reverse order
-  for (auto it = sorted.rbegin(); it != sorted.rend(); ++it) {
-    // use gmae obj id to find light object
-    auto& obj = frameInfo.gameObjects.at(it->second);
-
-    PointLightPushConstants push{};
-    push.position = glm::vec4(obj.transform.translation, 1.f);
-    push.color = glm::vec4(obj.color, obj.pointLight->lightIntensity);
-    push.radius = obj.transform.scale.x;
-
-    vkCmdPushConstants(
-        frameInfo.commandBuffer, pipelineLayout,
-        VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0,
-        sizeof(PointLightPushConstants), &push);
-
-    vkCmdDraw(frameInfo.commandBuffer, 6, 1, 0, 0);
-  }
+  VkBuffer buffers[] = {billboardBuffers[frameInfo.frameIndex]->getBuffer()};
+  VkDeviceSize offsets[] = {0};
+  vkCmdBindVertexBuffers(frameInfo.commandBuffer, 0, 1, buffers, offsets);
+  // already sorted back to front in update.
+  vkCmdDraw(frameInfo.commandBuffer, 6, billboardCount, 0, 0);
 }
-void PointLightSystem::update(FrameInfo& frameInfo, GlobalUbo& ubo) {
-  int lightIndex = 0;
-  for (auto& kv : frameInfo.gameObjects) {
+
+void PointLightSystem::tick(LveGameObject::Map& gameObjects, float dt) {
+  for (auto& kv : gameObjects) {
     auto& obj = kv.second;
     if (obj.pointLight == nullptr) continue;
 
-    assert(lightIndex < MAX_LIGHTS && "Point lights exceed maximum specified.");
-
     // update angle
-    obj.pointLight->angle += frameInfo.frameTime;
+    obj.pointLight->angle += dt;
     if (obj.pointLight->angle > glm::two_pi<float>()) {
       obj.pointLight->angle -= glm::two_pi<float>();
     }
@@ -145,16 +134,66 @@ void PointLightSystem::update(FrameInfo& frameInfo, GlobalUbo& ubo) {
     // update light position
     obj.transform.translation =
         obj.pointLight->rotationCenter + glm::vec3(rotateLight * radiusPos);
+  }
+}
 
-    // copy light to ubo
-    ubo.pointLights[lightIndex].position =
-        glm::vec4(obj.transform.translation, 1.f);
-    ubo.pointLights[lightIndex].color =
+void PointLightSystem::update(FrameInfo& frameInfo, GlobalUbo& ubo,
+                              LveBuffer& lightBuffer) {
+  auto* lights = static_cast<PointLight*>(lightBuffer.getMappedMemory());
+  assert(lights != nullptr && "Light buffer must be mapped.");
+
+  billboards.clear();
+  uint32_t lightIndex = 0;
+  for (auto& kv : frameInfo.gameObjects) {
+    auto& obj = kv.second;
+    if (obj.pointLight == nullptr) continue;
+
+    assert(lightIndex < lightBuffer.getInstanceCount() &&
+           "Point lights exceed light buffer capacity.");
+
+    auto transform = obj.getInterpolatedTransform(frameInfo.interpolation);
+
+    // copy light to storage buffer
+    float cullRadius = glm::sqrt(obj.pointLight->lightIntensity / LIGHT_CUTOFF);
+    lights[lightIndex].position = glm::vec4(transform.translation, cullRadius);
+    lights[lightIndex].color =
         glm::vec4(obj.color, obj.pointLight->lightIntensity);
+    billboards.push_back({
+        glm::vec4(transform.translation, transform.scale.x),
+        lights[lightIndex].color,
+    });
 
     lightIndex++;
   }
-  ubo.numLights = lightIndex;
+  // since not coherent.
+  lightBuffer.flush();
+  ubo.clusterCounts.w = lightIndex;
+
+  // back to front for blending. equal distances keep a stable order by index
+  // instead of replacing each other.
+  glm::vec3 cameraPosition = frameInfo.camera.getPosition();
+  sortEntries.clear();
+  for (uint32_t i = 0; i < billboards.size(); i++) {
+    glm::vec3 offset = cameraPosition - glm::vec3(billboards[i].position);
+    sortEntries.push_back({glm::dot(offset, offset), i});
+  }
+  std::sort(sortEntries.begin(), sortEntries.end(),
+            [](const SortEntry& a, const SortEntry& b) {
+              if (a.distanceSquared != b.distanceSquared) {
+                return a.distanceSquared > b.distanceSquared;
+              }
+              return a.billboard < b.billboard;
+            });
+
+  auto& billboardBuffer = *billboardBuffers[frameInfo.frameIndex];
+  auto* sorted =
+      static_cast<LightBillboard*>(billboardBuffer.getMappedMemory());
+  for (size_t i = 0; i < sortEntries.size(); i++) {
+    sorted[i] = billboards[sortEntries[i].billboard];
+  }
+  billboardBuffer.flush();
+  billboardCounts[frameInfo.frameIndex] =
+      static_cast<uint32_t>(sortEntries.size());
 }
 
 }  // namespace lve
@@ -1,34 +1,65 @@
 #pragma once
 
+#include "lve_buffer.hpp"
 #include "lve_camera.hpp"
 #include "lve_device.hpp"
+#include "lve_frame_context.hpp"
 #include "lve_frame_info.hpp"
 #include "lve_game_object.hpp"
 #include "lve_pipeline.hpp"
+#include "lve_pipeline_compiler.hpp"
 
 // std
 #include <memory>
 #include <vector>
 
 namespace lve {
+// Light billboards, drawn back to front with one instanced draw.
 class PointLightSystem {
  public:
-  PointLightSystem(LveDevice &device, VkRenderPass renderPass,
-                   VkDescriptorSetLayout globalSetLayout);
+  // per instance vertex data of a billboard
+  struct LightBillboard {
+    glm::vec4 position{};  // w as billboard radius
+    glm::vec4 color{};     // w as intensity
+  };
+
+  PointLightSystem(LveDevice &device, const LveFrameContext &frameContext,
+                   VkRenderPass renderPass,
+                   VkDescriptorSetLayout globalSetLayout,
+                   LvePipelineCompiler &pipelineCompiler);
   ~PointLightSystem();
 
   PointLightSystem(const PointLightSystem &) = delete;
   PointLightSystem &operator=(const PointLightSystem &) = delete;
 
   void render(FrameInfo &frameInfo);
-  void update(FrameInfo &frameInfo, GlobalUbo &ubo);
+  // moves the lights around their centers by one simulation tick of dt.
+  void tick(LveGameObject::Map &gameObjects, float dt);
+  // writes all lights into lightBuffer and light count into ubo.
+  // lights are placed between the last two ticks by frameInfo.interpolation.
+  // billboards of the frame are sorted here, before recording.
+  void update(FrameInfo &frameInfo, GlobalUbo &ubo, LveBuffer &lightBuffer);
 
  private:
+  struct SortEntry {
+    float distanceSquared;
+    uint32_t billboard;
+  };
+
+  void createBillboardBuffers(uint32_t framesInFlight);
   void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
-  void createPipeline(VkRenderPass renderPass);
+  void createPipeline(VkRenderPass renderPass,
+                      LvePipelineCompiler &pipelineCompiler);
 
   LveDevice &lveDevice;
   std::unique_ptr<LvePipeline> lvePipeline;
   VkPipelineLayout pipelineLayout;
+
+  // instance buffers, sorted back to front. per frame in flight
+  std::vector<std::unique_ptr<LveBuffer>> billboardBuffers;
+  std::vector<uint32_t> billboardCounts;
+  // reused every frame, no allocation once the light count is stable.
+  std::vector<LightBillboard> billboards;
+  std::vector<SortEntry> sortEntries;
 };
 }  // namespace lve
\ No newline at end of file
@@ -1,5 +1,8 @@
 #include "simple_render_system.hpp"
 
+#include "clustered_light_system.hpp"
+#include "lve_cpu_profiler.hpp"
+
 // libs
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -16,6 +19,8 @@ namespace {
 // temp code
 struct SimplePushConstantData {
   glm::mat4 modelMatrix{1.f};
+  // NOTE: only upper 3x3 is used as normal matrix. [3][0] carries the bindless
+  // texture index (-1: no texture) to stay within 128 bytes of push constants.
   glm::mat4 normalMatrix{1.f};
 };
 }  // namespace
@@ -25,18 +30,27 @@ namespace lve {
 SimpleRenderSystem::SimpleRenderSystem(LveDevice& device,
                                        VkRenderPass renderPass,
                                        VkDescriptorSetLayout globalSetLayout,
-                                       VkDescriptorSetLayout objectSetLayout)
-    : lveDevice{device} {
-  createPipelineLayout(globalSetLayout, objectSetLayout);
-  createPipeline(renderPass);
+                                       LveTextureRegistry& textureRegistry,
+                                       LveThreadPool& threadPool,
+                                       LvePipelineCompiler& pipelineCompiler)
+    : lveDevice{device},
+      textureRegistry{textureRegistry},
+      threadPool{threadPool} {
+  createPipelineLayout(globalSetLayout,
+                       textureRegistry.getDescriptorSetLayout());
+  createPipeline(renderPass, pipelineCompiler);
 }
 SimpleRenderSystem::~SimpleRenderSystem() {
+  // NOTE: pipelines first, async builds may still use the layout.
+  lvePipeline.reset();
+  depthEqualPipeline.reset();
+  depthPrePassPipeline.reset();
   vkDestroyPipelineLayout(lveDevice.device(), pipelineLayout, nullptr);
 }
 
 void SimpleRenderSystem::createPipelineLayout(
     VkDescriptorSetLayout globalSetLayout,
-    VkDescriptorSetLayout objectSetLayout) {
+    VkDescriptorSetLayout textureSetLayout) {
   VkPushConstantRange pushConstantRange{};
   pushConstantRange.stageFlags =
       VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
@@ -45,7 +59,7 @@ void SimpleRenderSystem::createPipelineLayout(
 
   // only one for now.
   std::vector<VkDescriptorSetLayout> descriptorSetLayouts{globalSetLayout,
-                                                          objectSetLayout};
+                                                          textureSetLayout};
 
   VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
   pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
@@ -59,23 +73,56 @@ void SimpleRenderSystem::createPipelineLayout(
     throw std::runtime_error("failed to create pipeline layout!");
   }
 }
-void SimpleRenderSystem::createPipeline(VkRenderPass renderPass) {
+void SimpleRenderSystem::createPipeline(VkRenderPass renderPass,
+                                        LvePipelineCompiler& pipelineCompiler) {
   assert(pipelineLayout != nullptr &&
          "Cannot create pipeline before pipeline layout.");
 
-  PipelineConfigInfo pipelineConfig{};
-  LvePipeline::defaultPipelineConfigInfo(pipelineConfig);
-  pipelineConfig.renderPass = renderPass;
-  pipelineConfig.pipelineLayout = pipelineLayout;
-  pipelineConfig.multisampleInfo.rasterizationSamples =
+  // NOTE: configs are heap allocated and shared with the build threads.
+  auto pipelineConfig = std::make_shared<PipelineConfigInfo>();
+  LvePipeline::defaultPipelineConfigInfo(*pipelineConfig);
+  pipelineConfig->renderPass = renderPass;
+  pipelineConfig->pipelineLayout = pipelineLayout;
+  pipelineConfig->multisampleInfo.rasterizationSamples =
+      lveDevice.getSampleCount();
+  pipelineConfig->specialization.add(0, SPECULAR_EXPONENT)
+      .add(1, ClusteredLightSystem::MAX_LIGHTS_PER_CLUSTER);
+  lvePipeline = pipelineCompiler.getGraphicsVariant(
+      "./shaders/simple_shader.vert.spv", "./shaders/simple_shader.frag.spv",
+      pipelineConfig);
+
+  // shading after depth pre-pass: depth is already final.
+  auto equalConfig = std::make_shared<PipelineConfigInfo>();
+  LvePipeline::defaultPipelineConfigInfo(*equalConfig);
+  equalConfig->renderPass = renderPass;
+  equalConfig->pipelineLayout = pipelineLayout;
+  equalConfig->multisampleInfo.rasterizationSamples =
       lveDevice.getSampleCount();
-  lvePipeline = std::make_unique<LvePipeline>(lveDevice);
-  lvePipeline->createGraphicsPipeline("./shaders/simple_shader.vert.spv",
-                                      "./shaders/simple_shader.frag.spv",
-                                      pipelineConfig);
+  equalConfig->depthStencilInfo.depthCompareOp = VK_COMPARE_OP_EQUAL;
+  equalConfig->depthStencilInfo.depthWriteEnable = VK_FALSE;
+  equalConfig->specialization.add(0, SPECULAR_EXPONENT)
+      .add(1, ClusteredLightSystem::MAX_LIGHTS_PER_CLUSTER);
+  depthEqualPipeline = pipelineCompiler.getGraphicsVariant(
+      "./shaders/simple_shader.vert.spv", "./shaders/simple_shader.frag.spv",
+      equalConfig);
+
+  // depth only: position attribute only, no fragment shader, no color write.
+  auto prePassConfig = std::make_shared<PipelineConfigInfo>();
+  LvePipeline::defaultPipelineConfigInfo(*prePassConfig);
+  prePassConfig->renderPass = renderPass;
+  prePassConfig->pipelineLayout = pipelineLayout;
+  prePassConfig->multisampleInfo.rasterizationSamples =
+      lveDevice.getSampleCount();
+  prePassConfig->multisampleInfo.sampleShadingEnable = VK_FALSE;
+  prePassConfig->colorBlendAttachment.colorWriteMask = 0;
+  prePassConfig->attributeDescriptions = {
+      prePassConfig->attributeDescriptions[0]};
+  depthPrePassPipeline = pipelineCompiler.createGraphicsPipeline(
+      "./shaders/depth_prepass.vert.spv", "", prePassConfig);
 }
 
-void SimpleRenderSystem::renderGameObjects(FrameInfo& frameInfo) {
+void SimpleRenderSystem::renderGameObjects(FrameInfo& frameInfo,
+                                           LveRenderer& renderer) {
   // update
   // int i = 0;
   // for (auto& obj : gameObjects) {
@@ -88,30 +135,134 @@ void SimpleRenderSystem::renderGameObjects(FrameInfo& frameInfo) {
   //      obj.transform.rotation.x + v * 0.5 * i, glm::two_pi<float>());
   //}
 
+  // flatten draw list so it can be split by index.
+  std::vector<LveGameObject*> drawList;
+  drawList.reserve(frameInfo.gameObjects.size());
+  for (auto& kv : frameInfo.gameObjects) {
+    if (kv.second.model == nullptr) continue;
+    drawList.push_back(&kv.second);
+  }
+  if (drawList.empty()) return;
+
+  // buffers of a chunk go to its own slot, executed in draw list order.
+  using ChunkBuffers = std::pair<VkCommandBuffer, VkCommandBuffer>;
+  std::vector<ChunkBuffers> chunkBuffers(threadPool.getThreadCount());
+  size_t chunkCount = threadPool.parallelFor(
+      drawList.size(), MIN_OBJECTS_PER_CHUNK, 1,
+      [&](size_t chunk, size_t first, size_t count) {
+        chunkBuffers[chunk] = recordChunkPasses(
+            frameInfo, renderer, drawList.data() + first, count);
+      });
+  chunkBuffers.resize(chunkCount);
+
+  // NOTE: every chunk's pre-pass must run before any shading,
+  // otherwise later chunks can still occlude already shaded fragments.
+  std::vector<VkCommandBuffer> secondaryCommandBuffers;
+  if (depthPrePassEnabled) {
+    uint32_t scope = recordScopeBegin(frameInfo, renderer, "depth_pre_pass",
+                                      secondaryCommandBuffers);
+    for (auto& buffers : chunkBuffers) {
+      secondaryCommandBuffers.push_back(buffers.first);
+    }
+    recordScopeEnd(frameInfo, renderer, scope, secondaryCommandBuffers);
+  }
+  uint32_t scope = recordScopeBegin(frameInfo, renderer, "shading",
+                                    secondaryCommandBuffers);
+  for (auto& buffers : chunkBuffers) {
+    secondaryCommandBuffers.push_back(buffers.second);
+  }
+  recordScopeEnd(frameInfo, renderer, scope, secondaryCommandBuffers);
+
+  vkCmdExecuteCommands(frameInfo.commandBuffer,
+                       static_cast<uint32_t>(secondaryCommandBuffers.size()),
+                       secondaryCommandBuffers.data());
+}
+
+std::pair<VkCommandBuffer, VkCommandBuffer>
+SimpleRenderSystem::recordChunkPasses(FrameInfo& frameInfo,
+                                      LveRenderer& renderer,
+                                      LveGameObject* const* objects,
+                                      size_t count) {
+  LVE_PROFILE_SCOPE("record_chunk");
+  uint32_t threadIndex = LveThreadPool::currentThreadIndex();
+
+  VkCommandBuffer prePassCommandBuffer = VK_NULL_HANDLE;
+  if (depthPrePassEnabled) {
+    prePassCommandBuffer = renderer.beginSecondaryCommandBuffer(threadIndex);
+    recordChunk(frameInfo, prePassCommandBuffer, *depthPrePassPipeline,
+                objects, count);
+    renderer.endSecondaryCommandBuffer(prePassCommandBuffer);
+  }
+
+  auto shadingCommandBuffer = renderer.beginSecondaryCommandBuffer(threadIndex);
+  recordChunk(frameInfo, shadingCommandBuffer,
+              depthPrePassEnabled ? *depthEqualPipeline : *lvePipeline, objects,
+              count);
+  renderer.endSecondaryCommandBuffer(shadingCommandBuffer);
+  return {prePassCommandBuffer, shadingCommandBuffer};
+}
+
+uint32_t SimpleRenderSystem::recordScopeBegin(
+    FrameInfo& frameInfo, LveRenderer& renderer, const char* name,
+    std::vector<VkCommandBuffer>& commandBuffers) {
+  auto profiler = frameInfo.gpuProfiler;
+  if (profiler == nullptr || !profiler->isEnabled()) {
+    return LveGpuProfiler::INVALID_SCOPE;
+  }
+  // NOTE: primary buffer only allows vkCmdExecuteCommands in this subpass,
+  // so the timestamp goes into its own tiny secondary buffer.
+  auto commandBuffer = renderer.beginSecondaryCommandBuffer(
+      LveThreadPool::currentThreadIndex());
+  uint32_t scope =
+      profiler->beginScope(commandBuffer, frameInfo.frameIndex, name);
+  renderer.endSecondaryCommandBuffer(commandBuffer);
+  commandBuffers.push_back(commandBuffer);
+  return scope;
+}
+
+void SimpleRenderSystem::recordScopeEnd(
+    FrameInfo& frameInfo, LveRenderer& renderer, uint32_t scope,
+    std::vector<VkCommandBuffer>& commandBuffers) {
+  if (scope == LveGpuProfiler::INVALID_SCOPE) return;
+  auto commandBuffer = renderer.beginSecondaryCommandBuffer(
+      LveThreadPool::currentThreadIndex());
+  frameInfo.gpuProfiler->endScope(commandBuffer, frameInfo.frameIndex, scope);
+  renderer.endSecondaryCommandBuffer(commandBuffer);
+  commandBuffers.push_back(commandBuffer);
+}
+
+void SimpleRenderSystem::recordChunk(FrameInfo& frameInfo,
+                                     VkCommandBuffer commandBuffer,
+                                     LvePipeline& pipeline,
+                                     LveGameObject* const* objects,
+                                     size_t count) {
   // render
-  lvePipeline->bind(frameInfo.commandBuffer);
+  pipeline.bind(commandBuffer);
 
-  vkCmdBindDescriptorSets(frameInfo.commandBuffer,
-                          VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1,
-                          &frameInfo.globalDescriptorSet, 0, nullptr);
+  // global set + bindless texture set, bound once for all objects.
+  VkDescriptorSet descriptorSets[] = {frameInfo.globalDescriptorSet,
+                                      textureRegistry.getDescriptorSet()};
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                          pipelineLayout, 0, 2, descriptorSets, 0, nullptr);
 
-  for (auto& kv : frameInfo.gameObjects) {
-    auto& obj = kv.second;
-    if (obj.model == nullptr) continue;
+  for (size_t i = 0; i < count; i++) {
+    auto& obj = *objects[i];
     SimplePushConstantData push{};
-    push.modelMatrix = obj.transform.mat4();
-    push.normalMatrix = obj.transform.normalMatrix();
+    auto transform = obj.getInterpolatedTransform(frameInfo.interpolation);
+    push.modelMatrix = transform.mat4();
+    push.normalMatrix = transform.normalMatrix();
+    push.normalMatrix[3][0] =
+        obj.model->textureIndex == LveTextureRegistry::INVALID_INDEX
+            ? -1.f
+            : static_cast<float>(obj.model->textureIndex);
 
     vkCmdPushConstants(
-        frameInfo.commandBuffer, pipelineLayout,
+        commandBuffer, pipelineLayout,
         VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0,
         sizeof(SimplePushConstantData), &push);
 
-    vkCmdBindDescriptorSets(frameInfo.commandBuffer,
-                            VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1,
-                            1, &obj.model->textureDescriptorSet, 0, nullptr);
-    obj.model->bind(frameInfo.commandBuffer);
-    obj.model->draw(frameInfo.commandBuffer);
+    obj.model->bind(commandBuffer);
+    obj.model->draw(commandBuffer);
   }
 }
 
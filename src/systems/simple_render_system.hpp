@@ -4,32 +4,78 @@
 #include "lve_device.hpp"
 #include "lve_frame_info.hpp"
 #include "lve_game_object.hpp"
+#include "lve_gpu_profiler.hpp"
 #include "lve_pipeline.hpp"
+#include "lve_pipeline_compiler.hpp"
+#include "lve_renderer.hpp"
+#include "lve_texture_registry.hpp"
+#include "lve_thread_pool.hpp"
 
 // std
 #include <memory>
+#include <utility>
 #include <vector>
 
 namespace lve {
 class SimpleRenderSystem {
  public:
+  // specular exponent of the blinn term (specialization constant 0)
+  static constexpr float SPECULAR_EXPONENT = 128.f;
+
   SimpleRenderSystem(LveDevice &device, VkRenderPass renderPass,
                      VkDescriptorSetLayout globalSetLayout,
-                     VkDescriptorSetLayout objectSetLayout);
+                     LveTextureRegistry &textureRegistry,
+                     LveThreadPool &threadPool,
+                     LvePipelineCompiler &pipelineCompiler);
   ~SimpleRenderSystem();
 
   SimpleRenderSystem(const SimpleRenderSystem &) = delete;
   SimpleRenderSystem &operator=(const SimpleRenderSystem &) = delete;
 
-  void renderGameObjects(FrameInfo &frameInfo);
+  // NOTE: records draws into secondary command buffers in parallel and
+  // executes them, so the render pass must be begun with
+  // VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS.
+  void renderGameObjects(FrameInfo &frameInfo, LveRenderer &renderer);
+
+  // depth only pass first, then shade with EQUAL depth test and no depth
+  // write. pays off for scenes with heavy overdraw.
+  void setDepthPrePass(bool enable) { depthPrePassEnabled = enable; }
+  bool isDepthPrePassEnabled() const { return depthPrePassEnabled; }
 
  private:
+  // small chunks cost more in thread hand off than they save.
+  static constexpr size_t MIN_OBJECTS_PER_CHUNK = 32;
+
+  void recordChunk(FrameInfo &frameInfo, VkCommandBuffer commandBuffer,
+                   LvePipeline &pipeline, LveGameObject *const *objects,
+                   size_t count);
+  // one chunk: optional depth pre-pass buffer + shading buffer
+  std::pair<VkCommandBuffer, VkCommandBuffer> recordChunkPasses(
+      FrameInfo &frameInfo, LveRenderer &renderer,
+      LveGameObject *const *objects, size_t count);
+  // profiler scope markers, in their own secondary buffers.
+  uint32_t recordScopeBegin(FrameInfo &frameInfo, LveRenderer &renderer,
+                            const char *name,
+                            std::vector<VkCommandBuffer> &commandBuffers);
+  void recordScopeEnd(FrameInfo &frameInfo, LveRenderer &renderer,
+                      uint32_t scope,
+                      std::vector<VkCommandBuffer> &commandBuffers);
+
   void createPipelineLayout(VkDescriptorSetLayout globalSetLayout,
-                            VkDescriptorSetLayout objectSetLayout);
-  void createPipeline(VkRenderPass renderPass);
+                            VkDescriptorSetLayout textureSetLayout);
+  void createPipeline(VkRenderPass renderPass,
+                      LvePipelineCompiler &pipelineCompiler);
 
   LveDevice &lveDevice;
-  std::unique_ptr<LvePipeline> lvePipeline;
+  LveTextureRegistry &textureRegistry;
+  LveThreadPool &threadPool;
+  // shading pipelines are shader variants, shared through the compiler.
+  std::shared_ptr<LvePipeline> lvePipeline;
+  // used when depth pre-pass is enabled
+  std::unique_ptr<LvePipeline> depthPrePassPipeline;
+  std::shared_ptr<LvePipeline> depthEqualPipeline;
   VkPipelineLayout pipelineLayout;
+
+  bool depthPrePassEnabled = false;
 };
 }  // namespace lve
\ No newline at end of file